@@ -0,0 +1,147 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "arena.h"
+
+struct arena_block_t
+{
+    arena_block_t *next;
+    size_t         size;
+    size_t         used;
+};
+
+#define BLOCK_HEADER_SIZE    ((sizeof(arena_block_t) + ARENA_ALIGNMENT - 1) & ~(size_t) (ARENA_ALIGNMENT - 1))
+
+static arena_block_t *arena_block_create(size_t size)
+{
+    arena_block_t *block = (arena_block_t *) malloc(BLOCK_HEADER_SIZE + size);
+    if (!block)
+        return NULL;
+
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+// returns the aligned room for size bytes in a block, or NULL when it doesn't fit
+static void *arena_block_alloc(arena_block_t *block, size_t alignment, size_t size)
+{
+    uintptr_t base = (uintptr_t) block + BLOCK_HEADER_SIZE;
+    uintptr_t start = (base + block->used + alignment - 1) & ~(uintptr_t) (alignment - 1);
+
+    if (start - base + size > block->size)
+        return NULL;
+
+    block->used = start - base + size;
+    return (void *) start;
+}
+
+arena_t *arena_create(size_t first_size, size_t block_size)
+{
+    arena_block_t *block;
+    arena_t *arena;
+
+    block = arena_block_create(first_size + sizeof(arena_t) + ARENA_ALIGNMENT);
+    if (!block)
+        return NULL;
+
+    arena = (arena_t *) arena_block_alloc(block, ARENA_ALIGNMENT, sizeof(arena_t));
+    arena->blocks = block;
+    arena->block_size = block_size;
+    return arena;
+}
+
+void arena_destroy(arena_t *arena)
+{
+    arena_block_t *block, *next;
+
+    if (!arena)
+        return;
+
+    // the arena lives in the last block of the chain
+    for (block = arena->blocks; block; block = next)
+    {
+        next = block->next;
+        free(block);
+    }
+}
+
+void *arena_memalign(arena_t *arena, size_t alignment, size_t size)
+{
+    arena_block_t *block;
+    void *ptr;
+
+    ptr = arena_block_alloc(arena->blocks, alignment, size);
+    if (ptr)
+        return ptr;
+
+    // what doesn't fit a regular block gets a block of its own, behind the
+    // one being filled so that its leftover room stays in use
+    if (size + alignment > arena->block_size / 4)
+    {
+        block = arena_block_create(size + alignment);
+        if (!block)
+            return NULL;
+        block->next = arena->blocks->next;
+        arena->blocks->next = block;
+        return arena_block_alloc(block, alignment, size);
+    }
+
+    block = arena_block_create(arena->block_size);
+    if (!block)
+        return NULL;
+    block->next = arena->blocks;
+    arena->blocks = block;
+    return arena_block_alloc(block, alignment, size);
+}
+
+void *arena_alloc(arena_t *arena, size_t size)
+{
+    return arena_memalign(arena, ARENA_ALIGNMENT, size);
+}
+
+void *arena_calloc(arena_t *arena, size_t size)
+{
+    void *ptr = arena_memalign(arena, ARENA_ALIGNMENT, size);
+    if (ptr)
+        memset(ptr, 0, size);
+    return ptr;
+}
+
+char *arena_strdup(arena_t *arena, const char *str)
+{
+    size_t len;
+    char *copy;
+
+    if (!str)
+        return NULL;
+
+    len = strlen(str) + 1;
+    copy = (char *) arena_memalign(arena, 1, len);
+    if (copy)
+        memcpy(copy, str, len);
+    return copy;
+}
@@ -0,0 +1,70 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A region that hands out memory from a chain of blocks and gives it all
+ * back at once. Allocations can't be freed or grown on their own.
+ */
+typedef struct arena_block_t arena_block_t;
+
+typedef struct
+{
+    arena_block_t *blocks;              // the block being filled comes first
+    size_t         block_size;          // of the blocks added when one is full
+}
+arena_t;
+
+#define ARENA_ALIGNMENT    16
+
+/**
+ * creates an arena whose first block holds first_size bytes, the arena
+ * itself is kept in that block
+ */
+arena_t *arena_create(size_t first_size, size_t block_size);
+
+/**
+ * releases every block of the arena and the arena itself
+ */
+void arena_destroy(arena_t *);
+
+/**
+ * arena_alloc and arena_calloc align to ARENA_ALIGNMENT, arena_memalign takes
+ * a power of two
+ */
+void *arena_alloc(arena_t *, size_t size);
+void *arena_calloc(arena_t *, size_t size);
+void *arena_memalign(arena_t *, size_t alignment, size_t size);
+char *arena_strdup(arena_t *, const char *);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __ARENA_H__ */
@@ -10,6 +10,9 @@
 #include <string.h>
 #include <iconv.h>
 #include <errno.h>
+#ifndef __lv2ppu__
+#include <pthread.h>
+#endif
 
 #ifdef HAVE_CODESET
 #include <langinfo.h>
@@ -32,6 +35,143 @@ char* charset_get_current(void)
 	return charset;
 }
 
+#ifdef __lv2ppu__
+
+/* no pthreads to guard a cache with, each conversion opens its own */
+static iconv_t charset_open(const char *from, const char *to)
+{
+	return iconv_open(to, from);
+}
+
+static void charset_release(iconv_t cd, const char *from, const char *to)
+{
+	iconv_close(cd);
+}
+
+void charset_cleanup(void)
+{
+}
+
+#else
+
+/*
+ * Opening a conversion is far more expensive than converting the short
+ * strings of a disc, so conversions are kept for reuse.  An iconv
+ * descriptor carries shift state, so one is only handed to one thread
+ * at a time, a busy one makes the caller open another.
+ */
+#define CHARSET_CACHE_SIZE	16
+#define CHARSET_NAME_SIZE	32
+
+typedef struct
+{
+	char from[CHARSET_NAME_SIZE];
+	char to[CHARSET_NAME_SIZE];
+	iconv_t cd;
+	int in_use;
+} charset_cache_entry_t;
+
+static pthread_mutex_t charset_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static charset_cache_entry_t charset_cache[CHARSET_CACHE_SIZE];
+static int charset_cache_count = 0;
+
+static iconv_t charset_open(const char *from, const char *to)
+{
+	int i;
+
+	pthread_mutex_lock(&charset_cache_mutex);
+	for (i = 0; i < charset_cache_count; i++)
+	{
+		charset_cache_entry_t *entry = &charset_cache[i];
+		if (!entry->in_use && strcmp(entry->from, from) == 0 && strcmp(entry->to, to) == 0)
+		{
+			entry->in_use = 1;
+			pthread_mutex_unlock(&charset_cache_mutex);
+			return entry->cd;
+		}
+	}
+	pthread_mutex_unlock(&charset_cache_mutex);
+
+	return iconv_open(to, from);
+}
+
+static void charset_release(iconv_t cd, const char *from, const char *to)
+{
+	int i;
+
+	/* back to the initial shift state for the next user */
+	iconv(cd, NULL, NULL, NULL, NULL);
+
+	pthread_mutex_lock(&charset_cache_mutex);
+	for (i = 0; i < charset_cache_count; i++)
+	{
+		if (charset_cache[i].cd == cd)
+		{
+			charset_cache[i].in_use = 0;
+			pthread_mutex_unlock(&charset_cache_mutex);
+			return;
+		}
+	}
+	if (charset_cache_count < CHARSET_CACHE_SIZE &&
+	    strlen(from) < CHARSET_NAME_SIZE && strlen(to) < CHARSET_NAME_SIZE)
+	{
+		charset_cache_entry_t *entry = &charset_cache[charset_cache_count++];
+		strcpy(entry->from, from);
+		strcpy(entry->to, to);
+		entry->cd = cd;
+		entry->in_use = 0;
+		pthread_mutex_unlock(&charset_cache_mutex);
+		return;
+	}
+	pthread_mutex_unlock(&charset_cache_mutex);
+
+	iconv_close(cd);
+}
+
+/* close the conversions kept, one still in use stays kept */
+void charset_cleanup(void)
+{
+	int i, kept = 0;
+
+	pthread_mutex_lock(&charset_cache_mutex);
+	for (i = 0; i < charset_cache_count; i++)
+	{
+		if (charset_cache[i].in_use)
+			charset_cache[kept++] = charset_cache[i];
+		else
+			iconv_close(charset_cache[i].cd);
+	}
+	charset_cache_count = kept;
+	pthread_mutex_unlock(&charset_cache_mutex);
+}
+
+#endif
+
+/* charsets that map the bytes below 0x80 to ASCII and nothing else */
+static int charset_is_ascii_superset(const char *charset)
+{
+	return strcasecmp(charset, "UTF-8") == 0 ||
+	       strcasecmp(charset, "UTF8") == 0 ||
+	       strcasecmp(charset, "US-ASCII") == 0 ||
+	       strcasecmp(charset, "ASCII") == 0 ||
+	       strcasecmp(charset, "ANSI_X3.4-1968") == 0 ||
+	       strncasecmp(charset, "ISO-8859-", 9) == 0 ||
+	       strncasecmp(charset, "ISO8859-", 8) == 0 ||
+	       strncasecmp(charset, "CP125", 5) == 0 ||
+	       strncasecmp(charset, "WINDOWS-125", 11) == 0;
+}
+
+static int charset_is_ascii(const char *string, size_t insize)
+{
+	const unsigned char *p = (const unsigned char *) string;
+	size_t i;
+
+	for (i = 0; i < insize; i++)
+		if (p[i] & 0x80)
+			return 0;
+	return 1;
+}
+
 char* charset_convert(const char *string, size_t insize, const char *from, const char *to)
 {
 	size_t outleft, outsize;
@@ -47,7 +187,19 @@ char* charset_convert(const char *string, size_t insize, const char *from, const
 	if (!to)
 		to = charset_get_current();
 
-	if ((cd = iconv_open(to, from)) == (iconv_t)-1)
+	/* most disc text is plain ASCII, which converts to itself */
+	if (charset_is_ascii(string, insize) &&
+	    charset_is_ascii_superset(from) && charset_is_ascii_superset(to))
+	{
+		out = malloc(insize + 4);
+		if (!out)
+			return NULL;
+		memcpy(out, string, insize);
+		memset(out + insize, 0, 4);
+		return out;
+	}
+
+	if ((cd = charset_open(from, to)) == (iconv_t)-1)
 	{
 		LOG(lm_main, LOG_ERROR, ("convert_string(): Conversion not supported. "
 			  "Charsets: %s -> %s", from, to));
@@ -95,7 +247,7 @@ char* charset_convert(const char *string, size_t insize, const char *from, const
 	}
     memset(outptr, 0, 4);
 
-	iconv_close(cd);
+	charset_release(cd, from, to);
 	return out;
 }
 
@@ -8,9 +8,20 @@
 #ifndef CHARSET_H_INCLUDED
 #define CHARSET_H_INCLUDED
 
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 char* charset_get_current(void);
 char* charset_convert(const char *string, size_t insize, const char *from, const char *to);
 char* charset_to_utf8(const char *string);
 char* charset_from_utf8(const char *string);
+void charset_cleanup(void);
+
+#ifdef __cplusplus
+};
+#endif
 
 #endif  /* CHARSET_H_INCLUDED */
@@ -58,8 +58,14 @@ static sys_mutex_t _log_lock;
 #define _LOCK_LOG() sysMutexLock(_log_lock, 0)
 #define _UNLOCK_LOG() sysMutexUnlock(_log_lock)
 #else
-#define _LOCK_LOG()
-#define _UNLOCK_LOG()
+#include <pthread.h>
+#include <sys/atomic.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+static pthread_mutex_t _log_lock = PTHREAD_MUTEX_INITIALIZER;
+#define _LOCK_LOG() pthread_mutex_lock(&_log_lock)
+#define _UNLOCK_LOG() pthread_mutex_unlock(&_log_lock)
 #endif
 
 #define _PUT_LOG(fd, buf, nb)    { fwrite(buf, 1, nb, fd); fflush(fd); }
@@ -75,10 +81,310 @@ static int             output_time_stamp = 0;
 #define LINE_BUF_SIZE       512
 #define DEFAULT_BUF_SIZE    16384
 
+static uint64_t        log_start_time   = 0;
+
+/*
+** Monotonic nanoseconds, only differences are meaningful.
+*/
+static uint64_t log_clock(void)
+{
+#if defined(_WIN32)
+    LARGE_INTEGER count, frequency;
+    QueryPerformanceCounter(&count);
+    QueryPerformanceFrequency(&frequency);
+    return (uint64_t) (count.QuadPart / frequency.QuadPart) * 1000000000 +
+           (uint64_t) (count.QuadPart % frequency.QuadPart) * 1000000000 / frequency.QuadPart;
+#elif defined(__lv2ppu__)
+    return (uint64_t) time(NULL) * 1000000000;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+/*
+** Writes the thread id and, when asked for, the time since log_init()
+** that start a line.
+*/
+static int log_prefix(char *line, size_t size, uint64_t time, long thread)
+{
+    int nb = 0;
+
+    if (output_time_stamp)
+    {
+        time -= log_start_time;
+        nb = snprintf(line, size, "%5lu.%06lu - ",
+                      (unsigned long) (time / 1000000000), (unsigned long) (time % 1000000000 / 1000));
+    }
+#ifdef __lv2ppu__
+    nb += snprintf(line + nb, size - nb, "%ld[%p]: ", thread, (void *) thread);
+#else
+    nb += snprintf(line + nb, size - nb, "[%ld]: ", thread);
+#endif
+    return nb;
+}
+
+#ifndef __lv2ppu__
+/*
+** Asynchronous logging. Every thread that logs gets a ring that only it
+** writes to. A writer thread drains the rings in time order and does the
+** formatting of the line prefix and the file I/O. A thread never waits on
+** a full ring, the line is counted as dropped instead.
+*/
+#define LOG_RING_SIZE       128         /* lines, a power of two */
+#define LOG_SLOT_TEXT_SIZE  248
+#define LOG_DRAIN_INTERVAL  20          /* ms */
+
+typedef struct
+{
+    uint64_t            time;
+    int                 size;
+    char                text[LOG_SLOT_TEXT_SIZE];
+} log_slot_t;
+
+typedef struct log_ring_t
+{
+    log_slot_t          slots[LOG_RING_SIZE];
+    atomic_t            head;           /* moved by the owning thread */
+    atomic_t            tail;           /* moved by whoever drains */
+    atomic_t            dropped;
+    atomic_t            in_use;         /* cleared when the owning thread exits */
+    long                id;
+    struct log_ring_t  *next;
+} log_ring_t;
+
+static log_ring_t      *log_rings          = NULL;
+static long             log_ring_count     = 0;
+static pthread_key_t    log_ring_key;
+static pthread_t        log_writer;
+static pthread_cond_t   log_writer_wake    = PTHREAD_COND_INITIALIZER;
+static int              log_writer_running = 0;
+static int              log_writer_stop    = 0;
+
+static void log_put(const char *buf, size_t nb)
+{
+    if (log_buf == 0)
+    {
+        fwrite(buf, 1, nb, log_file);
+        return;
+    }
+    if (logp + nb > log_endp)
+    {
+        fwrite(log_buf, 1, logp - log_buf, log_file);
+        logp = log_buf;
+    }
+    if (logp + nb > log_endp)
+    {
+        fwrite(buf, 1, nb, log_file);
+        return;
+    }
+    memcpy(logp, buf, nb);
+    logp += nb;
+}
+
+/*
+** Writes out what the rings hold, oldest line first. Called with the log
+** lock held.
+*/
+static void log_drain(void)
+{
+    log_ring_t *ring, *oldest;
+    log_slot_t *slot;
+    char        line[LINE_BUF_SIZE];
+    int         tail, dropped, nb;
+
+    for (;;)
+    {
+        oldest = NULL;
+        for (ring = log_rings; ring != NULL; ring = ring->next)
+        {
+            tail = sysAtomicLoad(&ring->tail);
+            if (sysAtomicLoad(&ring->head) != tail &&
+                (!oldest || ring->slots[tail & (LOG_RING_SIZE - 1)].time <
+                            oldest->slots[sysAtomicLoad(&oldest->tail) & (LOG_RING_SIZE - 1)].time))
+            {
+                oldest = ring;
+            }
+        }
+        if (!oldest)
+            break;
+
+        tail = sysAtomicLoad(&oldest->tail);
+        slot = &oldest->slots[tail & (LOG_RING_SIZE - 1)];
+        nb   = log_prefix(line, sizeof(line), slot->time, oldest->id);
+        log_put(line, nb);
+        log_put(slot->text, slot->size);
+        sysAtomicStore(&oldest->tail, (int) ((unsigned) tail + 1));
+    }
+
+    for (ring = log_rings; ring != NULL; ring = ring->next)
+    {
+        dropped = sysAtomicLoad(&ring->dropped);
+        if (dropped)
+        {
+            sysAtomicFetchAndAdd(&ring->dropped, -dropped);
+            nb = snprintf(line, sizeof(line), "[%ld]: %d lines dropped\n", ring->id, dropped);
+            log_put(line, nb);
+        }
+    }
+
+    if (log_buf && logp > log_buf)
+    {
+        fwrite(log_buf, 1, logp - log_buf, log_file);
+        logp = log_buf;
+    }
+    fflush(log_file);
+}
+
+static void *log_writer_thread(void *arg)
+{
+    struct timespec ts;
+
+    (void) arg;
+
+    _LOCK_LOG();
+    while (!log_writer_stop)
+    {
+        log_drain();
+#ifdef _WIN32
+        timespec_get(&ts, TIME_UTC);
+#else
+        clock_gettime(CLOCK_REALTIME, &ts);
+#endif
+        ts.tv_nsec += LOG_DRAIN_INTERVAL * 1000000;
+        ts.tv_sec  += ts.tv_nsec / 1000000000;
+        ts.tv_nsec %= 1000000000;
+        pthread_cond_timedwait(&log_writer_wake, &_log_lock, &ts);
+    }
+    log_drain();
+    _UNLOCK_LOG();
+    return NULL;
+}
+
+/* lets the ring of an exiting thread be taken over by a new one */
+static void log_ring_release(void *ring)
+{
+    sysAtomicStore(&((log_ring_t *) ring)->in_use, 0);
+}
+
+static log_ring_t *log_ring_get(void)
+{
+    log_ring_t *ring = (log_ring_t *) pthread_getspecific(log_ring_key);
+
+    if (ring)
+        return ring;
+
+    _LOCK_LOG();
+    for (ring = log_rings; ring != NULL; ring = ring->next)
+    {
+        if (sysAtomicCompareAndSwap(&ring->in_use, 0, 1))
+            break;
+    }
+    if (!ring)
+    {
+        ring = (log_ring_t *) calloc(1, sizeof(log_ring_t));
+        if (ring)
+        {
+            sysAtomicStore(&ring->in_use, 1);
+            ring->id   = log_ring_count++;
+            ring->next = log_rings;
+            log_rings  = ring;
+        }
+    }
+    _UNLOCK_LOG();
+
+    if (ring)
+        pthread_setspecific(log_ring_key, ring);
+    return ring;
+}
+
+/*
+** Puts a line in the ring of the calling thread. Returns 0 when it has to
+** be written synchronously, as it is too long for a slot.
+*/
+static int log_ring_push(const char *fmt, va_list ap)
+{
+    log_ring_t *ring = log_ring_get();
+    log_slot_t *slot;
+    unsigned    used;
+    int         head, nb;
+
+    if (!ring)
+        return 0;
+
+    head = sysAtomicLoad(&ring->head);
+    used = (unsigned) head - (unsigned) sysAtomicLoad(&ring->tail);
+    if (used >= LOG_RING_SIZE)
+    {
+        sysAtomicFetchAndAdd(&ring->dropped, 1);
+        return 1;
+    }
+    /* a burst doesn't wait for the next drain */
+    if (used == LOG_RING_SIZE / 2)
+        pthread_cond_signal(&log_writer_wake);
+
+    slot       = &ring->slots[head & (LOG_RING_SIZE - 1)];
+    slot->time = log_clock();
+    nb         = vsnprintf(slot->text, LOG_SLOT_TEXT_SIZE - 1, fmt, ap);
+    if (nb < 0 || nb >= LOG_SLOT_TEXT_SIZE - 1)
+        return 0;
+
+    /* Ensure there is a trailing newline. */
+    if (!nb || slot->text[nb - 1] != '\n')
+        slot->text[nb++] = '\n';
+    slot->size = nb;
+
+    sysAtomicStore(&ring->head, (int) ((unsigned) head + 1));
+    return 1;
+}
+
+static void log_writer_start(void)
+{
+    if (log_writer_running || pthread_key_create(&log_ring_key, log_ring_release) != 0)
+        return;
+
+    log_writer_stop = 0;
+    if (pthread_create(&log_writer, NULL, log_writer_thread, NULL) != 0)
+    {
+        pthread_key_delete(log_ring_key);
+        return;
+    }
+    log_writer_running = 1;
+}
+
+static void log_writer_shutdown(void)
+{
+    log_ring_t *ring;
+
+    if (!log_writer_running)
+        return;
+
+    _LOCK_LOG();
+    log_writer_stop = 1;
+    pthread_cond_signal(&log_writer_wake);
+    _UNLOCK_LOG();
+    pthread_join(log_writer, NULL);
+    log_writer_running = 0;
+
+    /* no ring destructors run after this */
+    pthread_key_delete(log_ring_key);
+    while (log_rings != NULL)
+    {
+        ring      = log_rings;
+        log_rings = ring->next;
+        free(ring);
+    }
+    log_ring_count = 0;
+}
+#endif
+
 void log_init(void)
 {
     char             *ev = 0;
 
+    log_start_time = log_clock();
+
 #ifdef __lv2ppu__
     sys_mutex_attr_t mutex_attr;
     memset(&mutex_attr, 0, sizeof(sys_mutex_attr_t));
@@ -164,6 +470,10 @@ void log_init(void)
         {
             log_file = stderr;
         }
+#ifndef __lv2ppu__
+        if (!is_sync)
+            log_writer_start();
+#endif
     }
 }
 
@@ -171,6 +481,9 @@ void log_destroy(void)
 {
     log_module_info_t *lm = logModules;
 
+#ifndef __lv2ppu__
+    log_writer_shutdown();
+#endif
     log_flush();
 
     if (log_file && log_file != stdout && log_file != stderr)
@@ -254,6 +567,17 @@ log_module_info_t* create_log_module(const char *name)
     return lm;
 }
 
+void set_log_level(const char *name, log_module_level_t level)
+{
+    log_module_info_t *lm;
+
+    for (lm = logModules; lm != NULL; lm = lm->next)
+    {
+        if (strcasecmp(name, "all") == 0 || strcasecmp(name, lm->name) == 0)
+            lm->level = level;
+    }
+}
+
 int set_log_file(const char *file)
 {
     FILE *new_log_file;
@@ -301,33 +625,35 @@ void log_print(const char *fmt, ...)
 #ifdef __lv2ppu__
     sys_ppu_thread_t me        = 0;
 #else
-    int              me     = 0;
+    long             me        = 0;
 #endif
-    time_t           now;
-    struct tm        ts;
 
     if (!log_file)
     {
         return;
     }
 
-    if (output_time_stamp)
-    {
-        time(&now);
-        ts = *localtime(&now);
-
-        nb_tid = snprintf(line, sizeof(line) - 1,
-                          "%04d-%02d-%02d %02d:%02d:%02d - ",
-                          ts.tm_year, ts.tm_mon + 1, ts.tm_mday,
-                          ts.tm_hour, ts.tm_min, ts.tm_sec);
-    }
-
 #ifdef __lv2ppu__
     sysThreadGetId(&me);
-    nb_tid += snprintf(line + nb_tid, sizeof(line) - nb_tid - 1, "%ld[%p]: ", me, (void *) me);
 #else
-    nb_tid += snprintf(line + nb_tid, sizeof(line) - nb_tid - 1, "[%d]: ", me);
+    if (log_writer_running)
+    {
+        int queued;
+
+        va_start(ap, fmt);
+        queued = log_ring_push(fmt, ap);
+        va_end(ap);
+        if (queued)
+            return;
+
+        /* too long for the ring, it goes out right away behind what is queued */
+        {
+            log_ring_t *ring = log_ring_get();
+            me = ring ? ring->id : 0;
+        }
+    }
 #endif
+    nb_tid = log_prefix(line, sizeof(line) - 1, log_clock(), (long) me);
 
     va_start(ap, fmt);
     nb = nb_tid + vsnprintf(line + nb_tid, sizeof(line) - nb_tid - 1, fmt, ap);
@@ -337,12 +663,16 @@ void log_print(const char *fmt, ...)
      * Check if we might have run out of buffer space (in case we have a
      * long line), and malloc a buffer just this once.
      */
-    if (nb == sizeof(line) - 2)
+    if (nb >= sizeof(line) - 2)
     {
+        nb = sizeof(line) - 2;
         line_long = (char *) malloc(LINE_BUF_SIZE * 8);
-        va_start(ap, fmt);
-        vsnprintf(line_long, LINE_BUF_SIZE, fmt, ap);
-        va_end(ap);
+        if (line_long)
+        {
+            va_start(ap, fmt);
+            vsnprintf(line_long, LINE_BUF_SIZE * 8, fmt, ap);
+            va_end(ap);
+        }
         /* If this failed, we'll fall back to writing the truncated line. */
     }
 
@@ -350,6 +680,10 @@ void log_print(const char *fmt, ...)
     {
         nb = strlen(line_long);
         _LOCK_LOG();
+#ifndef __lv2ppu__
+        if (log_writer_running)
+            log_drain();
+#endif
         if (log_buf != 0)
         {
             _PUT_LOG(log_file, log_buf, logp - log_buf);
@@ -381,6 +715,10 @@ void log_print(const char *fmt, ...)
             line[nb]   = '\0';
         }
         _LOCK_LOG();
+#ifndef __lv2ppu__
+        if (log_writer_running)
+            log_drain();
+#endif
         if (log_buf == 0)
         {
             _PUT_LOG(log_file, line, nb);
@@ -404,6 +742,15 @@ void log_print(const char *fmt, ...)
 
 void log_flush(void)
 {
+#ifndef __lv2ppu__
+    if (log_writer_running && log_file)
+    {
+        _LOCK_LOG();
+        log_drain();
+        _UNLOCK_LOG();
+        return;
+    }
+#endif
     if (log_buf && log_file)
     {
         _LOCK_LOG();
@@ -85,7 +85,8 @@ extern "C" {
 ** set LOG_MODULES=all:5
 **
 ** The special LogModule name "sync" tells the log service to do
-** unbuffered logging.
+** unbuffered logging. Otherwise every thread queues its lines in a ring
+** of its own, which a writer thread drains to the log file.
 **
 ** The special LogModule name "bufsize:<size>" tells the log service 
 ** to set the log buffer to <size>.
@@ -170,6 +171,11 @@ void log_destroy(void);
  */
 log_module_info_t* create_log_module(const char *name);
 
+/*
+** Set the level of a log module, or of all of them for "all".
+*/
+void set_log_level(const char *name, log_module_level_t level);
+
 /*
 ** Set the file to use for logging. Returns PR_FALSE if the file cannot
 ** be created
@@ -202,8 +208,16 @@ void log_assert(const char *s, const char *file, int ln);
 #if defined(DEBUG) || defined(FORCE_LOG)
 #define LOGGING    1
 
+/*
+** Levels above LOG_COMPILE_LEVEL are compiled out, e.g. build with
+** -DLOG_COMPILE_LEVEL=2 to keep only errors.
+*/
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL    LOG_MAX
+#endif
+
 #define LOG_TEST(_module, _level) \
-    ((_module)->level >= (_level))
+    ((_level) <= LOG_COMPILE_LEVEL && (_module)->level >= (_level))
 
 /*
 ** Log something.
@@ -0,0 +1,291 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "metrics.h"
+#include "timeout.h"
+
+// values below METRICS_SUB_BUCKETS have a bucket each, above that the
+// METRICS_SUB_BUCKET_BITS bits after the leading one pick the bucket
+static int bucket_index(uint32_t value)
+{
+    int shift = 0;
+
+    if (value < METRICS_SUB_BUCKETS)
+        return (int) value;
+
+    while ((value >> shift) >= 2 * METRICS_SUB_BUCKETS)
+        shift++;
+
+    return METRICS_SUB_BUCKETS * (shift + 1) + (int) (value >> shift) - METRICS_SUB_BUCKETS;
+}
+
+// the highest value that falls in a bucket
+static uint32_t bucket_high(int index)
+{
+    int shift;
+
+    if (index < METRICS_SUB_BUCKETS)
+        return (uint32_t) index;
+
+    shift = index / METRICS_SUB_BUCKETS - 1;
+    return (uint32_t) ((((uint64_t) (index % METRICS_SUB_BUCKETS + METRICS_SUB_BUCKETS + 1)) << shift) - 1);
+}
+
+static char *copy_string(const char *str)
+{
+    size_t len = strlen(str) + 1;
+    char *copy = (char *) malloc(len);
+    if (copy)
+        memcpy(copy, str, len);
+    return copy;
+}
+
+static metric_t *metrics_register(metrics_t *metrics, const char *name, const char *unit, int type)
+{
+    metric_t *metric;
+
+    if (!metrics)
+        return NULL;
+
+    metric = metrics_find(metrics, name);
+    if (metric)
+        return metric->type == type ? metric : NULL;
+
+    metric = (metric_t *) calloc(1, sizeof(metric_t));
+    if (!metric)
+        return NULL;
+
+    metric->name = copy_string(name);
+    metric->unit = copy_string(unit);
+    metric->type = type;
+    sysAtomicStore(&metric->min, -1);
+    if (type == METRIC_HISTOGRAM)
+        metric->buckets = (atomic_t *) calloc(METRICS_BUCKET_COUNT, sizeof(atomic_t));
+
+    if (!metric->name || !metric->unit || (type == METRIC_HISTOGRAM && !metric->buckets))
+    {
+        free(metric->buckets);
+        free(metric->unit);
+        free(metric->name);
+        free(metric);
+        return NULL;
+    }
+
+    if (metrics->last)
+        metrics->last->next = metric;
+    else
+        metrics->first = metric;
+    metrics->last = metric;
+    return metric;
+}
+
+metrics_t *metrics_create(void)
+{
+    return (metrics_t *) calloc(1, sizeof(metrics_t));
+}
+
+void metrics_destroy(metrics_t *metrics)
+{
+    metric_t *metric, *next;
+
+    if (!metrics)
+        return;
+
+    for (metric = metrics->first; metric; metric = next)
+    {
+        next = metric->next;
+        free(metric->buckets);
+        free(metric->unit);
+        free(metric->name);
+        free(metric);
+    }
+    free(metrics);
+}
+
+metric_t *metrics_counter(metrics_t *metrics, const char *name, const char *unit)
+{
+    return metrics_register(metrics, name, unit, METRIC_COUNTER);
+}
+
+metric_t *metrics_histogram(metrics_t *metrics, const char *name, const char *unit)
+{
+    return metrics_register(metrics, name, unit, METRIC_HISTOGRAM);
+}
+
+metric_t *metrics_find(metrics_t *metrics, const char *name)
+{
+    metric_t *metric;
+
+    if (!metrics)
+        return NULL;
+
+    for (metric = metrics->first; metric; metric = metric->next)
+    {
+        if (strcmp(metric->name, name) == 0)
+            return metric;
+    }
+    return NULL;
+}
+
+void metrics_add(metric_t *metric, uint64_t value)
+{
+    if (!metric)
+        return;
+
+    sysAtomic64FetchAndAdd(&metric->sum, (long long) value);
+    sysAtomicFetchAndAdd(&metric->count, 1);
+}
+
+void metrics_record(metric_t *metric, uint32_t value)
+{
+    int old;
+
+    if (!metric)
+        return;
+
+    if (metric->buckets)
+        sysAtomicFetchAndAdd(&metric->buckets[bucket_index(value)], 1);
+
+    old = sysAtomicLoad(&metric->min);
+    while (value < (uint32_t) old && !sysAtomicCompareAndSwap(&metric->min, old, (int) value))
+    {
+        old = sysAtomicLoad(&metric->min);
+    }
+    old = sysAtomicLoad(&metric->max);
+    while (value > (uint32_t) old && !sysAtomicCompareAndSwap(&metric->max, old, (int) value))
+    {
+        old = sysAtomicLoad(&metric->max);
+    }
+
+    sysAtomic64FetchAndAdd(&metric->sum, (long long) value);
+    sysAtomicFetchAndAdd(&metric->count, 1);
+}
+
+void metrics_record_time(metric_t *metric, double start)
+{
+    double elapsed;
+
+    if (!metric)
+        return;
+
+    // the clock may be set back in between
+    elapsed = (timeout_gettime() - start) * 1.0e6;
+    if (elapsed < 0.0)
+        elapsed = 0.0;
+    else if (elapsed > 4294967295.0)
+        elapsed = 4294967295.0;
+    metrics_record(metric, (uint32_t) elapsed);
+}
+
+uint64_t metrics_value(metric_t *metric)
+{
+    return metric ? (uint64_t) sysAtomic64Load(&metric->sum) : 0;
+}
+
+uint32_t metrics_count(metric_t *metric)
+{
+    return metric ? (uint32_t) sysAtomicLoad(&metric->count) : 0;
+}
+
+uint32_t metrics_min(metric_t *metric)
+{
+    return metrics_count(metric) ? (uint32_t) sysAtomicLoad(&metric->min) : 0;
+}
+
+uint32_t metrics_max(metric_t *metric)
+{
+    return metrics_count(metric) ? (uint32_t) sysAtomicLoad(&metric->max) : 0;
+}
+
+double metrics_mean(metric_t *metric)
+{
+    uint32_t count = metrics_count(metric);
+    return count ? (double) metrics_value(metric) / count : 0.0;
+}
+
+uint32_t metrics_percentile(metric_t *metric, double percentile)
+{
+    uint64_t total = 0, seen = 0, wanted;
+    uint32_t value;
+    int i;
+
+    if (!metric || !metric->buckets)
+        return 0;
+
+    // the buckets may be moving, so they are counted rather than trusting count
+    for (i = 0; i < METRICS_BUCKET_COUNT; i++)
+        total += (uint32_t) sysAtomicLoad(&metric->buckets[i]);
+    if (total == 0)
+        return 0;
+
+    if (percentile < 0.0)
+        percentile = 0.0;
+    else if (percentile > 100.0)
+        percentile = 100.0;
+    wanted = (uint64_t) (percentile / 100.0 * (double) total + 0.5);
+    if (wanted == 0)
+        wanted = 1;
+
+    for (i = 0; i < METRICS_BUCKET_COUNT; i++)
+    {
+        seen += (uint32_t) sysAtomicLoad(&metric->buckets[i]);
+        if (seen >= wanted)
+            break;
+    }
+
+    value = bucket_high(i < METRICS_BUCKET_COUNT ? i : METRICS_BUCKET_COUNT - 1);
+    return value < metrics_max(metric) ? value : metrics_max(metric);
+}
+
+void metrics_dump(metrics_t *metrics, void (*print)(const char *line, void *userdata), void *userdata)
+{
+    metric_t *metric;
+    char line[256];
+
+    if (!metrics)
+        return;
+
+    for (metric = metrics->first; metric; metric = metric->next)
+    {
+        if (metric->type == METRIC_COUNTER)
+        {
+            snprintf(line, sizeof(line), "%s: %llu %s", metric->name,
+                     (unsigned long long) metrics_value(metric), metric->unit);
+        }
+        else if (metrics_count(metric) == 0)
+        {
+            snprintf(line, sizeof(line), "%s: none", metric->name);
+        }
+        else
+        {
+            snprintf(line, sizeof(line), "%s: %u in %s, min %u, mean %.1f, p50 %u, p90 %u, p99 %u, max %u",
+                     metric->name, metrics_count(metric), metric->unit,
+                     metrics_min(metric), metrics_mean(metric),
+                     metrics_percentile(metric, 50.0), metrics_percentile(metric, 90.0),
+                     metrics_percentile(metric, 99.0), metrics_max(metric));
+        }
+        print(line, userdata);
+    }
+}
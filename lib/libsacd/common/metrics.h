@@ -0,0 +1,114 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __METRICS_H__
+#define __METRICS_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/atomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A registry of the counters and histograms of a pipeline. Metrics are
+ * registered by the thread owning the registry, after that any thread may
+ * update them without taking a lock. All update functions accept NULL, so
+ * a stage can be run without a registry.
+ *
+ * Histograms keep HDR-style log-linear buckets: one per value below
+ * METRICS_SUB_BUCKETS, then METRICS_SUB_BUCKETS per power of two, so a
+ * percentile is off by less than 1 / METRICS_SUB_BUCKETS of its value.
+ */
+#define METRICS_SUB_BUCKET_BITS    5
+#define METRICS_SUB_BUCKETS        (1 << METRICS_SUB_BUCKET_BITS)
+#define METRICS_BUCKET_COUNT       ((32 - METRICS_SUB_BUCKET_BITS + 1) * METRICS_SUB_BUCKETS)
+
+enum
+{
+      METRIC_COUNTER   = 0
+    , METRIC_HISTOGRAM = 1
+};
+
+typedef struct metric_t
+{
+    char               *name;
+    char               *unit;
+    int                 type;
+
+    atomic64_t          sum;            // counter value, or sum of the recorded values
+    atomic_t            count;          // values recorded
+    atomic_t            min;            // unsigned, valid once count > 0
+    atomic_t            max;
+    atomic_t           *buckets;        // histograms only
+
+    struct metric_t    *next;
+}
+metric_t;
+
+typedef struct
+{
+    metric_t           *first;          // in order of registration
+    metric_t           *last;
+}
+metrics_t;
+
+metrics_t *metrics_create(void);
+void metrics_destroy(metrics_t *);
+
+/**
+ * registers a metric, or returns the one registered under that name
+ */
+metric_t *metrics_counter(metrics_t *, const char *name, const char *unit);
+metric_t *metrics_histogram(metrics_t *, const char *name, const char *unit);
+metric_t *metrics_find(metrics_t *, const char *name);
+
+void metrics_add(metric_t *, uint64_t value);
+void metrics_record(metric_t *, uint32_t value);
+
+/**
+ * records the microseconds since start, as returned by timeout_gettime()
+ */
+void metrics_record_time(metric_t *, double start);
+
+uint64_t metrics_value(metric_t *);
+uint32_t metrics_count(metric_t *);
+uint32_t metrics_min(metric_t *);
+uint32_t metrics_max(metric_t *);
+double metrics_mean(metric_t *);
+
+/**
+ * the value at or below which percentile % of the recorded values are
+ */
+uint32_t metrics_percentile(metric_t *, double percentile);
+
+/**
+ * prints a line per metric
+ */
+void metrics_dump(metrics_t *, void (*print)(const char *line, void *userdata), void *userdata);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __METRICS_H__ */
@@ -571,6 +571,10 @@ typedef struct {
     volatile int counter;
 } atomic_t;
 
+typedef struct {
+    volatile long long counter;
+} atomic64_t;
+
 #define sysAtomicRead(v) ((v)->counter)
 
 #define sysAtomicSet(v,i) (((v)->counter) = (i))
@@ -615,6 +619,33 @@ static inline int sysAtomicCompareAndSwap( atomic_t *v, int oldval, int newval )
     return __sync_bool_compare_and_swap(&v->counter, oldval, newval);
 }
 
+/* sequentially consistent load, store and fetch-and-add, for lock-free
+   structures that need ordering beyond the plain volatile accessors */
+static inline int sysAtomicLoad( atomic_t *v )
+{
+    return __atomic_load_n(&v->counter, __ATOMIC_SEQ_CST);
+}
+
+static inline void sysAtomicStore( atomic_t *v, int i )
+{
+    __atomic_store_n(&v->counter, i, __ATOMIC_SEQ_CST);
+}
+
+static inline int sysAtomicFetchAndAdd( atomic_t *v, int i )
+{
+    return __sync_fetch_and_add(&v->counter, i);
+}
+
+static inline long long sysAtomic64Load( atomic64_t *v )
+{
+    return __atomic_load_n(&v->counter, __ATOMIC_SEQ_CST);
+}
+
+static inline long long sysAtomic64FetchAndAdd( atomic64_t *v, long long i )
+{
+    return __sync_fetch_and_add(&v->counter, i);
+}
+
 #elif defined(_WIN32)
 
 #include <windows.h>
@@ -671,6 +702,62 @@ __inline atomic_t sysAtomicInc(volatile atomic_t* ptr,
                                              (LONG) newval);
 }
 
+/*!
+ * @brief Atomically compares and swaps two values, like
+ * sysAtomicCompareAndExchange.
+ * @return Non-zero if newval was stored into ptr.
+ */
+__inline int sysAtomicCompareAndSwap(volatile atomic_t* ptr,
+                                     atomic_t oldval,
+                                     atomic_t newval) {
+  return InterlockedCompareExchange((LONG volatile*) ptr,
+                                    (LONG) newval,
+                                    (LONG) oldval) == (LONG) oldval;
+}
+
+/*!
+ * @brief Sequentially consistent read of a value, with a full barrier.
+ * @return The value stored in ptr.
+ */
+__inline atomic_t sysAtomicLoad(volatile atomic_t* ptr) {
+  return (atomic_t) InterlockedCompareExchange((LONG volatile*) ptr, 0, 0);
+}
+
+/*!
+ * @brief Sequentially consistent store of a value, with a full barrier.
+ */
+__inline void sysAtomicStore(volatile atomic_t* ptr, atomic_t val) {
+  (void) InterlockedExchange((LONG volatile*) ptr, (LONG) val);
+}
+
+/*!
+ * @brief Atomically add val to the value stored in ptr.
+ * @return The value stored in ptr before the addition.
+ */
+__inline atomic_t sysAtomicFetchAndAdd(volatile atomic_t* ptr,
+                                       atomic_t val) {
+  return (atomic_t) InterlockedExchangeAdd((LONG volatile*) ptr, (LONG) val);
+}
+
+typedef LONGLONG  atomic64_t;
+
+/*!
+ * @brief Sequentially consistent read of a 64-bit value.
+ * @return The value stored in ptr.
+ */
+__inline atomic64_t sysAtomic64Load(volatile atomic64_t* ptr) {
+  return InterlockedCompareExchange64(ptr, 0, 0);
+}
+
+/*!
+ * @brief Atomically add val to the 64-bit value stored in ptr.
+ * @return The value stored in ptr before the addition.
+ */
+__inline atomic64_t sysAtomic64FetchAndAdd(volatile atomic64_t* ptr,
+                                           atomic64_t val) {
+  return InterlockedExchangeAdd64(ptr, val);
+}
+
 #endif
 
 #endif /* __SYS_ATOMIC_H__ */
@@ -0,0 +1,269 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "trace.h"
+
+#ifdef SACD_TRACE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/atomic.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+typedef struct
+{
+    uint64_t            start;          // trace_clock() at the begin of the span
+    uint32_t            duration;       // nanoseconds
+    int                 tid;
+    const char         *name;
+    int64_t             arg;
+}
+trace_event_t;
+
+// written by one thread at a time, the oldest events are overwritten
+typedef struct trace_buffer_t
+{
+    trace_event_t           events[TRACE_BUFFER_EVENTS];
+    atomic_t                head;       // events recorded
+    atomic_t                in_use;     // cleared when the owning thread exits
+    int                     tid;
+    const char             *name;
+    struct trace_buffer_t  *next;
+}
+trace_buffer_t;
+
+volatile int            trace_active       = 0;
+
+static pthread_mutex_t  trace_lock         = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t    trace_key;
+static int              trace_key_created  = 0;
+static trace_buffer_t  *trace_buffers      = NULL;
+static uint64_t         trace_start_time   = 0;
+
+// names by tid, a tid is given to every thread that takes a buffer
+static const char     **trace_names        = NULL;
+static int              trace_thread_count = 0;
+
+uint64_t trace_clock(void)
+{
+#if defined(_WIN32)
+    LARGE_INTEGER count, frequency;
+    QueryPerformanceCounter(&count);
+    QueryPerformanceFrequency(&frequency);
+    return (uint64_t) (count.QuadPart / frequency.QuadPart) * 1000000000 +
+           (uint64_t) (count.QuadPart % frequency.QuadPart) * 1000000000 / frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+// lets the buffer of an exiting thread be taken over by a new one, its
+// events stay until they are overwritten
+static void trace_buffer_release(void *buffer)
+{
+    sysAtomicStore(&((trace_buffer_t *) buffer)->in_use, 0);
+}
+
+static trace_buffer_t *trace_buffer_get(void)
+{
+    trace_buffer_t *buffer;
+    const char **names;
+
+    if (!trace_key_created)
+        return NULL;
+
+    buffer = (trace_buffer_t *) pthread_getspecific(trace_key);
+    if (buffer)
+        return buffer;
+
+    pthread_mutex_lock(&trace_lock);
+    names = (const char **) realloc((void *) trace_names, (trace_thread_count + 1) * sizeof(const char *));
+    if (!names)
+    {
+        pthread_mutex_unlock(&trace_lock);
+        return NULL;
+    }
+    trace_names = names;
+
+    for (buffer = trace_buffers; buffer; buffer = buffer->next)
+    {
+        if (sysAtomicCompareAndSwap(&buffer->in_use, 0, 1))
+            break;
+    }
+    if (!buffer)
+    {
+        buffer = (trace_buffer_t *) calloc(1, sizeof(trace_buffer_t));
+        if (buffer)
+        {
+            sysAtomicStore(&buffer->in_use, 1);
+            buffer->next  = trace_buffers;
+            trace_buffers = buffer;
+        }
+    }
+    if (buffer)
+    {
+        buffer->tid  = trace_thread_count;
+        buffer->name = NULL;
+        trace_names[trace_thread_count++] = NULL;
+    }
+    pthread_mutex_unlock(&trace_lock);
+
+    if (buffer)
+        pthread_setspecific(trace_key, buffer);
+    return buffer;
+}
+
+void trace_record(uint64_t start, const char *name, int64_t arg)
+{
+    trace_buffer_t *buffer = trace_buffer_get();
+    trace_event_t *event;
+    uint64_t duration;
+    int head;
+
+    if (!buffer)
+        return;
+
+    duration = trace_clock() - start;
+    head  = sysAtomicLoad(&buffer->head);
+    event = &buffer->events[head & (TRACE_BUFFER_EVENTS - 1)];
+    event->start    = start;
+    event->duration = duration > 0xffffffff ? 0xffffffff : (uint32_t) duration;
+    event->tid      = buffer->tid;
+    event->name     = name;
+    event->arg      = arg;
+    sysAtomicStore(&buffer->head, (int) ((unsigned) head + 1));
+}
+
+void trace_thread_name(const char *name)
+{
+    trace_buffer_t *buffer = trace_buffer_get();
+
+    if (!buffer || buffer->name == name)
+        return;
+
+    pthread_mutex_lock(&trace_lock);
+    buffer->name = name;
+    trace_names[buffer->tid] = name;
+    pthread_mutex_unlock(&trace_lock);
+}
+
+void trace_start(void)
+{
+    pthread_mutex_lock(&trace_lock);
+    if (!trace_key_created)
+        trace_key_created = pthread_key_create(&trace_key, trace_buffer_release) == 0;
+
+    // what was recorded before is left out of the export
+    trace_start_time = trace_clock();
+    trace_active = trace_key_created;
+    pthread_mutex_unlock(&trace_lock);
+}
+
+void trace_stop(void)
+{
+    trace_active = 0;
+}
+
+int trace_export(const char *path)
+{
+    trace_buffer_t *buffer;
+    trace_event_t event;
+    unsigned head, first, i;
+    FILE *fd;
+    int tid;
+
+    fd = fopen(path, "w");
+    if (!fd)
+        return 0;
+
+    pthread_mutex_lock(&trace_lock);
+    fprintf(fd, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+    fprintf(fd, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"sacd\"}}");
+    for (tid = 0; tid < trace_thread_count; tid++)
+    {
+        if (trace_names[tid])
+        {
+            fprintf(fd, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                    tid, trace_names[tid]);
+        }
+    }
+
+    for (buffer = trace_buffers; buffer; buffer = buffer->next)
+    {
+        head  = (unsigned) sysAtomicLoad(&buffer->head);
+        first = head > TRACE_BUFFER_EVENTS ? head - TRACE_BUFFER_EVENTS : 0;
+        for (i = first; i != head; i++)
+        {
+            event = buffer->events[i & (TRACE_BUFFER_EVENTS - 1)];
+
+            // skip what the owning thread may have overwritten while it was copied
+            if ((unsigned) sysAtomicLoad(&buffer->head) - i >= TRACE_BUFFER_EVENTS)
+                continue;
+            if (event.start < trace_start_time)
+                continue;
+
+            fprintf(fd, ",\n{\"name\":\"%s\",\"cat\":\"sacd\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                    "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"arg\":%lld}}",
+                    event.name, event.tid,
+                    (double) (event.start - trace_start_time) / 1000.0, (double) event.duration / 1000.0,
+                    (long long) event.arg);
+        }
+    }
+
+    fprintf(fd, "\n]}\n");
+    pthread_mutex_unlock(&trace_lock);
+
+    return fclose(fd) == 0;
+}
+
+void trace_shutdown(void)
+{
+    trace_buffer_t *buffer;
+
+    trace_active = 0;
+
+    pthread_mutex_lock(&trace_lock);
+    if (trace_key_created)
+    {
+        pthread_key_delete(trace_key);
+        trace_key_created = 0;
+    }
+    while (trace_buffers)
+    {
+        buffer = trace_buffers;
+        trace_buffers = buffer->next;
+        free(buffer);
+    }
+    free((void *) trace_names);
+    trace_names = NULL;
+    trace_thread_count = 0;
+    pthread_mutex_unlock(&trace_lock);
+}
+
+#endif
@@ -0,0 +1,99 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Span tracing of the pipeline, exported as Chrome trace JSON that opens in
+ * Perfetto (ui.perfetto.dev) or chrome://tracing.
+ *
+ * Only built with SACD_TRACE defined, otherwise the macros below compile to
+ * nothing. When built in, a span costs a load and a branch until
+ * trace_start() is called. Every thread records into a buffer of its own
+ * that keeps its last TRACE_BUFFER_EVENTS spans.
+ *
+ *     TRACE_BEGIN(span);
+ *     ...
+ *     TRACE_END(span, "sector read", lsn);
+ *
+ * Span and thread names must be string literals, they are exported as they
+ * are when the trace is written.
+ */
+#ifdef SACD_TRACE
+
+#define TRACE_BUFFER_EVENTS    16384    // a power of two
+
+extern volatile int trace_active;
+
+uint64_t trace_clock(void);
+void trace_record(uint64_t start, const char *name, int64_t arg);
+
+#define TRACE_BEGIN(_span) \
+    uint64_t _span = trace_active ? trace_clock() : 0
+
+#define TRACE_END(_span, _name, _arg) \
+    do { if (_span) trace_record((_span), (_name), (int64_t) (_arg)); } while (0)
+
+#define TRACE_THREAD_NAME(_name) \
+    do { if (trace_active) trace_thread_name(_name); } while (0)
+
+/**
+ * starts recording, dropping what was recorded before
+ */
+void trace_start(void);
+void trace_stop(void);
+
+/**
+ * names the calling thread in the trace
+ */
+void trace_thread_name(const char *name);
+
+/**
+ * writes what the buffers hold to a JSON file, recording goes on meanwhile,
+ * returns 0 when the file can't be written
+ */
+int trace_export(const char *path);
+
+/**
+ * frees the buffers, call once no thread records anymore
+ */
+void trace_shutdown(void);
+
+#else
+
+#define TRACE_BEGIN(_span)
+#define TRACE_END(_span, _name, _arg)
+#define TRACE_THREAD_NAME(_name)
+
+#endif
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif /* __TRACE_H__ */
@@ -28,6 +28,16 @@
 #include <stdint.h>
 #include <ctype.h>
 #include <wchar.h>
+#ifdef __linux__
+#include <sys/sysinfo.h>
+#endif
+#if defined(__APPLE__) || defined(__FreeBSD__)
+#include <sys/types.h>
+#include <sys/sysctl.h>
+#endif
+#if defined(_WIN32)
+#include <pthread.h>
+#endif
 
 #include "utils.h"
 #include "charset.h"
@@ -330,3 +340,20 @@ void print_hex_dump(log_module_level_t level, const char *prefix_str,
 		LOG(lm_main, level, ("%s%s\n", prefix_str, linebuf));
         }
 }
+
+unsigned processor_count(void)
+{
+#if defined(_WIN32)
+    return pthread_num_processors_np();
+#elif defined(__ANDROID__)
+    return 1;
+#elif defined(__linux__)
+    return get_nprocs();
+#elif defined(__APPLE__) || defined(__FreeBSD__)
+    int count;
+    size_t size=sizeof(count);
+    return sysctlbyname("hw.ncpu",&count,&size,NULL,0) ? 1 : count;
+#else
+    return 1;
+#endif
+}
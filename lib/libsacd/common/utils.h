@@ -61,6 +61,9 @@ void print_hex_dump(log_module_level_t level, const char *prefix_str,
                     int rowsize, int groupsize,
                     const void *buf, int len, int ascii);
 
+// the number of processors online, at least 1
+unsigned processor_count(void);
+
 
 #ifdef __cplusplus
 };
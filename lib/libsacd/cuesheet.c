@@ -34,6 +34,7 @@
 #include <utils.h>
 
 #include "cuesheet.h"
+#include "scarletbook_read.h"
 
 static char *cue_escape(const char *src) 
 {
@@ -107,14 +108,14 @@ int write_cue_sheet(scarletbook_handle_t *handle, const char *filename, int area
 
             fprintf(fd, "  TRACK %02d AUDIO\n", track + 1);
             
-            if (handle->area[area].area_track_text[track].track_type_title)
+            if (scarletbook_track_text(handle, area, track, TRACK_TYPE_TITLE))
             {
-                fprintf(fd, "      TITLE \"%s\"\n", cue_escape(handle->area[area].area_track_text[track].track_type_title));
+                fprintf(fd, "      TITLE \"%s\"\n", cue_escape(scarletbook_track_text(handle, area, track, TRACK_TYPE_TITLE)));
             }
 
-            if (handle->area[area].area_track_text[track].track_type_performer)
+            if (scarletbook_track_text(handle, area, track, TRACK_TYPE_PERFORMER))
             {
-                fprintf(fd, "      PERFORMER \"%s\"\n", cue_escape(handle->area[area].area_track_text[track].track_type_performer));
+                fprintf(fd, "      PERFORMER \"%s\"\n", cue_escape(scarletbook_track_text(handle, area, track, TRACK_TYPE_PERFORMER)));
             }
 
             if (*handle->area[area].area_isrc_genre->isrc[track].country_code)
@@ -43,9 +43,11 @@
 #include "endianess.h"
 #include "dsdiff.h"
 #include "scarletbook.h"
+#include "scarletbook_read.h"
 #include "version.h"
 
 #define DSDFIFF_BUFFER_SIZE    1024 * 16
+#define DSDIFF_MAX_IOV         16
 
 typedef struct
 {
@@ -61,6 +63,10 @@ typedef struct
     size_t              frame_indexes_allocated;
 
     int                 edit_master;
+
+    // what the header announces when the file is streamed
+    uint64_t            stream_audio_size;
+    size_t              stream_frame_count;
 } 
 dsdiff_handle_t;
 
@@ -106,6 +112,15 @@ static int calculate_header_and_footer(scarletbook_output_format_t *ft)
     uint8_t          *write_ptr, *prop_ptr;
     scarletbook_handle_t *sb_handle = ft->sb_handle;
     dsdiff_handle_t  *handle = (dsdiff_handle_t *) ft->priv;
+    uint64_t          audio_data_size = handle->audio_data_size;
+    size_t            frame_count = handle->frame_count;
+
+    // a streamed file can't be patched, so it announces its final size up front
+    if (ft->streaming)
+    {
+        audio_data_size = handle->stream_audio_size;
+        frame_count = handle->stream_frame_count;
+    }
 
     if (!handle->header)
         handle->header = (uint8_t *) calloc(DSDFIFF_BUFFER_SIZE, 1);
@@ -249,7 +264,7 @@ static int calculate_header_and_footer(scarletbook_output_format_t *ft)
         dsd_sound_data_chunk_t * dsd_sound_data_chunk;
         dsd_sound_data_chunk                  = (dsd_sound_data_chunk_t *) write_ptr;
         dsd_sound_data_chunk->chunk_id        = DSD_MARKER;
-        dsd_sound_data_chunk->chunk_data_size = CALC_CHUNK_SIZE(handle->audio_data_size);
+        dsd_sound_data_chunk->chunk_data_size = CALC_CHUNK_SIZE(audio_data_size);
 
         write_ptr += CHUNK_HEADER_SIZE;
     }
@@ -266,10 +281,10 @@ static int calculate_header_and_footer(scarletbook_output_format_t *ft)
         dst_frame_information_chunk           = (dst_frame_information_chunk_t *) write_ptr;
         dst_frame_information_chunk->chunk_id = FRTE_MARKER;
         dst_frame_information_chunk->frame_rate = hton16(SACD_FRAME_RATE);
-        dst_frame_information_chunk->num_frames = hton32(handle->frame_count);
+        dst_frame_information_chunk->num_frames = hton32(frame_count);
         dst_frame_information_chunk->chunk_data_size = CALC_CHUNK_SIZE(DST_FRAME_INFORMATION_CHUNK_SIZE - CHUNK_HEADER_SIZE);
 
-        dst_sound_data_chunk->chunk_data_size = CALC_CHUNK_SIZE(handle->audio_data_size + DST_FRAME_INFORMATION_CHUNK_SIZE);
+        dst_sound_data_chunk->chunk_data_size = CALC_CHUNK_SIZE(audio_data_size + DST_FRAME_INFORMATION_CHUNK_SIZE);
         write_ptr += DST_FRAME_INFORMATION_CHUNK_SIZE;
     }
 
@@ -384,7 +399,7 @@ static int calculate_header_and_footer(scarletbook_output_format_t *ft)
             char *c = 0;
 
             if (!handle->edit_master)
-                c = sb_handle->area[ft->area].area_track_text[ft->track].track_type_performer;
+                c = scarletbook_track_text(sb_handle, ft->area, ft->track, TRACK_TYPE_PERFORMER);
 
             if (!c)
             {
@@ -431,7 +446,7 @@ static int calculate_header_and_footer(scarletbook_output_format_t *ft)
             char *c = 0;
 
             if (!handle->edit_master)
-                c = sb_handle->area[ft->area].area_track_text[ft->track].track_type_title;
+                c = scarletbook_track_text(sb_handle, ft->area, ft->track, TRACK_TYPE_TITLE);
 
             if (!c)
             {
@@ -557,8 +572,12 @@ static int calculate_header_and_footer(scarletbook_output_format_t *ft)
         handle->footer_size += CEIL_ODD_NUMBER(id3_ptr - handle->footer - handle->footer_size);
     }
 
+    // nothing may follow the sound data of a streamed file
+    if (ft->streaming)
+        handle->footer_size = 0;
+
     handle->header_size = CEIL_ODD_NUMBER(write_ptr - handle->header);
-    form_dsd_chunk->chunk_data_size = CALC_CHUNK_SIZE(handle->header_size + handle->footer_size + handle->audio_data_size - CHUNK_HEADER_SIZE);
+    form_dsd_chunk->chunk_data_size = CALC_CHUNK_SIZE(handle->header_size + handle->footer_size + audio_data_size - CHUNK_HEADER_SIZE);
 
     return 0;
 }
@@ -569,18 +588,83 @@ static int dsdiff_create_edit_master(scarletbook_output_format_t *ft)
     dsdiff_handle_t *handle = (dsdiff_handle_t *) ft->priv;
     handle->edit_master = 1;
     ret = calculate_header_and_footer(ft);
-    fwrite(handle->header, 1, handle->header_size, ft->fd);
+    output_sink_write(ft->sink, handle->header, handle->header_size);
     return ret;
 }
 
+// Sizes the sound data of a streamed file from the track's TOC. DSD data
+// follows from the duration, DST data is bounded by the sectors it is read
+// from plus the chunk header and pad byte of each frame, and a spare chunk
+// header leaves room to pad up to the announced size in dsdiff_close.
+static void calculate_stream_size(scarletbook_output_format_t *ft)
+{
+    dsdiff_handle_t  *handle = (dsdiff_handle_t *) ft->priv;
+    scarletbook_area_t *area = &ft->sb_handle->area[ft->area];
+
+    handle->stream_frame_count = TIME_FRAMECOUNT(&area->area_tracklist_time->duration[ft->track]);
+
+    if (ft->dsd_encoded_export)
+    {
+        handle->stream_audio_size = (uint64_t) handle->stream_frame_count * FRAME_SIZE_64 * ft->channel_count;
+    }
+    else
+    {
+        handle->stream_audio_size = (uint64_t) ft->length_lsn * SACD_LSN_SIZE
+                                  + (uint64_t) handle->stream_frame_count * (DST_FRAME_DATA_CHUNK_SIZE + 1)
+                                  + CHUNK_HEADER_SIZE;
+    }
+    handle->stream_audio_size = CEIL_ODD_NUMBER(handle->stream_audio_size);
+}
+
 static int dsdiff_create(scarletbook_output_format_t *ft)
 {
-    int ret = calculate_header_and_footer(ft);
+    int ret;
     dsdiff_handle_t  *handle = (dsdiff_handle_t *) ft->priv;
-    fwrite(handle->header, 1, handle->header_size, ft->fd); 
+
+    if (ft->streaming)
+        calculate_stream_size(ft);
+
+    ret = calculate_header_and_footer(ft);
+    output_sink_write(ft->sink, handle->header, handle->header_size); 
+    ft->stream_size = handle->header_size + handle->stream_audio_size;
     return ret;
 }
 
+// Brings a streamed file up to the size its header announced. DSD data is
+// padded with silence, DST data with a chunk readers skip as unknown.
+static void dsdiff_pad_stream(scarletbook_output_format_t *ft)
+{
+    dsdiff_handle_t *handle = (dsdiff_handle_t *) ft->priv;
+    uint8_t          pad[4096];
+    uint64_t         remaining;
+
+    if (handle->audio_data_size >= handle->stream_audio_size)
+        return;
+    remaining = handle->stream_audio_size - handle->audio_data_size;
+
+    if (ft->dsd_encoded_export)
+    {
+        memset(pad, 0x69, sizeof(pad));
+    }
+    else
+    {
+        chunk_header_t fill_chunk;
+        fill_chunk.chunk_id = FILL_MARKER;
+        fill_chunk.chunk_data_size = hton64(remaining - CHUNK_HEADER_SIZE);
+        output_sink_write(ft->sink, (const uint8_t *) &fill_chunk, CHUNK_HEADER_SIZE);
+        remaining -= CHUNK_HEADER_SIZE;
+        memset(pad, 0, sizeof(pad));
+    }
+
+    while (remaining > 0)
+    {
+        size_t len = (size_t) (remaining < sizeof(pad) ? remaining : sizeof(pad));
+        output_sink_write(ft->sink, pad, len);
+        remaining -= len;
+    }
+    handle->audio_data_size = handle->stream_audio_size;
+}
+
 static int dsdiff_close(scarletbook_output_format_t *ft)
 {
     dsdiff_handle_t *handle = (dsdiff_handle_t *) ft->priv;
@@ -588,22 +672,29 @@ static int dsdiff_close(scarletbook_output_format_t *ft)
     if (!handle)
         return 0;
     
-    if (handle->audio_data_size % 2)
+    if (ft->streaming)
     {
-        uint8_t dummy = 0;
-        fwrite(&dummy, 1, 1, ft->fd);
-        handle->audio_data_size += 1;
+        // the header went out with the announced sizes already
+        dsdiff_pad_stream(ft);
     }
+    else
+    {
+        if (handle->audio_data_size % 2)
+        {
+            uint8_t dummy = 0;
+            output_sink_write(ft->sink, &dummy, 1);
+            handle->audio_data_size += 1;
+        }
 
-    // re-calculate the header & footer
-    calculate_header_and_footer(ft);
+        // re-calculate the header & footer
+        calculate_header_and_footer(ft);
 
-    // append the footer
-    fwrite(handle->footer, 1, handle->footer_size, ft->fd);
+        // append the footer
+        output_sink_write(ft->sink, handle->footer, handle->footer_size);
 
-    // write the final header
-    fseek(ft->fd, 0, SEEK_SET);
-    fwrite(handle->header, 1, handle->header_size, ft->fd);
+        // write the final header
+        output_sink_patch(ft->sink, 0, handle->header, handle->header_size);
+    }
 
     if (handle->frame_indexes)
         free(handle->frame_indexes);
@@ -615,56 +706,71 @@ static int dsdiff_close(scarletbook_output_format_t *ft)
     return 0;
 }
 
-static size_t dsdiff_write_frame(scarletbook_output_format_t *ft, const uint8_t *buf, size_t len)
+// the frame goes out as the segments it occupies in the read buffer, a DST
+// frame together with its chunk header and pad byte
+static size_t dsdiff_write_segments(scarletbook_output_format_t *ft, const scarletbook_frame_segment_t *segments, int segment_count)
 {
     dsdiff_handle_t *handle = (dsdiff_handle_t *) ft->priv;
+    output_sink_iovec_t iov[DSDIFF_MAX_IOV];
+    dst_frame_data_chunk_t dst_frame_data_chunk;
+    static const uint8_t dummy = 0;
+    size_t len = 0, nrw = 0;
+    int i, n = 0;
+
+    for (i = 0; i < segment_count; i++)
+        len += segments[i].size;
 
     handle->frame_count++;
 
-    if (ft->dsd_encoded_export)
+    if (!ft->dsd_encoded_export)
     {
-        size_t nrw;
-        nrw = fwrite(buf, 1, len, ft->fd);
-        handle->audio_data_size += nrw;
-        return nrw;
-    }
-    else
-    {
-        dst_frame_data_chunk_t dst_frame_data_chunk;
-        dst_frame_data_chunk.chunk_id = DSTF_MARKER;
-        dst_frame_data_chunk.chunk_data_size = hton64(len);
+        if (handle->frame_count > handle->frame_indexes_allocated)
         {
-            size_t nrw;
+            handle->frame_indexes_allocated += 10000;
+            handle->frame_indexes = (dst_frame_index_t *) realloc(handle->frame_indexes, handle->frame_indexes_allocated * DST_FRAME_INDEX_SIZE);
+        }
 
-            if (handle->frame_count > handle->frame_indexes_allocated)
-            {
-                handle->frame_indexes_allocated += 10000;
-                handle->frame_indexes = (dst_frame_index_t *) realloc(handle->frame_indexes, handle->frame_indexes_allocated * DST_FRAME_INDEX_SIZE);
-            }
+        handle->frame_indexes[handle->frame_count - 1].length = len;
 
-            handle->frame_indexes[handle->frame_count - 1].length = len;
+        handle->frame_indexes[handle->frame_count - 1].offset = output_sink_tell(ft->sink) + DST_FRAME_DATA_CHUNK_SIZE;
 
-#ifdef _WIN32
-            handle->frame_indexes[handle->frame_count - 1].offset = _ftelli64(ft->fd) + DST_FRAME_DATA_CHUNK_SIZE;
-#elif defined(__ANDROID__)
-            handle->frame_indexes[handle->frame_count - 1].offset = ftell(ft->fd) + DST_FRAME_DATA_CHUNK_SIZE;
-#elif defined(__lv2ppu__) || defined(__APPLE__)
-            handle->frame_indexes[handle->frame_count - 1].offset = ftello(ft->fd) + DST_FRAME_DATA_CHUNK_SIZE;
-#else
-            handle->frame_indexes[handle->frame_count - 1].offset = ftello64(ft->fd) + DST_FRAME_DATA_CHUNK_SIZE;
-#endif
+        dst_frame_data_chunk.chunk_id = DSTF_MARKER;
+        dst_frame_data_chunk.chunk_data_size = hton64(len);
+        iov[n].base = &dst_frame_data_chunk;
+        iov[n++].len = DST_FRAME_DATA_CHUNK_SIZE;
+    }
 
-            nrw = fwrite(&dst_frame_data_chunk, 1, DST_FRAME_DATA_CHUNK_SIZE, ft->fd);
-            nrw += fwrite(buf, 1, len, ft->fd);
-            if (len % 2)
-            {
-                uint8_t dummy = 0;
-                nrw += fwrite(&dummy, 1, 1, ft->fd);
-            }
-            handle->audio_data_size += nrw;
-            return nrw;
+    for (i = 0; i <= segment_count; i++)
+    {
+        if (n == DSDIFF_MAX_IOV)
+        {
+            nrw += output_sink_writev(ft->sink, iov, n);
+            n = 0;
+        }
+        if (i < segment_count)
+        {
+            iov[n].base = segments[i].data;
+            iov[n++].len = segments[i].size;
+        }
+        else if (!ft->dsd_encoded_export && len % 2)
+        {
+            iov[n].base = &dummy;
+            iov[n++].len = 1;
         }
     }
+    nrw += output_sink_writev(ft->sink, iov, n);
+
+    handle->audio_data_size += nrw;
+    return nrw;
+}
+
+static size_t dsdiff_write_frame(scarletbook_output_format_t *ft, const uint8_t *buf, size_t len)
+{
+    scarletbook_frame_segment_t segment;
+
+    segment.data = (uint8_t *) buf;
+    segment.size = len;
+    return dsdiff_write_segments(ft, &segment, 1);
 }
 
 scarletbook_format_handler_t const * dsdiff_format_fn(void) 
@@ -675,6 +781,8 @@ scarletbook_format_handler_t const * dsdiff_format_fn(void)
         "dsdiff", 
         dsdiff_create, 
         dsdiff_write_frame,
+        0,
+        dsdiff_write_segments,
         dsdiff_close, 
         OUTPUT_FLAG_DSD | OUTPUT_FLAG_DST,
         sizeof(dsdiff_handle_t)
@@ -690,6 +798,8 @@ scarletbook_format_handler_t const * dsdiff_edit_master_format_fn(void)
         "dsdiff_edit_master", 
         dsdiff_create_edit_master, 
         dsdiff_write_frame,
+        0,
+        dsdiff_write_segments,
         dsdiff_close, 
         OUTPUT_FLAG_DSD | OUTPUT_FLAG_DST | OUTPUT_FLAG_EDIT_MASTER,
         sizeof(dsdiff_handle_t)
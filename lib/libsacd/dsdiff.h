@@ -65,6 +65,7 @@
         #define FRTE_MARKER                    (MAKE_MARKER('F', 'R', 'T', 'E')) // DST Frame Information Chunk
         #define DSTF_MARKER                    (MAKE_MARKER('D', 'S', 'T', 'F')) // DST Frame Data Chunk
         #define DSTC_MARKER                    (MAKE_MARKER('D', 'S', 'T', 'C')) // DST Frame CRC Chunk
+        #define FILL_MARKER                    (MAKE_MARKER('F', 'I', 'L', 'L')) // padding of a streamed file, skipped as unknown chunk
 #define DSTI_MARKER                            (MAKE_MARKER('D', 'S', 'T', 'I')) // DST Sound Index Chunk (optional)
 #define COMT_MARKER                            (MAKE_MARKER('C', 'O', 'M', 'T')) // comments Chunk (optional)
 #define DIIN_MARKER                            (MAKE_MARKER('D', 'I', 'I', 'N')) // Edited Master Information Chunk (optional)
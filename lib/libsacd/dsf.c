@@ -44,6 +44,18 @@
 
 #define DSF_BUFFER_SIZE    2048
 
+#if !defined(NO_SSSE3) && (defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__))
+#define DSF_SSSE3
+#include <tmmintrin.h>
+#if defined(__GNUC__)
+#include <cpuid.h>
+#define SSSE3_TARGET __attribute__ ((target ("ssse3")))
+#else
+#include <intrin.h>
+#define SSSE3_TARGET
+#endif
+#endif
+
 static const uint8_t bit_reverse_table[] = 
 {
     0x00, 0x80, 0x40, 0xc0, 0x20, 0xa0, 0x60, 0xe0, 0x10, 0x90, 0x50, 0xd0, 0x30, 0xb0, 0x70, 0xf0, 
@@ -142,16 +154,17 @@ static int dsf_create_header(scarletbook_output_format_t *ft)
     dsd_chunk->total_file_size = htole64(meh+handle->header_size);//htole64(handle->header_size + handle->audio_data_size + handle->footer_size);
     dsd_chunk->metadata_offset = htole64(handle->footer_size ? handle->header_size + handle->audio_data_size : 0);
 
-    if (ft->fd)
-      fwrite(handle->header, 1, handle->header_size, ft->fd);
-
     return 0;
 }
 
 
 static int dsf_create(scarletbook_output_format_t *ft)
 {
-    return dsf_create_header(ft);
+    dsf_handle_t *handle = (dsf_handle_t *) ft->priv;
+    int ret = dsf_create_header(ft);
+
+    output_sink_write(ft->sink, handle->header, handle->header_size);
+    return ret;
 }
 
 static int dsf_close(scarletbook_output_format_t *ft)
@@ -164,9 +177,9 @@ static int dsf_close(scarletbook_output_format_t *ft)
     {
 	if (handle->buffer_ptr[i] > handle->buffer[i]) {
 	    handle->sample_count += handle->buffer_ptr[i] - handle->buffer[i];
+	    memset(handle->buffer_ptr[i], 0, handle->buffer[i] + SACD_BLOCK_SIZE_PER_CHANNEL - handle->buffer_ptr[i]);
 
-	    fwrite(handle->buffer[i], 1, SACD_BLOCK_SIZE_PER_CHANNEL, ft->fd);
-	    memset(handle->buffer[i], 0, SACD_BLOCK_SIZE_PER_CHANNEL);
+	    output_sink_write(ft->sink, handle->buffer[i], SACD_BLOCK_SIZE_PER_CHANNEL);
 
 	    handle->buffer_ptr[i] = handle->buffer[i];
 	    handle->audio_data_size += SACD_BLOCK_SIZE_PER_CHANNEL;
@@ -174,11 +187,11 @@ static int dsf_close(scarletbook_output_format_t *ft)
     }
 
     // write the footer
-    fwrite(handle->footer, 1, handle->footer_size, ft->fd);
-    fseek(ft->fd, 0, SEEK_SET);
+    output_sink_write(ft->sink, handle->footer, handle->footer_size);
     
     // write the final header
     dsf_create_header(ft);
+    output_sink_patch(ft->sink, 0, handle->header, handle->header_size);
 
     if (handle->header)
         free(handle->header);
@@ -188,48 +201,285 @@ static int dsf_close(scarletbook_output_format_t *ft)
     return 0;
 }
 
+// de-interleave n samples of every channel from buf into the channel
+// buffers, reversing the bits of each byte (scalar version)
+static void deinterleave_scalar(dsf_handle_t *handle, const uint8_t *buf, size_t start, size_t n)
+{
+    const int channel_count = handle->channel_count;
+    size_t s;
+    int i;
+
+    for (s = start; s < n; s++)
+    {
+        for (i = 0; i < channel_count; i++)
+        {
+            handle->buffer_ptr[i][s] = bit_reverse_table[buf[s * channel_count + i]];
+        }
+    }
+}
+
+#ifdef DSF_SSSE3
+// same, 16 samples per channel at a time -- the channel_count vectors
+// holding them are gathered into one vector per channel with a shuffle of
+// each, then the bits are reversed by looking up both nibbles
+static SSSE3_TARGET size_t deinterleave_ssse3(dsf_handle_t *handle, const uint8_t *buf, size_t n)
+{
+    const int channel_count = handle->channel_count;
+    const __m128i nibble_mask = _mm_set1_epi8(0x0f);
+    const __m128i reverse_lo = _mm_setr_epi8(0x00, (char) 0x80, 0x40, (char) 0xc0, 0x20, (char) 0xa0, 0x60, (char) 0xe0,
+                                             0x10, (char) 0x90, 0x50, (char) 0xd0, 0x30, (char) 0xb0, 0x70, (char) 0xf0);
+    const __m128i reverse_hi = _mm_setr_epi8(0x00, 0x08, 0x04, 0x0c, 0x02, 0x0a, 0x06, 0x0e,
+                                             0x01, 0x09, 0x05, 0x0d, 0x03, 0x0b, 0x07, 0x0f);
+    __m128i in[MAX_CHANNEL_COUNT];
+    __m128i x, lo, hi;
+    size_t s;
+    int i, j;
+
+    for (s = 0; s + 16 <= n; s += 16)
+    {
+        for (j = 0; j < channel_count; j++)
+        {
+            in[j] = _mm_loadu_si128((const __m128i *) (buf + s * channel_count + j * 16));
+        }
+        for (i = 0; i < channel_count; i++)
+        {
+            x = _mm_shuffle_epi8(in[0], _mm_loadu_si128((const __m128i *) handle->shuffle[i][0]));
+            for (j = 1; j < channel_count; j++)
+            {
+                x = _mm_or_si128(x, _mm_shuffle_epi8(in[j], _mm_loadu_si128((const __m128i *) handle->shuffle[i][j])));
+            }
+            lo = _mm_shuffle_epi8(reverse_lo, _mm_and_si128(x, nibble_mask));
+            hi = _mm_shuffle_epi8(reverse_hi, _mm_and_si128(_mm_srli_epi16(x, 4), nibble_mask));
+            _mm_storeu_si128((__m128i *) (handle->buffer_ptr[i] + s), _mm_or_si128(lo, hi));
+        }
+    }
+    return s;
+}
+
+static int cpu_has_ssse3(void)
+{
+#if defined(__GNUC__)
+    unsigned int a, b, c, d;
+
+    if (!__get_cpuid(1, &a, &b, &c, &d))
+        return 0;
+    return (c & (1 << 9)) != 0;
+#else
+    int CPUInfo[4];
+
+    __cpuid(CPUInfo, 1);
+    return (CPUInfo[2] & (1 << 9)) != 0;
+#endif
+}
+#endif
+
+// pick the de-interleave kernel and set up its shuffles for the channel count
+static void setup_deinterleave(dsf_handle_t *handle)
+{
+#ifdef DSF_SSSE3
+    int i, j, s, pos;
+
+    // sample s of channel i is byte pos of the frame, found in vector
+    // pos / 16 of the input, the other vectors must not contribute
+    for (i = 0; i < handle->channel_count; i++)
+    {
+        for (j = 0; j < handle->channel_count; j++)
+        {
+            for (s = 0; s < 16; s++)
+            {
+                pos = s * handle->channel_count + i;
+                handle->shuffle[i][j][s] = pos / 16 == j ? (uint8_t) (pos % 16) : 0x80;
+            }
+        }
+    }
+    handle->ssse3 = cpu_has_ssse3();
+#endif
+    handle->shuffle_channel_count = handle->channel_count;
+}
+
+// write the blocks of all channels once they are full
+static void dsf_flush_blocks(scarletbook_output_format_t *ft, dsf_handle_t *handle)
+{
+    output_sink_iovec_t iov[MAX_CHANNEL_COUNT];
+    int i;
+
+    for (i = 0; i < handle->channel_count; i++)
+    {
+        iov[i].base = handle->buffer[i];
+        iov[i].len = SACD_BLOCK_SIZE_PER_CHANNEL;
+
+        handle->sample_count += SACD_BLOCK_SIZE_PER_CHANNEL;
+        handle->buffer_ptr[i] = handle->buffer[i];
+        handle->audio_data_size += SACD_BLOCK_SIZE_PER_CHANNEL;
+    }
+    output_sink_writev(ft->sink, iov, handle->channel_count);
+}
+
+// same, when the last n bytes of each block come from a planar frame (a
+// block per channel, channel_len apart) -- they are copied straight into a
+// span of the sink, only what the channel buffers held before goes along
+static void dsf_flush_planar_blocks(scarletbook_output_format_t *ft, dsf_handle_t *handle, const uint8_t *buf, size_t channel_len, size_t fill)
+{
+    size_t size = (size_t) handle->channel_count * SACD_BLOCK_SIZE_PER_CHANNEL;
+    size_t n = SACD_BLOCK_SIZE_PER_CHANNEL - fill;
+    uint8_t *span = output_sink_reserve(ft->sink, size);
+    int i;
+
+    if (!span)
+    {
+        for (i = 0; i < handle->channel_count; i++)
+        {
+            memcpy(handle->buffer_ptr[i], buf + i * channel_len, n);
+        }
+        dsf_flush_blocks(ft, handle);
+        return;
+    }
+
+    for (i = 0; i < handle->channel_count; i++)
+    {
+        memcpy(span + i * SACD_BLOCK_SIZE_PER_CHANNEL, handle->buffer[i], fill);
+        memcpy(span + i * SACD_BLOCK_SIZE_PER_CHANNEL + fill, buf + i * channel_len, n);
+
+        handle->sample_count += SACD_BLOCK_SIZE_PER_CHANNEL;
+        handle->buffer_ptr[i] = handle->buffer[i];
+        handle->audio_data_size += SACD_BLOCK_SIZE_PER_CHANNEL;
+    }
+    output_sink_commit(ft->sink, span, size);
+}
+
+// the frame is interleaved with the bits MSB first, it is moved into the
+// channel buffers a block at a time, as much as fits before they are full
 static size_t dsf_write_frame(scarletbook_output_format_t *ft, const uint8_t *buf, size_t len)
 {
     dsf_handle_t *handle = (dsf_handle_t *) ft->priv;
-    const uint8_t *buf_end_ptr = buf + len;
-    const uint8_t *buf_ptr = buf;
+    size_t channel_len = len / handle->channel_count;
+    size_t pos = 0, fill, n, done;
     uint64_t prev_audio_data_size = handle->audio_data_size;
     int i;
 
-    int64_t datapos=0;
-    while(buf_ptr < buf_end_ptr)
+    if (handle->shuffle_channel_count != handle->channel_count)
+        setup_deinterleave(handle);
+
+    while (pos < channel_len)
     {
+        // all channels are filled in lockstep
+        fill = handle->buffer_ptr[0] ? (size_t) (handle->buffer_ptr[0] - handle->buffer[0]) : 0;
+        n = SACD_BLOCK_SIZE_PER_CHANNEL - fill;
+        if (n > channel_len - pos)
+            n = channel_len - pos;
+
         for (i = 0; i < handle->channel_count; i++)
         {
             if (!handle->buffer_ptr[i])
             {
                 handle->buffer_ptr[i] = handle->buffer[i];
             }
+        }
 
-            if (handle->buffer_ptr[i] < handle->buffer[i] + SACD_BLOCK_SIZE_PER_CHANNEL && 
-                handle->buffer_ptr[i] < handle->buffer[i] + len / handle->channel_count)
-            {
-                *handle->buffer_ptr[i] = bit_reverse_table[*buf_ptr];
+        done = 0;
+#ifdef DSF_SSSE3
+        if (handle->ssse3)
+            done = deinterleave_ssse3(handle, buf + pos * handle->channel_count, n);
+#endif
+        deinterleave_scalar(handle, buf + pos * handle->channel_count, done, n);
+
+        for (i = 0; i < handle->channel_count; i++)
+        {
+            handle->buffer_ptr[i] += n;
+        }
+        pos += n;
+
+        if (fill + n == SACD_BLOCK_SIZE_PER_CHANNEL)
+            dsf_flush_blocks(ft, handle);
+    }
 
-                handle->buffer_ptr[i]++;
-                buf_ptr++;
-            } else {
-              handle->sample_count += handle->buffer_ptr[i] - handle->buffer[i];
+    return (size_t) (handle->audio_data_size - prev_audio_data_size);
+}
 
-              memcpy(handle->data+datapos, handle->buffer[i], SACD_BLOCK_SIZE_PER_CHANNEL);
-              datapos += SACD_BLOCK_SIZE_PER_CHANNEL;
-/*            fwrite(handle->buffer[i], 1, SACD_BLOCK_SIZE_PER_CHANNEL, ft->fd);*/
-              memset(handle->buffer[i], 0, SACD_BLOCK_SIZE_PER_CHANNEL);
+// the DST decoder hands over a block per channel with the bits already in
+// DSF order, so the frames are copied as they are -- into the sink when they
+// complete a block, otherwise into the channel buffers
+static size_t dsf_write_planar_frame(scarletbook_output_format_t *ft, const uint8_t *buf, size_t len)
+{
+    dsf_handle_t *handle = (dsf_handle_t *) ft->priv;
+    size_t channel_len = len / handle->channel_count;
+    size_t pos = 0, fill, n;
+    uint64_t prev_audio_data_size = handle->audio_data_size;
+    int i;
 
-              handle->buffer_ptr[i] = handle->buffer[i];
-              handle->audio_data_size += SACD_BLOCK_SIZE_PER_CHANNEL;
-          }
+    while (pos < channel_len)
+    {
+        // all channels are filled in lockstep
+        fill = handle->buffer_ptr[0] ? (size_t) (handle->buffer_ptr[0] - handle->buffer[0]) : 0;
+        n = SACD_BLOCK_SIZE_PER_CHANNEL - fill;
+        if (n > channel_len - pos)
+            n = channel_len - pos;
+
+        for (i = 0; i < handle->channel_count; i++)
+        {
+            if (!handle->buffer_ptr[i])
+            {
+                handle->buffer_ptr[i] = handle->buffer[i];
+            }
+        }
+
+        if (fill + n == SACD_BLOCK_SIZE_PER_CHANNEL)
+            dsf_flush_planar_blocks(ft, handle, buf + pos, channel_len, fill);
+        else
+        {
+            for (i = 0; i < handle->channel_count; i++)
+            {
+                memcpy(handle->buffer_ptr[i], buf + i * channel_len + pos, n);
+                handle->buffer_ptr[i] += n;
+            }
         }
+        pos += n;
     }
 
     return (size_t) (handle->audio_data_size - prev_audio_data_size);
 }
 
+// the frame is taken from the read buffer as it is, only a sample that is
+// split over two segments is put together first
+static size_t dsf_write_segments(scarletbook_output_format_t *ft, const scarletbook_frame_segment_t *segments, int segment_count)
+{
+    dsf_handle_t *handle = (dsf_handle_t *) ft->priv;
+    size_t written = 0, pos, n;
+    int i;
+
+    for (i = 0; i < segment_count; i++)
+    {
+        const uint8_t *buf = segments[i].data;
+        size_t len = segments[i].size;
+
+        pos = 0;
+        if (handle->pending_size > 0)
+        {
+            n = handle->channel_count - handle->pending_size;
+            if (n > len)
+                n = len;
+            memcpy(handle->pending + handle->pending_size, buf, n);
+            handle->pending_size += (int) n;
+            pos = n;
+
+            if (handle->pending_size < handle->channel_count)
+                continue;
+            written += dsf_write_frame(ft, handle->pending, handle->channel_count);
+            handle->pending_size = 0;
+        }
+
+        n = (len - pos) / handle->channel_count * handle->channel_count;
+        if (n > 0)
+            written += dsf_write_frame(ft, buf + pos, n);
+        pos += n;
+
+        memcpy(handle->pending, buf + pos, len - pos);
+        handle->pending_size = (int) (len - pos);
+    }
+
+    return written;
+}
+
 scarletbook_format_handler_t const * dsf_format_fn(void) 
 {
     static scarletbook_format_handler_t handler = 
@@ -238,6 +488,8 @@ scarletbook_format_handler_t const * dsf_format_fn(void)
         "dsf", 
         dsf_create, 
         dsf_write_frame,
+        dsf_write_planar_frame,
+        dsf_write_segments,
         dsf_close, 
         OUTPUT_FLAG_DSD,
         sizeof(dsf_handle_t)
@@ -149,7 +149,14 @@ typedef struct
     uint8_t             buffer[MAX_CHANNEL_COUNT][SACD_BLOCK_SIZE_PER_CHANNEL];
     uint8_t            *buffer_ptr[MAX_CHANNEL_COUNT];
 
-    uint8_t            *data;
+    // de-interleaving, set up on the first frame
+    int                 shuffle_channel_count;
+    int                 ssse3;
+    uint8_t             shuffle[MAX_CHANNEL_COUNT][MAX_CHANNEL_COUNT][16];
+
+    // a sample split over two frame segments
+    uint8_t             pending[MAX_CHANNEL_COUNT];
+    int                 pending_size;
 } 
 dsf_handle_t;
 
@@ -154,3 +154,124 @@ int CCP_CalcInit(CodedTable *CT)
 }
 
 
+/***************************************************************************/
+/*                                                                         */
+/* name     : RiceLength                                                   */
+/*                                                                         */
+/* function : Number of bits of the Rice code of a number, as RiceEncode() */
+/*            writes it.                                                   */
+/*                                                                         */
+/* pre      : x, m                                                         */
+/*                                                                         */
+/* post     : Returns the length of the Rice code                          */
+/*                                                                         */
+/***************************************************************************/
+
+static int RiceLength(int x, int m)
+{
+  int  Nr = (x < 0) ? -x : x;
+
+  return (Nr >> m) + 1 + m + ((Nr != 0) ? 1 : 0);
+}
+
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : CCP_CalcCoding                                               */
+/*                                                                         */
+/* function : Choose between plain and Rice coding of the coefficients of  */
+/*            a filter or the entries of a Ptable, by the method and m     */
+/*            that take the fewest bits.                                   */
+/*                                                                         */
+/* pre      : CT->TableType, CT->CPredOrder[], CT->CPredCoef[][],          */
+/*            TableNr, Values[] (coefficients or Ptable entries), Len      */
+/*                                                                         */
+/* post     : CT->Coded[], CT->BestMethod[], CT->m[][], CT->Data[][]       */
+/*            (the Rice coded residuals), CT->DataLen[],                   */
+/*            returns the number of bits the table takes in the stream     */
+/*            (the "Coded" bit included, the length field excluded)        */
+/*                                                                         */
+/***************************************************************************/
+
+int CCP_CalcCoding(CodedTable *CT, int TableNr, const int *Values, int Len)
+{
+  int  BestBits;
+  int  Bits;
+  int  CoefNr;
+  int  m;
+  int  MaxM;
+  int  Method;
+  int  NrOfMethods;
+  int  RawBits;
+  int  TapNr;
+  int  x;
+  int  Residual[1 << SIZE_CODEDPREDORDER];
+
+  if (CT->TableType == FILTER)
+  {
+    RawBits     = SIZE_PREDCOEF;
+    MaxM        = MAX_RICE_M_F;
+    NrOfMethods = NROFFRICEMETHODS;
+  }
+  else
+  {
+    RawBits     = AC_BITS - 1;
+    MaxM        = MAX_RICE_M_P;
+    NrOfMethods = NROFPRICEMETHODS;
+  }
+
+  /* plain coding */
+  CT->Coded[TableNr]      = 0;
+  CT->BestMethod[TableNr] = -1;
+  CT->DataLen[TableNr]    = Len;
+  BestBits                = 1 + Len * RawBits;
+
+  for (Method = 0; Method < NrOfMethods; Method++)
+  {
+    if (CT->CPredOrder[Method] >= Len)
+    {
+      continue;
+    }
+
+    /* the residuals the decoder adds its prediction to */
+    for (CoefNr = CT->CPredOrder[Method]; CoefNr < Len; CoefNr++)
+    {
+      for (TapNr = 0, x = 0; TapNr < CT->CPredOrder[Method]; TapNr++)
+      {
+        x += CT->CPredCoef[Method][TapNr] * Values[CoefNr - TapNr - 1];
+      }
+
+      if (x >= 0)
+      {
+        Residual[CoefNr] = Values[CoefNr] + (x + 4) / 8;
+      }
+      else
+      {
+        Residual[CoefNr] = Values[CoefNr] - (-x + 3) / 8;
+      }
+    }
+
+    for (m = 0; m <= MaxM; m++)
+    {
+      Bits = 1 + SIZE_RICEMETHOD + CT->CPredOrder[Method] * RawBits + SIZE_RICEM;
+      for (CoefNr = CT->CPredOrder[Method]; CoefNr < Len && Bits < BestBits; CoefNr++)
+      {
+        Bits += RiceLength(Residual[CoefNr], m);
+      }
+
+      if (Bits < BestBits)
+      {
+        BestBits                = Bits;
+        CT->Coded[TableNr]      = 1;
+        CT->BestMethod[TableNr] = Method;
+        CT->m[TableNr][Method]  = m;
+        for (CoefNr = CT->CPredOrder[Method]; CoefNr < Len; CoefNr++)
+        {
+          CT->Data[TableNr][CoefNr] = Residual[CoefNr];
+        }
+      }
+    }
+  }
+
+  return BestBits;
+}
@@ -64,6 +64,7 @@ Changes:
 #include "types.h"
 
 int CCP_CalcInit(CodedTable *CT);
+int CCP_CalcCoding(CodedTable *CT, int TableNr, const int *Values, int Len);
 
 
 #endif  /* __CCP_CALC_H_INCLUDED */
@@ -134,6 +134,10 @@ Changes:
 #define MIN_FSEG_LEN        1024  /* min segment length in bits of filters      */
 #define MIN_PSEG_LEN        32    /* min segment length in bits of Ptables      */
 
+/* ENCODER */
+#define MIN_EFFORT          1     /* fastest encoding                           */
+#define MAX_EFFORT          9     /* smallest frames                            */
+
 /* DSTXBITS */
 #define MAX_DSTXBITS_SIZE   256
 
@@ -164,6 +168,7 @@ enum DST_ErrorCodes
     DSTErr_InvalidStuffingPattern,
     DSTErr_InvalidArithmeticCode,
     DSTErr_ArithmeticDecoder,
+    DSTErr_FrameTooLarge,
     DSTErr_MaxError,
 };
 
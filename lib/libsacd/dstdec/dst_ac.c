@@ -184,6 +184,91 @@ void DST_ACDecodeBit(ACData *AC, unsigned char *b, int p, unsigned char *cb,
   }
 }
 
+/***************************************************************************/
+/*                                                                         */
+/* name     : DST_ACEncodeBit                                              */
+/*                                                                         */
+/* function : Arithmetic encode one bit, the counterpart of                */
+/*            DST_ACDecodeBit().                                           */
+/*                                                                         */
+/* pre      : b       : bit to encode                                      */
+/*            p       : probability for next bit being a "zero"            */
+/*            cb[]    : room for the arithmetic code bit(s)                */
+/*            Flush   : 0 = Normal operation,                              */
+/*                      1 = flush remainder of the encoder                 */
+/*                                                                         */
+/* post     : cb[]    : arithmetic code bits, cb[0] is the stuffing bit    */
+/*            *fs     : length of the arithmetic code (after a flush)      */
+/*                                                                         */
+/***************************************************************************/
+
+void DST_ACEncodeBit(ACData *AC, unsigned char b, int p, unsigned char *cb,
+                     int *fs, int Flush)
+{
+  unsigned int         ap;
+  unsigned int         h;
+  int                  i;
+
+  if (AC->Init == 1)
+  {
+    AC->Init  = 0;
+    AC->A     = ONE - 1;
+    AC->C     = 0;
+    cb[0]     = 0;
+    AC->cbptr = 1;
+  }
+
+  if (Flush == 0)
+  {
+    /* approximate (A * p) with "partial rounding", as the decoder does. */
+    ap = ((AC->A >> PBITS) | ((AC->A >> (PBITS - 1)) & 1)) * p;
+
+    h = AC->A - ap;
+    if (b == 0)
+    {
+      AC->C += h;
+      AC->A  = ap;
+    }
+    else
+    {
+      AC->A  = h;
+    }
+
+    /* propagate a carry out of the C register into the code bits written,
+       it never reaches the stuffing bit */
+    if (AC->C >= ONE)
+    {
+      AC->C -= ONE;
+      for (i = AC->cbptr - 1; cb[i] == 1; i--)
+      {
+        cb[i] = 0;
+      }
+      cb[i] = 1;
+    }
+    while (AC->A < HALF)
+    {
+      AC->A <<= 1;
+      cb[AC->cbptr++] = (unsigned char) ((AC->C >> (ABITS - 1)) & 1);
+      AC->C = (AC->C << 1) & (ONE - 1);
+    }
+  }
+  else
+  {
+    /* write out the C register, leaving out the trailing zeros as the
+       decoder inserts zeros when reading past the end of the code */
+    for (i = ABITS - 1; i >= 0; i--)
+    {
+      cb[AC->cbptr++] = (unsigned char) ((AC->C >> i) & 1);
+    }
+    while ((AC->cbptr > 1) && (cb[AC->cbptr - 1] == 0))
+    {
+      AC->cbptr--;
+    }
+    *fs = AC->cbptr;
+    AC->Init = 1;
+  }
+}
+
 #undef PBITS
 #undef NBITS
 #undef PSUM
@@ -67,6 +67,7 @@ Changes:
 /*============================================================================*/
 
 void DST_ACDecodeBit(ACData *AC, unsigned char *b, int p, unsigned char *cb, int fs, int flush);
+void DST_ACEncodeBit(ACData *AC, unsigned char b, int p, unsigned char *cb, int *fs, int flush);
 
 int DST_ACGetPtableIndex(long PredicVal, int PtableLen);
 
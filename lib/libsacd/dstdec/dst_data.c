@@ -77,6 +77,7 @@ Changes:
  ***********************************************************************/
 
 int getbits(StrData* S, long *outword, int out_bitptr);
+int putbits(StrData* S, long inword, int in_bitptr);
 
 
 /***********************************************************************
@@ -443,3 +444,143 @@ int get_in_bitcount(StrData* SD)
 }
 
 
+/***********************************************************************
+ * SetWriteBuffer
+ ***********************************************************************/
+
+int SetWriteBuffer(StrData* SD, uint8_t* pBuf, int32_t Size)
+{
+  int hr = 0;
+
+  /* the buffer belongs to the caller, it is not freed by DeleteBuffer */
+  SD->pDSTdata   = pBuf;
+  SD->TotalBytes = Size;
+
+  ResetReadingIndex(SD);
+
+  return (hr);
+}
+
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : FIO_BitPutIntUnsigned                                        */
+/*                                                                         */
+/* function : Write an integer as an unsigned number to file with a        */
+/*            given number of bits.                                        */
+/*                                                                         */
+/* pre      : Len, x, buffer set by SetWriteBuffer                         */
+/*                                                                         */
+/* post     : The Len LSBs of x are appended to the buffer, returns -1     */
+/*            if the buffer is full                                        */
+/*                                                                         */
+/* uses     : stdio.h, stdlib.h                                            */
+/*                                                                         */
+/***************************************************************************/
+
+int FIO_BitPutIntUnsigned(StrData* SD, int Len, int x)
+{
+  int   return_value;
+
+  return_value = -1;
+  if (Len > 0)
+  {
+    return_value = putbits(SD, (long)x, Len);
+  }
+  else if (Len == 0)
+  {
+    return_value = 0;
+  }
+  else
+  {
+    fprintf(stderr, "\nERROR: a negative number of bits allocated\n");
+  }
+  return return_value;
+}
+
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : FIO_BitPutIntSigned                                          */
+/*                                                                         */
+/* function : Write an integer as a signed number (2's complement) to file */
+/*            with a given number of bits.                                 */
+/*                                                                         */
+/* pre      : Len, x, buffer set by SetWriteBuffer                         */
+/*                                                                         */
+/* post     : The Len LSBs of x are appended to the buffer, returns -1     */
+/*            if the buffer is full                                        */
+/*                                                                         */
+/* uses     : stdio.h, stdlib.h                                            */
+/*                                                                         */
+/***************************************************************************/
+
+int FIO_BitPutIntSigned(StrData* SD, int Len, int x)
+{
+  if (Len > 0 && Len < 32)
+  {
+    x &= (1 << Len) - 1;
+  }
+  return FIO_BitPutIntUnsigned(SD, Len, x);
+}
+
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : putbits                                                      */
+/*                                                                         */
+/* function : Write bits to the bitstream, MSB first.                      */
+/*                                                                         */
+/* pre      : inword, in_bitptr                                            */
+/*                                                                         */
+/* post     : m_ByteCounter, returns EOF when the buffer is full or 0      */
+/*            otherwise.                                                   */
+/*                                                                         */
+/* uses     : stdio.h                                                      */
+/*                                                                         */
+/***************************************************************************/
+
+int putbits(StrData* SD, long inword, int in_bitptr)
+{
+    while (in_bitptr > 0)
+    {
+        int thisbits;
+
+        if (!SD->BitPosition)
+        {
+            if (SD->ByteCounter >= SD->TotalBytes)
+            {
+                return (-1); /* EOF */
+            }
+            SD->pDSTdata[SD->ByteCounter++] = 0;
+            SD->BitPosition = 8;
+        }
+
+        thisbits = MIN(SD->BitPosition, in_bitptr);
+        SD->pDSTdata[SD->ByteCounter - 1] |= (uint8_t)(((inword >> (in_bitptr - thisbits)) & masks[thisbits]) << (SD->BitPosition - thisbits));
+
+        in_bitptr -= thisbits;
+        SD->BitPosition -= thisbits;
+    }
+
+    return 0;
+}
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : get_out_bitcount                                             */
+/*                                                                         */
+/* function : Number of bits written.                                      */
+/*                                                                         */
+/* pre      : None                                                         */
+/*                                                                         */
+/* post     : Returns the number of bits written after a SetWriteBuffer.   */
+/*                                                                         */
+/* uses     : -                                                            */
+/*                                                                         */
+/***************************************************************************/
+
+int get_out_bitcount(StrData* SD)
+{
+  return SD->ByteCounter * 8 - SD->BitPosition;
+}
@@ -86,6 +86,11 @@ int FIO_BitGetIntSigned(StrData* SD, int Len, int *x);
 int FIO_BitGetShortSigned(StrData* SD, int Len, short *x);
 int get_in_bitcount(StrData* SD);
 
+int SetWriteBuffer(StrData* SD, uint8_t* pBuf, int32_t Size);
+int FIO_BitPutIntUnsigned(StrData* SD, int Len, int x);
+int FIO_BitPutIntSigned(StrData* SD, int Len, int x);
+int get_out_bitcount(StrData* SD);
+
 int CreateBuffer(StrData* SD, int32_t Size);
 int DeleteBuffer(StrData* SD);
 
@@ -53,176 +53,536 @@
 #endif
 #include <pthread.h>
 #include <string.h>
-#ifdef __linux__
-#include <sys/sysinfo.h>
-#endif
-#if !defined(_WIN32)
-#include <unistd.h>
-#endif
 
 #include <logging.h>
+#include <utils.h>
+#include <timeout.h>
+#include <trace.h>
 
 #include "dst_decoder.h"
 #include "yarn.h"
-#include "buffer_pool.h"
 #include "dst_fram.h"
 #include "dst_init.h"
 
-#ifdef __APPLE__
-#include <sys/sysctl.h>
-#endif
-
 /* -- parallel decoding -- */
 
-static unsigned processor_count(void)
+/* number of jobs the decode ring holds (a power of two) */
+#define POOL_RING_SIZE 1024
+
+/* duration of a frame in seconds, SACD has 75 frames per second */
+#define FRAME_PERIOD (1.0 / 75)
+
+/* frames decoded inline before the auto mode looks at the decoding time */
+#define INLINE_PROBE_FRAMES 16
+
+/* DSD silence, with the first sample in the MSB */
+#define DSD_SILENCE 0x69
+
+/* -- doorbells -- */
+
+static void doorbell_create(doorbell_t *db)
+{
+    db->bell = new_lock(0);
+    sysAtomicStore(&db->sleepers, 0);
+}
+
+static void doorbell_free(doorbell_t *db)
+{
+    free_lock(db->bell);
+    db->bell = NULL;
+}
+
+/* call attempt(arg) until it returns true, sleeping on the doorbell in
+   between -- the sleeper count is raised before the final attempt, so a
+   thread that makes the condition true and then sees no sleepers cannot have
+   raced with one */
+static void doorbell_wait(doorbell_t *db, int (*attempt)(void *), void *arg)
+{
+    long rung;
+
+    while (!attempt(arg))
+    {
+        possess(db->bell);
+        rung = peek_lock(db->bell);
+        sysAtomicFetchAndAdd(&db->sleepers, 1);
+        if (attempt(arg))
+        {
+            sysAtomicFetchAndAdd(&db->sleepers, -1);
+            release(db->bell);
+            return;
+        }
+        wait_for(db->bell, NOT_TO_BE, rung);
+        sysAtomicFetchAndAdd(&db->sleepers, -1);
+        release(db->bell);
+    }
+}
+
+/* wake the sleepers of a doorbell (call after making their condition true) */
+static void doorbell_ring(doorbell_t *db)
+{
+    if (sysAtomicLoad(&db->sleepers) > 0)
+    {
+        possess(db->bell);
+        twist(db->bell, BY, +1);
+    }
+}
+
+/* -- decode ring -- */
+
+/* bounded multi-producer, multi-consumer ring of jobs (after Dmitry Vyukov)
+   -- each cell carries a sequence number that tells whether it is ready to be
+   filled by a producer or emptied by a consumer at a given position, so
+   putting and taking a job costs a compare-and-swap and no lock */
+typedef struct ring_cell_t
 {
-#if defined(_WIN32)
-    return pthread_num_processors_np();
-#elif defined(__ANDROID__)
+    atomic_t sequence;
+    job_t *job;
+} ring_cell_t;
+
+static ring_cell_t pool_ring[POOL_RING_SIZE];
+static atomic_t pool_ring_head;         /* next position to take a job from */
+static atomic_t pool_ring_tail;         /* next position to put a job at */
+
+/* distance between two ring positions, which wrap around */
+#define RING_DIFF(a, b) ((int) ((unsigned int) (a) - (unsigned int) (b)))
+#define RING_NEXT(a, n) ((int) ((unsigned int) (a) + (unsigned int) (n)))
+
+static void ring_setup(void)
+{
+    int i;
+
+    for (i = 0; i < POOL_RING_SIZE; i++)
+    {
+        sysAtomicStore(&pool_ring[i].sequence, i);
+        pool_ring[i].job = NULL;
+    }
+    sysAtomicStore(&pool_ring_head, 0);
+    sysAtomicStore(&pool_ring_tail, 0);
+}
+
+/* put a job in the ring, return false if the ring is full */
+static int ring_push(void *arg)
+{
+    ring_cell_t *cell;
+    int pos, diff;
+
+    pos = sysAtomicLoad(&pool_ring_tail);
+    for (;;)
+    {
+        cell = &pool_ring[pos & (POOL_RING_SIZE - 1)];
+        diff = RING_DIFF(sysAtomicLoad(&cell->sequence), pos);
+        if (diff == 0)
+        {
+            if (sysAtomicCompareAndSwap(&pool_ring_tail, pos, RING_NEXT(pos, 1)))
+                break;
+            pos = sysAtomicLoad(&pool_ring_tail);
+        }
+        else if (diff < 0)
+            return 0;
+        else
+            pos = sysAtomicLoad(&pool_ring_tail);
+    }
+    cell->job = (job_t *) arg;
+    sysAtomicStore(&cell->sequence, RING_NEXT(pos, 1));
     return 1;
-#elif defined(__linux__)
-    return get_nprocs();
-#elif defined(__APPLE__) || defined(__FreeBSD__)
-    int count;
-    size_t size=sizeof(count);
-    return sysctlbyname("hw.ncpu",&count,&size,NULL,0) ? 1 : count;
-#endif
 }
 
-/* setup job lists (call from main thread) */
-static void setup_decoding_jobs(dst_decoder_t *dst_decoder)
+/* take a job from the ring into *arg, return false if the ring is empty */
+static int ring_pop(void *arg)
+{
+    ring_cell_t *cell;
+    int pos, diff;
+
+    pos = sysAtomicLoad(&pool_ring_head);
+    for (;;)
+    {
+        cell = &pool_ring[pos & (POOL_RING_SIZE - 1)];
+        diff = RING_DIFF(sysAtomicLoad(&cell->sequence), RING_NEXT(pos, 1));
+        if (diff == 0)
+        {
+            if (sysAtomicCompareAndSwap(&pool_ring_head, pos, RING_NEXT(pos, 1)))
+                break;
+            pos = sysAtomicLoad(&pool_ring_head);
+        }
+        else if (diff < 0)
+            return 0;
+        else
+            pos = sysAtomicLoad(&pool_ring_head);
+    }
+    *(job_t **) arg = cell->job;
+    sysAtomicStore(&cell->sequence, RING_NEXT(pos, POOL_RING_SIZE));
+    return 1;
+}
+
+/* -- shared decode pool -- */
+
+/* the decode threads are shared by all decoders in the process -- they are
+   launched on demand, each keeps its own initialized DST decoder state, and
+   they keep running across tracks until dst_decoder_shutdown() -- the jobs of
+   all decoders go through one ring, so concurrent streams are served in the
+   order their frames arrive, while each decoder is bounded by its window */
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int pool_procs = 0;              /* maximum number of decode threads */
+static atomic_t pool_cthreads;          /* number of decode threads running */
+static thread **pool_threads = NULL;    /* decode threads, to join them */
+static doorbell_t pool_work;            /* rung when jobs are put in the ring */
+static doorbell_t pool_space;           /* rung when jobs are taken from the ring */
+static job_t pool_exit_job;             /* tells a decode thread to return */
+static size_t pool_budget = 0;          /* bound of the buffer memory, or 0 */
+static size_t pool_memory = 0;          /* buffer memory of all decoders */
+
+static void decode_thread(void *dummy);
+
+/* set up the shared decode ring if not already set up */
+static void setup_decode_pool(void)
+{
+    pthread_mutex_lock(&pool_mutex);
+    if (pool_threads == NULL)
+    {
+        pool_procs = processor_count();
+        if (pool_procs < 1)
+            pool_procs = 1;
+        pool_threads = (thread **) calloc(pool_procs, sizeof(thread *));
+        if (pool_threads == NULL)
+            exit(1);
+        sysAtomicStore(&pool_cthreads, 0);
+        ring_setup();
+        doorbell_create(&pool_work);
+        doorbell_create(&pool_space);
+    }
+    pthread_mutex_unlock(&pool_mutex);
+}
+
+/* start another decode thread if the pool is not complete yet */
+static void grow_decode_pool(void)
+{
+    int cthreads;
+
+    if (sysAtomicLoad(&pool_cthreads) >= pool_procs)
+        return;
+
+    pthread_mutex_lock(&pool_mutex);
+    cthreads = sysAtomicLoad(&pool_cthreads);
+    if (cthreads < pool_procs)
+    {
+        pool_threads[cthreads] = launch(decode_thread, NULL);
+        sysAtomicStore(&pool_cthreads, cthreads + 1);
+    }
+    pthread_mutex_unlock(&pool_mutex);
+}
+
+/* put a job in the decode ring, waiting for room if it is full, and let the
+   decode threads know */
+static void submit_decoding_job(job_t *job)
+{
+    grow_decode_pool();
+    doorbell_wait(&pool_space, ring_push, job);
+    doorbell_ring(&pool_work);
+}
+
+static int job_is_free(void *arg)
+{
+    return sysAtomicLoad(&((job_t *) arg)->state) == JOB_FREE;
+}
+
+static int job_is_done(void *arg)
+{
+    return sysAtomicLoad(&((job_t *) arg)->state) == JOB_DONE;
+}
+
+static int all_written(void *arg)
+{
+    dst_decoder_t *dst_decoder = (dst_decoder_t *) arg;
+
+    return sysAtomicLoad(&dst_decoder->written) == dst_decoder->sequence;
+}
+
+static int below_inflight_limit(void *arg)
+{
+    dst_decoder_t *dst_decoder = (dst_decoder_t *) arg;
+
+    return sysAtomicLoad(&dst_decoder->inflight) < dst_decoder->max_inflight;
+}
+
+/* setup the reorder window (call from main thread) */
+static void setup_decoding_jobs(dst_decoder_t *dst_decoder, const dst_decoder_limits_t *limits)
 {
+    int max_inflight, max_decoded, i;
+    size_t out_size, job_size, budget;
+
     /* set up only if not already set up*/
-    if (dst_decoder->decode_have != NULL)
+    if (dst_decoder->window != NULL)
         return;
 
-    /* allocate locks and initialize lists */
-    dst_decoder->decode_have = new_lock(0);
-    dst_decoder->decode_head = NULL;
-    dst_decoder->decode_tail = &dst_decoder->decode_head;
-    dst_decoder->write_first = new_lock(-1);
-    dst_decoder->write_head = NULL;
+    setup_decode_pool();
+    dst_decoder->procs = pool_procs;
+
+    /* by default keep all decode threads busy, and let as many decoded
+       frames wait as there are decode threads */
+    max_inflight = (dst_decoder->procs << 1) + 2;
+    max_decoded = dst_decoder->procs + 2;
+    if (limits && limits->max_inflight > 0)
+        max_inflight = limits->max_inflight;
+    if (limits && limits->max_decoded > 0)
+        max_decoded = limits->max_decoded;
+
+    /* a DST frame is never larger than the plain DSD frame and its header */
+    out_size = dst_decoder->frame_size;
+    dst_decoder->in_size = (out_size + 1 + 15) & ~(size_t) 15;
+    job_size = dst_decoder->in_size + out_size;
+
+    /* fit the jobs into the memory budgets, giving up decoded frames first */
+    pthread_mutex_lock(&pool_mutex);
+    budget = (size_t) -1;
+    if (pool_budget != 0)
+        budget = pool_budget > pool_memory ? pool_budget - pool_memory : 0;
+    if (limits && limits->memory_budget != 0 && limits->memory_budget < budget)
+        budget = limits->memory_budget;
+    while ((size_t) (max_inflight + max_decoded) * job_size > budget && max_decoded > 1)
+        max_decoded--;
+    while ((size_t) (max_inflight + max_decoded) * job_size > budget && max_inflight > 1)
+        max_inflight--;
+    dst_decoder->window_memory = (size_t) (max_inflight + max_decoded) * job_size;
+    pool_memory += dst_decoder->window_memory;
+    pthread_mutex_unlock(&pool_mutex);
+
+    LOG(lm_main, LOG_NOTICE, ("-- %d frames in flight, %d decoded, %lu bytes", max_inflight, max_decoded, (unsigned long) dst_decoder->window_memory));
+
+    /* allocate all jobs and their buffers up front */
+    dst_decoder->max_inflight = max_inflight;
+    dst_decoder->window_size = max_inflight + max_decoded;
+    dst_decoder->window = (job_t *) calloc(dst_decoder->window_size, sizeof(job_t));
+    dst_decoder->window_buffers = (uint8_t *) malloc(dst_decoder->window_memory);
+    if (dst_decoder->window == NULL || dst_decoder->window_buffers == NULL)
+        exit(1);
+    for (i = 0; i < dst_decoder->window_size; i++)
+    {
+        job_t *job = &dst_decoder->window[i];
+
+        job->decoder = dst_decoder;
+        job->in = dst_decoder->window_buffers + i * job_size;
+        job->out = job->in + dst_decoder->in_size;
+        sysAtomicStore(&job->state, JOB_FREE);
+    }
 
-    /* initialize buffer pools */
-    buffer_pool_create(&dst_decoder->in_pool, 64 * 1024, (dst_decoder->procs << 1) + 2);
-    buffer_pool_create(&dst_decoder->out_pool, 64 * 1024, -1);
+    doorbell_create(&dst_decoder->job_free);
+    doorbell_create(&dst_decoder->job_done);
+    dst_decoder->refs = new_lock(0);
+    sysAtomicStore(&dst_decoder->inflight, 0);
+    sysAtomicStore(&dst_decoder->epoch, 0);
+    sysAtomicStore(&dst_decoder->written, 0);
 }
 
-/* command the decode threads to all return, then join them all (call from
-   main thread), free all the thread-related resources */
+/* free the reorder window once its last job is written (call from main
+   thread), the shared decode threads keep running */
 static void finish_decoding_jobs(dst_decoder_t *dst_decoder)
 {
-    job_t job;
-    int caught;
-
     /* only do this once */
-    if (dst_decoder->decode_have == NULL)
+    if (dst_decoder->window == NULL)
         return;
 
-    /* command all of the extant decode threads to return */
-    possess(dst_decoder->decode_have);
-    job.error = 0;
-    job.seq = -1;
-    job.next = NULL;
-    dst_decoder->decode_head = &job;
-    dst_decoder->decode_tail = &(job.next);
-    twist(dst_decoder->decode_have, BY, +1);       /* will wake them all up */
-
-    /* join all of the decode threads, verify they all came back */
-    caught = dst_decoder->cthreads;//join_all(); /* HACK HACK */
-    LOG(lm_main, LOG_NOTICE, ("-- joined %d decode threads", caught));
-    assert(caught == dst_decoder->cthreads);
-    dst_decoder->cthreads = 0;
-    usleep(1000);
+    /* a decode thread may still be ringing job_done for the last jobs */
+    possess(dst_decoder->refs);
+    wait_for(dst_decoder->refs, TO_BE, 0);
+    release(dst_decoder->refs);
+    free_lock(dst_decoder->refs);
+    dst_decoder->refs = NULL;
+
+    pthread_mutex_lock(&pool_mutex);
+    pool_memory -= dst_decoder->window_memory;
+    pthread_mutex_unlock(&pool_mutex);
+
+    doorbell_free(&dst_decoder->job_done);
+    doorbell_free(&dst_decoder->job_free);
+    free(dst_decoder->window_buffers);
+    dst_decoder->window_buffers = NULL;
+    free(dst_decoder->window);
+    dst_decoder->window = NULL;
+}
 
-    /* free the resources */
-    caught = buffer_pool_free(&dst_decoder->out_pool);
-    LOG(lm_main, LOG_NOTICE, ("-- freed %d output buffers", caught));
-    caught = buffer_pool_free(&dst_decoder->in_pool);
-    LOG(lm_main, LOG_NOTICE, ("-- freed %d input buffers", caught));
-    free_lock(dst_decoder->write_first);
-    free_lock(dst_decoder->decode_have);
-    dst_decoder->decode_have = NULL;
-}
-
-/* get the next decoding job from the head of the list, decode and compute
-   the check value on the input, and put a job in the write list with the
-   results -- keep looking for more jobs, returning when a job is found with a
-   sequence number of -1 (leave that job in the list for other incarnations to
-   find) */
-static void decode_thread(void *userdata)
-{
-    job_t *job;                /* job pulled and working on */ 
-    job_t *here, **prior;      /* pointers for inserting in write list */ 
-    ebunch      D;
-    dst_decoder_t *dst_decoder = (dst_decoder_t *) userdata;
+/* decode the input of a job on its own */
+static void decode_job(job_t *job, ebunch *D)
+{
+    double start = 0.0;
+    TRACE_BEGIN(span);
+
+    LOG(lm_main, LOG_NOTICE, ("-- decoding #%ld", job->seq));
+
+    if (job->decoder->decode_time)
+        start = timeout_gettime();
+
+    DST_ReconfigureDecoder(D, job->decoder->channel_count, job->decoder->sample_rate);
+    D->Planar = job->decoder->planar;
+
+    /* Save the error for later, so that the write_thread can output them in DST frame order */
+    job->error = DST_FramDSTDecode(job->in, job->out, (int) job->in_len, job->frame_nr, D); 
+    if (job->error != DSTErr_NoError)
+        LOG(lm_main, LOG_ERROR, ("ERROR: %s on frame: %d", DST_GetErrorMessage(job->error), D->FrameHdr.FrameNr));
+
+    job->out_len = job->decoder->frame_size;
+
+    if (job->decoder->decode_time)
+        metrics_record_time(job->decoder->decode_time, start);
+    TRACE_END(span, "dst decode", job->frame_nr);
+
+    LOG(lm_main, LOG_NOTICE, ("-- decoded #%ld", job->seq));
+}
+
+/* hand a decoded job to its write thread -- the decoder must not be touched
+   after refs is dropped, it may be destroyed right away */
+static void finish_job(job_t *job)
+{
+    dst_decoder_t *dst_decoder = job->decoder;
+
+    sysAtomicStore(&job->state, JOB_DONE);
+    sysAtomicFetchAndAdd(&dst_decoder->inflight, -1);
+    doorbell_ring(&dst_decoder->job_done);
+    possess(dst_decoder->refs);
+    twist(dst_decoder->refs, BY, -1);
+}
+
+/* take the next decoding job from the ring, decode it, and mark it done in
+   the reorder window of its decoder -- keep looking for more jobs, returning
+   when the exit job is found (every decode thread takes one of those) --
+   when more than one frame is waiting, two frames are taken and decoded in
+   lockstep by DST_FramDSTDecode2() -- the jobs may belong to any decoder, the
+   DST decoder state is switched to their channel count and sample rate */
+static void decode_thread(void *dummy)
+{
+    job_t *job[2];             /* jobs taken and working on */ 
+    int jobs, i;               /* number of jobs taken */
+    int quit = 0;              /* true if the exit job was taken along */
+    int pairing = 0;           /* true if D[1] is initialized */
+    ebunch      *D;            /* DST decoder states, too large for the stack */
 
-    if (DST_InitDecoder(&D, dst_decoder->channel_count, 64) != 0)
+    (void) dummy;
+
+    D = (ebunch *) malloc(2 * sizeof(ebunch));
+    if (D == NULL)
+        exit(1);
+
+    if (DST_InitDecoder(&D[0], MAX_CHANNELS, 64) != 0)
     {
+        free(D);
         pthread_exit(0);
     }
 
     /* keep looking for work */
-    for(;;)
+    while (!quit)
     {
         /* get a job */
-        possess(dst_decoder->decode_have);
-        wait_for(dst_decoder->decode_have, NOT_TO_BE, 0);
-        job = dst_decoder->decode_head;
-        assert(job != NULL);
-        if (job->seq == -1)
+        doorbell_wait(&pool_work, ring_pop, &job[0]);
+        doorbell_ring(&pool_space);
+        if (job[0]->decoder == NULL)
             break;
-        dst_decoder->decode_head = job->next;
-        if (job->next == NULL)
-            dst_decoder->decode_tail = &dst_decoder->decode_head;
-        twist(dst_decoder->decode_have, BY, -1);
-
-        /* got a job */
-        LOG(lm_main, LOG_NOTICE, ("-- decoding #%ld", job->seq));
+        jobs = 1;
+        TRACE_THREAD_NAME("dst decode");
 
-        if (job->more)
+        /* take a second frame along if one is waiting as well */
+        if (ring_pop(&job[1]))
         {
-            job->out = buffer_pool_get_space(&dst_decoder->out_pool);
-
-            /* Save the error for later, so that the write_thread can output them in DST frame order */
-            job->error = DST_FramDSTDecode(job->in->buf, job->out->buf, job->in->len, job->seq, &D); 
-            if (job->error != DSTErr_NoError)
-                LOG(lm_main, LOG_ERROR, ("ERROR: %s on frame: %d", DST_GetErrorMessage(job->error), D.FrameHdr.FrameNr));
+            doorbell_ring(&pool_space);
+            if (job[1]->decoder == NULL)
+                quit = 1;
+            else
+                jobs = 2;
+        }
 
-            job->out->len = (size_t)(MAX_DSDBITS_INFRAME / 8 * dst_decoder->channel_count);
-            buffer_pool_drop_space(job->in);
+        /* frames dropped by dst_decoder_reset() are not decoded */
+        for (i = 0; i < jobs; )
+        {
+            if (job[i]->epoch != sysAtomicLoad(&job[i]->decoder->epoch))
+            {
+                job[i]->error = 0;
+                job[i]->out_len = 0;
+                finish_job(job[i]);
+                job[i] = job[--jobs];
+            }
+            else
+                i++;
+        }
+        if (jobs == 0)
+            continue;
 
-            LOG(lm_main, LOG_NOTICE, ("-- decoded #%ld%s", job->seq, job->more ? "" : " (last)"));
+        /* got a job */
+        if (jobs == 2 && pairing)
+        {
+            uint8_t *in_buf[2], *out_buf[2];
+            int in_len[2], seq[2], error[2];
+            ebunch *Dp[2];
+            double start, elapsed;
+            TRACE_BEGIN(span);
+
+            LOG(lm_main, LOG_NOTICE, ("-- decoding #%ld and #%ld", job[0]->seq, job[1]->seq));
+
+            for (i = 0; i < 2; i++)
+            {
+                DST_ReconfigureDecoder(&D[i], job[i]->decoder->channel_count, job[i]->decoder->sample_rate);
+                D[i].Planar = job[i]->decoder->planar;
+                in_buf[i] = job[i]->in;
+                out_buf[i] = job[i]->out;
+                in_len[i] = (int) job[i]->in_len;
+                seq[i] = job[i]->frame_nr;
+                Dp[i] = &D[i];
+            }
+
+            start = timeout_gettime();
+            DST_FramDSTDecode2(in_buf, out_buf, in_len, seq, Dp, error);
+            elapsed = timeout_gettime() - start;
+            if (elapsed < 0.0)
+                elapsed = 0.0;
+
+            for (i = 0; i < 2; i++)
+            {
+                /* each frame took half of the lockstep decode */
+                metrics_record(job[i]->decoder->decode_time, (uint32_t) (elapsed / 2 * 1.0e6));
+
+                /* Save the error for later, so that the write_thread can output them in DST frame order */
+                job[i]->error = error[i];
+                if (job[i]->error != DSTErr_NoError)
+                    LOG(lm_main, LOG_ERROR, ("ERROR: %s on frame: %d", DST_GetErrorMessage(job[i]->error), D[i].FrameHdr.FrameNr));
+
+                job[i]->out_len = job[i]->decoder->frame_size;
+            }
+
+            TRACE_END(span, "dst decode pair", job[0]->frame_nr);
+
+            LOG(lm_main, LOG_NOTICE, ("-- decoded #%ld and #%ld", job[0]->seq, job[1]->seq));
         }
+        else
+        {
+            for (i = 0; i < jobs; i++)
+                decode_job(job[i], &D[0]);
+        }
+
+        /* hand the results to the write threads */
+        for (i = 0; i < jobs; i++)
+            finish_job(job[i]);
 
-        /* insert write job in list in sorted order, alert write thread */
-        possess(dst_decoder->write_first);
-        prior = &dst_decoder->write_head;
-        while ((here = *prior) != NULL) 
+        /* frames are queueing up, prepare a second decoder to pair them */
+        if (jobs == 2 && !pairing)
         {
-            if (here->seq > job->seq)
-                break;
-            prior = &(here->next);
+            if (DST_InitDecoder(&D[1], MAX_CHANNELS, 64) == 0)
+                pairing = 1;
         }
-        job->next = here;
-        *prior = job;
-        twist(dst_decoder->write_first, TO, dst_decoder->write_head->seq);
 
         /* done with that one -- go find another job */
     } 
 
-    /* found job with seq == -1 -- free deflate memory and return to join */
-    release(dst_decoder->decode_have);
+    /* found the exit job -- free decoder memory and return to join */
+    if (pairing)
+        DST_CloseDecoder(&D[1]);
 
-    if (DST_CloseDecoder(&D) != 0)
+    if (DST_CloseDecoder(&D[0]) != 0)
     {
+        free(D);
         pthread_exit(0);
     }
+    free(D);
 }
 
-/* collect the write jobs off of the list in sequence order and write out the
-   decoded data until the last chunk is written -- also write the header and
-   trailer and combine the individual check values of the input buffers */
+/* collect the jobs from the reorder window in sequence order and write out
+   the decoded data until the last chunk is written */
 static void write_thread(void *userdata)
 {
     long seq;                       /* next sequence number looking for */
@@ -233,75 +593,80 @@ static void write_thread(void *userdata)
     /* build and write header */
     LOG(lm_main, LOG_NOTICE, ("-- write thread running"));
 
-    /* process output of decode threads until end of input */
-    seq = 0;
+    /* process output of decode threads until end of input, after the frames
+       written inline if the decoder was switched to threaded */
+    seq = sysAtomicLoad(&dst_decoder->written);
     do 
     {
         /* get next write job in order */
-        possess(dst_decoder->write_first);
-        wait_for(dst_decoder->write_first, TO_BE, seq);
-        job = dst_decoder->write_head;
-        dst_decoder->write_head = job->next;
-        twist(dst_decoder->write_first, TO, dst_decoder->write_head == NULL ? -1 : dst_decoder->write_head->seq);
-
-        /* report any error */
-        if (job->error != 0 && dst_decoder->frame_error_callback)
-            dst_decoder->frame_error_callback(job->seq, job->error, DST_GetErrorMessage(job->error), dst_decoder->userdata);
+        TRACE_BEGIN(wait);
+        TRACE_THREAD_NAME("dst write");
+        job = &dst_decoder->window[seq % dst_decoder->window_size];
+        doorbell_wait(&dst_decoder->job_done, job_is_done, job);
+        assert(job->seq == seq);
+        TRACE_END(wait, "wait for decoded frame", seq);
 
         more = job->more;
 
-        if (more)
+        /* frames dropped by dst_decoder_reset() are not written */
+        if (job->epoch == sysAtomicLoad(&dst_decoder->epoch))
         {
-            /* write the decoded data and drop the output buffer */
-            dst_decoder->frame_decoded_callback(job->out->buf, job->out->len, dst_decoder->userdata);
-            buffer_pool_drop_space(job->out);
+            /* report any error */
+            if (job->error != 0 && dst_decoder->frame_error_callback)
+                dst_decoder->frame_error_callback(job->frame_nr, job->error, DST_GetErrorMessage(job->error), dst_decoder->userdata);
+
+            if (more)
+            {
+                /* write the decoded data */
+                TRACE_BEGIN(span);
+                dst_decoder->frame_decoded_callback(job->out, job->out_len, dst_decoder->userdata);
+                TRACE_END(span, "dst write", job->frame_nr);
+            }
         }
 
-        free(job);
+        /* hand the job back to dst_decoder_decode */
+        sysAtomicStore(&job->state, JOB_FREE);
+        sysAtomicStore(&dst_decoder->written, (int) seq + 1);
+        doorbell_ring(&dst_decoder->job_free);
 
         /* get the next buffer in sequence */
         seq++;
     } 
     while (more);
-
-    /* verify no more jobs, prepare for next use */
-    possess(dst_decoder->decode_have);
-    assert(dst_decoder->decode_head == NULL && peek_lock(dst_decoder->decode_have) == 0);
-    release(dst_decoder->decode_have);
-    possess(dst_decoder->write_first);
-    assert(dst_decoder->write_head == NULL);
-    twist(dst_decoder->write_first, TO, -1);
 }
 
-static void finish_write_job(dst_decoder_t *dst_decoder)
+/* take the job for the next sequence number, waiting for write_thread to
+   free it when the window is full */
+static job_t *get_free_job(dst_decoder_t *dst_decoder)
 {
-    job_t *job;                /* job for decode, then write */
+    job_t *job;
+    TRACE_BEGIN(span);
 
-    /* create a new job, use next input chunk, previous as dictionary */
-    job = malloc(sizeof(job_t));
-    if (job == NULL)
-        exit(1);
-    job->error = 0;
+    job = &dst_decoder->window[dst_decoder->sequence % dst_decoder->window_size];
+    doorbell_wait(&dst_decoder->job_free, job_is_free, job);
+    TRACE_END(span, "wait for free job", dst_decoder->sequence);
     job->seq = dst_decoder->sequence;
-    job->in = 0;
-    job->out = 0;
-    job->more = 0;
+    job->frame_nr = dst_decoder->frame_nr;
+    job->epoch = sysAtomicLoad(&dst_decoder->epoch);
+    job->error = 0;
 
     ++dst_decoder->sequence;
+    ++dst_decoder->frame_nr;
 
-    /* start another decode thread if needed */
-    if (dst_decoder->cthreads < dst_decoder->procs) 
-    {
-        (void)launch(decode_thread, dst_decoder);
-        dst_decoder->cthreads++;
-    }
+    return job;
+}
+
+static void finish_write_job(dst_decoder_t *dst_decoder)
+{
+    job_t *job;                /* job for write */
 
-    /* put job at end of decode list, let all the decoders know */
-    possess(dst_decoder->decode_have);
-    job->next = NULL;
-    *dst_decoder->decode_tail = job;
-    dst_decoder->decode_tail = &(job->next);
-    twist(dst_decoder->decode_have, BY, +1);
+    /* the last job has nothing to decode, put it in the window right away */
+    job = get_free_job(dst_decoder);
+    job->in_len = 0;
+    job->out_len = 0;
+    job->more = 0;
+    sysAtomicStore(&job->state, JOB_DONE);
+    doorbell_ring(&dst_decoder->job_done);
 
     join(dst_decoder->writeth);
     dst_decoder->writeth = NULL;
@@ -309,31 +674,201 @@ static void finish_write_job(dst_decoder_t *dst_decoder)
 
 dst_decoder_t* dst_decoder_create(int channel_count, frame_decoded_callback_t frame_decoded_callback, frame_error_callback_t frame_error_callback, void *userdata)
 {
-    dst_decoder_t *dst_decoder = (dst_decoder_t*) calloc(sizeof(dst_decoder_t), 1);
+    return dst_decoder_create_limited(channel_count, 64, NULL, frame_decoded_callback, frame_error_callback, userdata);
+}
 
-    if (!dst_decoder)
+/* -- inline decoding -- */
+
+/* state for decoding on the thread calling dst_decoder_decode() -- a frame
+   is held back until the next one comes in, so that both can be decoded in
+   lockstep by DST_FramDSTDecode2() */
+typedef struct inline_decoder_s
+{
+    ebunch D[2];               /* DST decoder states */
+    job_t *pending;            /* frame held back, or NULL */
+    double decode_time;        /* seconds spent decoding */
+    int decode_count;          /* frames decoded */
+} inline_decoder_t;
+
+static void setup_inline_decoder(dst_decoder_t *dst_decoder)
+{
+    inline_decoder_t *id;
+
+    id = (inline_decoder_t *) calloc(1, sizeof(inline_decoder_t));
+    if (id == NULL)
+        exit(1);
+    if (DST_InitDecoder(&id->D[0], dst_decoder->channel_count, dst_decoder->sample_rate) != 0 ||
+        DST_InitDecoder(&id->D[1], dst_decoder->channel_count, dst_decoder->sample_rate) != 0)
         exit(1);
+    id->D[0].Planar = dst_decoder->planar;
+    id->D[1].Planar = dst_decoder->planar;
+    dst_decoder->inline_decoder = id;
+}
+
+static void finish_inline_decoder(dst_decoder_t *dst_decoder)
+{
+    inline_decoder_t *id = dst_decoder->inline_decoder;
+
+    DST_CloseDecoder(&id->D[1]);
+    DST_CloseDecoder(&id->D[0]);
+    free(id);
+    dst_decoder->inline_decoder = NULL;
+}
+
+/* pass a decoded job to the callbacks and hand it back, like write_thread */
+static void write_inline_job(dst_decoder_t *dst_decoder, job_t *job)
+{
+    if (job->epoch == sysAtomicLoad(&dst_decoder->epoch))
+    {
+        if (job->error != 0 && dst_decoder->frame_error_callback)
+            dst_decoder->frame_error_callback(job->frame_nr, job->error, DST_GetErrorMessage(job->error), dst_decoder->userdata);
+
+        if (job->more)
+        {
+            TRACE_BEGIN(span);
+            dst_decoder->frame_decoded_callback(job->out, job->out_len, dst_decoder->userdata);
+            TRACE_END(span, "dst write", job->frame_nr);
+        }
+    }
+
+    sysAtomicStore(&job->state, JOB_FREE);
+    sysAtomicStore(&dst_decoder->written, (int) job->seq + 1);
+}
+
+/* decode and write the frame held back on its own */
+static void flush_inline_decoder(dst_decoder_t *dst_decoder)
+{
+    inline_decoder_t *id = dst_decoder->inline_decoder;
+    job_t *job = id->pending;
+
+    if (job == NULL)
+        return;
+    id->pending = NULL;
+
+    /* no need to decode a frame dropped by dst_decoder_reset() */
+    if (job->epoch == sysAtomicLoad(&dst_decoder->epoch))
+        decode_job(job, &id->D[0]);
+    write_inline_job(dst_decoder, job);
+}
+
+/* hold the job back, or decode it together with the one held back -- in
+   auto mode, hand over to the decode threads once a frame takes more than
+   half the frame period to decode */
+static void decode_inline(dst_decoder_t *dst_decoder, job_t *job)
+{
+    inline_decoder_t *id = dst_decoder->inline_decoder;
+    uint8_t *in_buf[2], *out_buf[2];
+    int in_len[2], frame_nr[2], error[2];
+    ebunch *Dp[2];
+    job_t *jobs[2];
+    double start, elapsed;
+    int i;
+    TRACE_BEGIN(span);
+
+    if (id->pending == NULL)
+    {
+        id->pending = job;
+        return;
+    }
+
+    jobs[0] = id->pending;
+    jobs[1] = job;
+    id->pending = NULL;
+    for (i = 0; i < 2; i++)
+    {
+        in_buf[i] = jobs[i]->in;
+        out_buf[i] = jobs[i]->out;
+        in_len[i] = (int) jobs[i]->in_len;
+        frame_nr[i] = jobs[i]->frame_nr;
+        Dp[i] = &id->D[i];
+    }
+
+    start = timeout_gettime();
+    DST_FramDSTDecode2(in_buf, out_buf, in_len, frame_nr, Dp, error);
+    elapsed = timeout_gettime() - start;
+    if (elapsed < 0.0)
+        elapsed = 0.0;
+    id->decode_time += elapsed;
+    id->decode_count += 2;
+    metrics_record(dst_decoder->decode_time, (uint32_t) (elapsed / 2 * 1.0e6));
+    metrics_record(dst_decoder->decode_time, (uint32_t) (elapsed / 2 * 1.0e6));
+    TRACE_END(span, "dst decode pair", frame_nr[0]);
+
+    for (i = 0; i < 2; i++)
+    {
+        jobs[i]->error = error[i];
+        if (jobs[i]->error != DSTErr_NoError)
+            LOG(lm_main, LOG_ERROR, ("ERROR: %s on frame: %d", DST_GetErrorMessage(jobs[i]->error), id->D[i].FrameHdr.FrameNr));
+        jobs[i]->out_len = dst_decoder->frame_size;
+        write_inline_job(dst_decoder, jobs[i]);
+    }
+
+    if (dst_decoder->mode == DST_DECODER_AUTO && id->decode_count >= INLINE_PROBE_FRAMES)
+    {
+        if (id->decode_time / id->decode_count > FRAME_PERIOD / 2)
+        {
+            LOG(lm_main, LOG_NOTICE, ("-- %.1f ms per frame, switching to threaded decoding", 1000 * id->decode_time / id->decode_count));
+            finish_inline_decoder(dst_decoder);
+            dst_decoder->writeth = launch(write_thread, dst_decoder);
+        }
+        else
+        {
+            /* keep following the decoding time */
+            id->decode_time /= 2;
+            id->decode_count /= 2;
+        }
+    }
+}
+
+dst_decoder_t* dst_decoder_create_limited(int channel_count, int sample_rate, const dst_decoder_limits_t *limits, frame_decoded_callback_t frame_decoded_callback, frame_error_callback_t frame_error_callback, void *userdata)
+{
+    dst_decoder_t *dst_decoder;
 
     assert(frame_decoded_callback);
 
+    /* DST is only defined for these rates */
+    if (sample_rate != 64 && sample_rate != 128 && sample_rate != 256)
+    {
+        LOG(lm_main, LOG_ERROR, ("ERROR: DST decoding of %dfs is not supported", sample_rate));
+        return NULL;
+    }
+
+    dst_decoder = (dst_decoder_t*) calloc(sizeof(dst_decoder_t), 1);
+    if (!dst_decoder)
+        exit(1);
+
     dst_decoder->channel_count = channel_count;
+    dst_decoder->sample_rate = sample_rate;
+    dst_decoder->frame_size = DST_DECODER_FRAME_SIZE(channel_count, sample_rate);
     dst_decoder->userdata = userdata;
     dst_decoder->frame_decoded_callback = frame_decoded_callback;
     dst_decoder->frame_error_callback = frame_error_callback;
-    dst_decoder->procs = processor_count();
+    dst_decoder->mode = limits ? limits->mode : DST_DECODER_THREADED;
+    dst_decoder->planar = limits ? limits->planar : 0;
 
     /* if first time or after an option change, setup the job lists */
-    setup_decoding_jobs(dst_decoder);
+    setup_decoding_jobs(dst_decoder, limits);
 
-    /* start write thread */
-    dst_decoder->writeth = launch(write_thread, dst_decoder);
+    if (dst_decoder->mode == DST_DECODER_THREADED)
+    {
+        /* start write thread */
+        dst_decoder->writeth = launch(write_thread, dst_decoder);
+    }
+    else
+        setup_inline_decoder(dst_decoder);
 
     return dst_decoder;
 }
 
 void dst_decoder_destroy(dst_decoder_t *dst_decoder)
 {
-    finish_write_job(dst_decoder);
+    if (dst_decoder->inline_decoder)
+    {
+        flush_inline_decoder(dst_decoder);
+        finish_inline_decoder(dst_decoder);
+    }
+    else
+        finish_write_job(dst_decoder);
     finish_decoding_jobs(dst_decoder);
 
     free(dst_decoder);
@@ -343,31 +878,122 @@ void dst_decoder_decode(dst_decoder_t *dst_decoder, uint8_t* frame_data, size_t
 {
     job_t *job;                /* job for decode, then write */
 
-    /* create a new job, use next input chunk */
-    job = malloc(sizeof(job_t));
-    if (job == NULL)
-        exit(1);
-    job->error = 0;
-    job->seq = dst_decoder->sequence;
-    job->in = buffer_pool_get_space(&dst_decoder->in_pool);
-    memcpy(job->in->buf, frame_data, frame_size);
-    job->in->len = frame_size;
-    job->out = NULL;
+    /* take the next job, copy in the input chunk */
+    job = get_free_job(dst_decoder);
+
+    /* a frame that doesn't fit the input buffer isn't a DST frame, it is
+       reported and written as silence in its place */
+    if (frame_size > dst_decoder->in_size)
+    {
+        LOG(lm_main, LOG_ERROR, ("ERROR: %s on frame: %d", DST_GetErrorMessage(DSTErr_FrameTooLarge), job->frame_nr));
+        job->error = DSTErr_FrameTooLarge;
+        job->in_len = 0;
+        memset(job->out, dst_decoder->planar ? 0x96 : DSD_SILENCE, dst_decoder->frame_size);
+        job->out_len = dst_decoder->frame_size;
+        job->more = 1;
+
+        if (dst_decoder->inline_decoder)
+        {
+            /* the frame held back goes first */
+            flush_inline_decoder(dst_decoder);
+            write_inline_job(dst_decoder, job);
+        }
+        else
+        {
+            sysAtomicStore(&job->state, JOB_DONE);
+            doorbell_ring(&dst_decoder->job_done);
+        }
+        return;
+    }
+
+    memcpy(job->in, frame_data, frame_size);
+    job->in_len = frame_size;
     job->more = 1;
+    sysAtomicStore(&job->state, JOB_QUEUED);
 
-    ++dst_decoder->sequence;
+    if (dst_decoder->inline_decoder)
+    {
+        decode_inline(dst_decoder, job);
+        return;
+    }
+
+    /* keep at most max_inflight frames with the decode threads */
+    doorbell_wait(&dst_decoder->job_done, below_inflight_limit, dst_decoder);
+    sysAtomicFetchAndAdd(&dst_decoder->inflight, 1);
+    possess(dst_decoder->refs);
+    twist(dst_decoder->refs, BY, 1);
+
+    /* put job in the decode ring, let all the decoders know */
+    submit_decoding_job(job);
+}
+
+void dst_decoder_set_metrics(dst_decoder_t *dst_decoder, metrics_t *metrics)
+{
+    dst_decoder->decode_time = metrics_histogram(metrics, "dst decode", "us per frame");
+}
+
+void dst_decoder_flush(dst_decoder_t *dst_decoder)
+{
+    if (dst_decoder->inline_decoder)
+        flush_inline_decoder(dst_decoder);
+    else
+        doorbell_wait(&dst_decoder->job_free, all_written, dst_decoder);
+}
+
+void dst_decoder_reset(dst_decoder_t *dst_decoder, int frame_nr)
+{
+    /* make the jobs handed out so far stale, the decode threads skip them
+       and write_thread only hands them back, then wait for the last one */
+    sysAtomicFetchAndAdd(&dst_decoder->epoch, 1);
+    dst_decoder_flush(dst_decoder);
+
+    dst_decoder->frame_nr = frame_nr;
+}
 
-    /* start another decode thread if needed */
-    if (dst_decoder->cthreads < dst_decoder->procs) 
+void dst_decoder_set_memory_budget(size_t bytes)
+{
+    pthread_mutex_lock(&pool_mutex);
+    pool_budget = bytes;
+    pthread_mutex_unlock(&pool_mutex);
+}
+
+/* command the shared decode threads to all return, then join them all (call
+   from main thread), free all the pool resources */
+void dst_decoder_shutdown(void)
+{
+    int caught, cthreads;
+
+    pthread_mutex_lock(&pool_mutex);
+
+    /* only do this once */
+    if (pool_threads == NULL)
     {
-        (void)launch(decode_thread, dst_decoder);
-        dst_decoder->cthreads++;
+        pthread_mutex_unlock(&pool_mutex);
+        return;
     }
 
-    /* put job at end of decode list, let all the decoders know */
-    possess(dst_decoder->decode_have);
-    job->next = NULL;
-    *dst_decoder->decode_tail = job;
-    dst_decoder->decode_tail = &(job->next);
-    twist(dst_decoder->decode_have, BY, +1);
+    /* command all of the extant decode threads to return, after any jobs
+       still waiting */
+    pool_exit_job.decoder = NULL;
+    pool_exit_job.seq = -1;
+    cthreads = sysAtomicLoad(&pool_cthreads);
+    for (caught = 0; caught < cthreads; caught++)
+    {
+        doorbell_wait(&pool_space, ring_push, &pool_exit_job);
+        doorbell_ring(&pool_work);
+    }
+
+    /* join all of the decode threads */
+    for (caught = 0; caught < cthreads; caught++)
+        join(pool_threads[caught]);
+    LOG(lm_main, LOG_NOTICE, ("-- joined %d decode threads", caught));
+
+    /* free the resources */
+    free(pool_threads);
+    pool_threads = NULL;
+    sysAtomicStore(&pool_cthreads, 0);
+    doorbell_free(&pool_space);
+    doorbell_free(&pool_work);
+
+    pthread_mutex_unlock(&pool_mutex);
 }
@@ -23,58 +23,152 @@
 #define DST_DECODER_H
 
 #include <stdint.h>
-#include "buffer_pool.h"
+#include <stddef.h>
+#include <sys/atomic.h>
+#include "metrics.h"
+#include "yarn.h"
 
-/* decode or write job (passed from decode list to write list) -- if seq is
-   equal to -1, decode_thread is instructed to return; if more is false then
-   this is the last chunk, which after writing tells write_thread to return */
+struct dst_decoder_s;
+struct inline_decoder_s;
+
+/* states of a job slot, a slot cycles from free to queued (filled in by
+   dst_decoder_decode) to done (decoded by a decode thread) and back to free
+   (written by write_thread) */
+#define JOB_FREE    0
+#define JOB_QUEUED  1
+#define JOB_DONE    2
+
+/* decode or write job (passed from the decode ring to the reorder window) --
+   if decoder is NULL, decode_thread is instructed to return; if more is false
+   then this is the last chunk, which after writing tells write_thread to
+   return */
 typedef struct job_t
 {
+    struct dst_decoder_s *decoder;            /* decoder session the job belongs to */
+    atomic_t state;                           /* JOB_FREE, JOB_QUEUED or JOB_DONE */
     long seq;                                 /* sequence number */
+    int frame_nr;                             /* DST frame number, for errors */
+    int epoch;                                /* dropped if not the decoder epoch */
     int error;                                /* an error code (eg. DST decoding error) */
     int more;                                 /* true if this is not the last chunk */
-    buffer_pool_space_t *in;                  /* input DST data to decode */
-    buffer_pool_space_t *out;                 /* resulting DSD decoded data */
-    struct job_t *next;                       /* next job in the list (either list) */
+    uint8_t *in;                              /* input DST data to decode */
+    size_t in_len;
+    uint8_t *out;                             /* resulting DSD decoded data */
+    size_t out_len;
 } 
 job_t;
 
+/* a doorbell lets threads sleep until a condition that is polled lock-free
+   turns true, the lock is only taken when there are sleepers */
+typedef struct doorbell_t
+{
+    lock *bell;                               /* rung by incrementing */
+    atomic_t sleepers;                        /* number of threads waiting */
+}
+doorbell_t;
+
+/* decoding modes -- threaded hands the frames to the shared decode threads and
+   writes them from a write thread, inline decodes two frames at a time on the
+   thread calling dst_decoder_decode() and calls the callbacks from there, auto
+   starts inline and turns threaded when decoding takes too much of the frame
+   period */
+#define DST_DECODER_THREADED 0
+#define DST_DECODER_INLINE   1
+#define DST_DECODER_AUTO     2
+
+/* limits of a decoder, fields left zero select the defaults */
+typedef struct dst_decoder_limits_t
+{
+    int max_inflight;                         /* frames queued for or being decoded */
+    int max_decoded;                          /* decoded frames waiting to be written */
+    size_t memory_budget;                     /* bound of the buffer memory in bytes */
+    int mode;                                 /* DST_DECODER_THREADED, _INLINE or _AUTO */
+    int planar;                               /* true for each channel in a block, LSB first */
+}
+dst_decoder_limits_t;
+
+/* bytes of a decoded DSD frame, the sample rate is given as a multiple of
+   44.1 kHz (64, 128 or 256) */
+#define DST_DECODER_FRAME_SIZE(channel_count, sample_rate) ((size_t) 588 * (sample_rate) / 8 * (channel_count))
+
+/* a decoded frame is interleaved (a byte of each channel in turn) with the
+   first sample in the MSB as on disc, or if planar, holds a block of
+   frame_size / channel_count bytes per channel with the first sample in the
+   LSB as DSF stores it */
 typedef void (*frame_decoded_callback_t)(uint8_t* frame_data, size_t frame_size, void *userdata);
 typedef void (*frame_error_callback_t)(int frame_count, int frame_error_code, const char *frame_error_message, void *userdata);
 
 typedef struct dst_decoder_s
 {
-    int procs;            /* maximum number of compression threads (>= 1) */
+    int procs;            /* number of threads in the shared decode pool (>= 1) */
     int channel_count;
+    int sample_rate;      /* multiple of 44.1 kHz: 64, 128 or 256 */
+    size_t frame_size;    /* bytes of a decoded frame */
+    int planar;           /* frames are written per channel, LSB first (as in DSF) */
 
     int sequence;       /* each job get's a unique sequence number */
+    int frame_nr;       /* frame number of the next job */
 
-    /* input and output buffer pools */
-    buffer_pool_t in_pool;
-    buffer_pool_t out_pool;
+    /* a reset drops all jobs of the epochs before */
+    atomic_t epoch;
+    atomic_t written;   /* sequence numbers handed back by write_thread */
 
-    /* list of decode jobs (with tail for appending to list) */
-    lock *decode_have;   /* number of decode jobs waiting */
-    job_t *decode_head, **decode_tail;
+    /* reorder window of preallocated jobs, indexed by seq % window_size --
+       it bounds the frames queued, being decoded and waiting to be written */
+    job_t *window;
+    int window_size;
+    int max_inflight;         /* frames handed to the decode threads at most */
+    size_t in_size;           /* size of the input buffer of a job */
+    size_t window_memory;     /* bytes taken by the buffers of all jobs */
+    uint8_t *window_buffers;  /* input and output buffers of all jobs */
 
-    /* list of write jobs */
-    lock *write_first;    /* lowest sequence number in list */
-    job_t *write_head;
-
-    /* number of decoding threads running */
-    int cthreads;
+    doorbell_t job_free;      /* rung when write_thread frees a job */
+    doorbell_t job_done;      /* rung when a decode thread finishes a job */
+    atomic_t inflight;        /* frames handed to the decode threads */
+    lock *refs;               /* jobs a decode thread may still touch */
 
     /* write thread if running */
     thread *writeth;
 
+    int mode;                 /* DST_DECODER_THREADED, _INLINE or _AUTO */
+    struct inline_decoder_s *inline_decoder;  /* decoding on the calling thread, or NULL */
+
     frame_decoded_callback_t frame_decoded_callback;
     frame_error_callback_t frame_error_callback;
     void *userdata;
+
+    metric_t *decode_time;    /* microseconds per frame, or NULL */
 } dst_decoder_t;
 
+/* create a decoder for frames at sample_rate times 44.1 kHz (64, 128 or 256),
+   NULL for other rates -- dst_decoder_create() takes SACD (64fs) frames and
+   the default limits */
 dst_decoder_t* dst_decoder_create(int channel_count, frame_decoded_callback_t frame_decoded_callback, frame_error_callback_t frame_error_callback, void *userdata);
+dst_decoder_t* dst_decoder_create_limited(int channel_count, int sample_rate, const dst_decoder_limits_t *limits, frame_decoded_callback_t frame_decoded_callback, frame_error_callback_t frame_error_callback, void *userdata);
 void dst_decoder_destroy(dst_decoder_t *dst_decoder);
 void dst_decoder_decode(dst_decoder_t *dst_decoder, uint8_t* frame_data, size_t frame_size);
 
+/* record the decoding time of each frame in metrics, call before the first
+   frame is passed to dst_decoder_decode() */
+void dst_decoder_set_metrics(dst_decoder_t *dst_decoder, metrics_t *metrics);
+
+/* wait until all frames passed to dst_decoder_decode() went through the
+   callbacks */
+void dst_decoder_flush(dst_decoder_t *dst_decoder);
+
+/* drop all frames queued or being decoded without passing them to the
+   callbacks, and go on at frame_nr (e.g. after a seek) -- returns once no
+   dropped frame can reach the callbacks anymore, the decode threads keep
+   running */
+void dst_decoder_reset(dst_decoder_t *dst_decoder, int frame_nr);
+
+/* bound the buffer memory of all decoders created from now on, 0 for no
+   bound -- a decoder that does not fit gets fewer jobs, down to two */
+void dst_decoder_set_memory_budget(size_t bytes);
+
+/* stop and join the decode threads shared by all decoders, call once all
+   decoders are destroyed (e.g. when unloading) */
+void dst_decoder_shutdown(void);
+
 
 #endif /* DST_DECODER_H */
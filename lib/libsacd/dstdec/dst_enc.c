@@ -0,0 +1,845 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+  DST encoding of a frame, the counterpart of dst_fram.c -- the prediction
+  and the arithmetic coding mirror the decoder bit for bit, so that
+  DST_FramDSTDecode() restores the DSD frame exactly.
+
+  Every frame gets one segment per channel, a filter found by linear
+  prediction on the autocorrelation of the frame, and a Ptable made from the
+  prediction errors the quantized filter makes. The effort level sets the
+  prediction order and how many variants (coefficient scales, shorter
+  filters, one filter for all channels) are tried, the one with the fewest
+  bits is kept. A frame that does not get smaller is stored as plain DSD.
+*/
+
+/*============================================================================*/
+/*       INCLUDES                                                             */
+/*============================================================================*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "dst_enc.h"
+#include "dst_init.h"
+#include "dst_ac.h"
+#include "ccp_calc.h"
+#include "pack_dst.h"
+
+int Log2RoundUp(long x);
+
+/*============================================================================*/
+/*       CONSTANTS                                                            */
+/*============================================================================*/
+
+/* prediction order of the filters for each effort level */
+static const int EffortPredOrder[MAX_EFFORT + 1] = { 0, 16, 24, 32, 48, 64, 80, 96, 112, 128 };
+
+/* coefficient scales tried on top of the base scale, the first
+   ScaleCount[Effort] of them */
+static const double EffortScale[3] = { 1.0, 0.5, 2.0 };
+static const int EffortScaleCount[MAX_EFFORT + 1] = { 0, 1, 1, 1, 2, 2, 2, 3, 3, 3 };
+
+/* the effort from which one filter for all channels is tried as well */
+#define SHARED_FILTER_EFFORT 5
+
+/* the effort from which filters of half the prediction order are tried */
+#define HALF_ORDER_EFFORT    8
+
+/*============================================================================*/
+/*       TYPE DEFINITIONS                                                     */
+/*============================================================================*/
+
+/* a filter with the Ptable that goes with it */
+typedef struct
+{
+  int     PredOrder;
+  int     ICoef[1 << SIZE_CODEDPREDORDER];
+  int     PtableLen;
+  int     P_one[AC_HISMAX];
+  double  Bits;                 /* estimated bits of the channels it codes, */
+                                /* tables and arithmetic code included      */
+} TableSet;
+
+/*============================================================================*/
+/*       STATIC FUNCTION IMPLEMENTATIONS                                      */
+/*============================================================================*/
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : Reverse7LSBs                                                 */
+/*                                                                         */
+/* function : Take the 7 LSBs of a number consisting of SIZE_PREDCOEF bits */
+/*            (2's complement), reverse the bit order and add 1 to it.     */
+/*                                                                         */
+/* pre      : c                                                            */
+/*                                                                         */
+/* post     : Returns the translated number                                */
+/*                                                                         */
+/***************************************************************************/
+
+static int Reverse7LSBs(int c)
+{
+  int  i;
+  int  r = 0;
+
+  c = (c + (1 << SIZE_PREDCOEF)) & 127;
+  for (i = 0; i < 7; i++)
+  {
+    r |= ((c >> i) & 1) << (6 - i);
+  }
+
+  return r + 1;
+}
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : UnpackDSDBits                                                */
+/*                                                                         */
+/* function : Spread the bits of an interleaved, MSB first DSD frame over  */
+/*            a byte each, per channel.                                    */
+/*                                                                         */
+/* pre      : MuxedDSDdata[], E->D.FrameHdr: .NrOfChannels, .NrOfBitsPerCh */
+/*                                                                         */
+/* post     : E->DSDBits[]                                                 */
+/*                                                                         */
+/***************************************************************************/
+
+static void UnpackDSDBits(encbunch *E, uint8_t *MuxedDSDdata)
+{
+  const int  NrOfChannels  = E->D.FrameHdr.NrOfChannels;
+  const int  NrOfBitsPerCh = E->D.FrameHdr.NrOfBitsPerCh;
+  int        BitNr;
+  int        ChNr;
+
+  for (ChNr = 0; ChNr < NrOfChannels; ChNr++)
+  {
+    uint8_t *Bits = &E->DSDBits[ChNr * NrOfBitsPerCh];
+
+    for (BitNr = 0; BitNr < NrOfBitsPerCh; BitNr++)
+    {
+      Bits[BitNr] = (MuxedDSDdata[(BitNr / 8) * NrOfChannels + ChNr] >> (7 - BitNr % 8)) & 1;
+    }
+  }
+}
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : CalcAutoCorr                                                 */
+/*                                                                         */
+/* function : Autocorrelation of the DSD signal of a channel, taking the   */
+/*            bits as +1 and -1.                                           */
+/*                                                                         */
+/* pre      : Bits[], NrOfBits, MaxOrder                                   */
+/*                                                                         */
+/* post     : R[0..MaxOrder]                                               */
+/*                                                                         */
+/***************************************************************************/
+
+static void CalcAutoCorr(const uint8_t *Bits, int NrOfBits, int MaxOrder, double *R)
+{
+  int  Diff;
+  int  k;
+  int  n;
+
+  for (k = 0; k <= MaxOrder; k++)
+  {
+    for (n = k, Diff = 0; n < NrOfBits; n++)
+    {
+      Diff += Bits[n] ^ Bits[n - k];
+    }
+    R[k] = (double) (NrOfBits - k - 2 * Diff);
+  }
+}
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : CalcPredCoefs                                                */
+/*                                                                         */
+/* function : Levinson-Durbin recursion for the coefficients that predict  */
+/*            a sample from the PredOrder samples before it.               */
+/*                                                                         */
+/* pre      : R[0..PredOrder], PredOrder                                   */
+/*                                                                         */
+/* post     : a[0..PredOrder-1], a[k] weighs the sample k+1 back           */
+/*                                                                         */
+/***************************************************************************/
+
+static void CalcPredCoefs(const double *R, int PredOrder, double *a)
+{
+  double  Err;
+  double  k;
+  double  Prev[1 << SIZE_CODEDPREDORDER];
+  int     i;
+  int     j;
+
+  memset(a, 0, PredOrder * sizeof(*a));
+
+  Err = R[0];
+  for (i = 0; i < PredOrder; i++)
+  {
+    /* a (nearly) perfectly predicted signal needs no further taps */
+    if (Err <= R[0] * 1.0e-9)
+    {
+      break;
+    }
+
+    for (j = 0, k = R[i + 1]; j < i; j++)
+    {
+      k -= a[j] * R[i - j];
+    }
+    k /= Err;
+
+    memcpy(Prev, a, i * sizeof(*a));
+    for (j = 0; j < i; j++)
+    {
+      a[j] = Prev[j] - k * Prev[i - 1 - j];
+    }
+    a[i] = k;
+
+    Err *= 1.0 - k * k;
+  }
+}
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : CalcCoefTableI                                               */
+/*                                                                         */
+/* function : Filter output for each value of each byte of the filter      */
+/*            status, as LT_InitCoefTablesI() of the decoder builds it.    */
+/*                                                                         */
+/* pre      : ICoef[], PredOrder                                           */
+/*                                                                         */
+/* post     : ICoefI[][]                                                   */
+/*                                                                         */
+/***************************************************************************/
+
+static void CalcCoefTableI(const int *ICoef, int PredOrder, int16_t ICoefI[16][256])
+{
+  int  TableNr, k, i, j;
+
+  for (TableNr = 0; TableNr < 16; TableNr++)
+  {
+    k = PredOrder - TableNr * 8;
+    if (k > 8)
+    {
+      k = 8;
+    }
+    else if (k < 0)
+    {
+      k = 0;
+    }
+    for (i = 0; i < 256; i++)
+    {
+      int cvalue = 0;
+      for (j = 0; j < k; j++)
+      {
+        cvalue += (((i >> j) & 1) * 2 - 1) * ICoef[TableNr * 8 + j];
+      }
+      ICoefI[TableNr][i] = (int16_t)cvalue;
+    }
+  }
+}
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : RunFilter                                                    */
+/*                                                                         */
+/* function : Prediction of the next bit from the filter status, as        */
+/*            LT_RUN_FILTER_I() of the decoder computes it (wrapping at    */
+/*            16 bits). The tables past the prediction order are zero and  */
+/*            left out.                                                    */
+/*                                                                         */
+/***************************************************************************/
+
+static __inline int16_t RunFilter(int16_t ICoefI[16][256], const uint8_t *Status, int NrOfTables)
+{
+  int16_t  Predict = 0;
+  int      TableNr;
+
+  for (TableNr = 0; TableNr < NrOfTables; TableNr++)
+  {
+    Predict += ICoefI[TableNr][Status[TableNr]];
+  }
+
+  return Predict;
+}
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : UpdateStatus                                                 */
+/*                                                                         */
+/* function : Shift a bit into the filter status, as the decoder does.     */
+/*                                                                         */
+/***************************************************************************/
+
+static __inline void UpdateStatus(uint32_t *st, int BitVal)
+{
+  st[3] = (st[3] << 1) | ((st[2] >> 31) & 1);
+  st[2] = (st[2] << 1) | ((st[1] >> 31) & 1);
+  st[1] = (st[1] << 1) | ((st[0] >> 31) & 1);
+  st[0] = (st[0] << 1) | BitVal;
+}
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : CalcHistogram                                                */
+/*                                                                         */
+/* function : Count the right and wrong predictions of a filter per Ptable */
+/*            index, leaving out the first NrOfHalfBits bits (coded with   */
+/*            p=0.5).                                                      */
+/*                                                                         */
+/* pre      : Bits[], NrOfBits, NrOfHalfBits, ICoefI[][], PredOrder        */
+/*                                                                         */
+/* post     : Hist[][0] counts the wrong, Hist[][1] the right predictions  */
+/*            (added to what it holds)                                     */
+/*                                                                         */
+/***************************************************************************/
+
+static void CalcHistogram(const uint8_t *Bits, int NrOfBits, int NrOfHalfBits,
+                          int16_t ICoefI[16][256], int PredOrder, long Hist[AC_HISMAX][2])
+{
+  const int  NrOfTables = (PredOrder + 7) / 8;
+  uint32_t   Status[4];
+  int16_t    Predict;
+  int        BitNr;
+  int        Index;
+  int        Residual;
+
+  memset(Status, 0xaa, sizeof(Status));
+
+  for (BitNr = 0; BitNr < NrOfBits; BitNr++)
+  {
+    Predict = RunFilter(ICoefI, (uint8_t *) Status, NrOfTables);
+
+    if (BitNr >= NrOfHalfBits)
+    {
+      Residual = (Bits[BitNr] ^ (((uint16_t)Predict) >> 15)) & 1;
+      Index = (Predict > 0 ? Predict : -Predict) >> AC_QSTEP;
+      if (Index >= AC_HISMAX)
+      {
+        Index = AC_HISMAX - 1;
+      }
+      Hist[Index][Residual]++;
+    }
+
+    UpdateStatus(Status, Bits[BitNr]);
+  }
+}
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : CalcEntry                                                    */
+/*                                                                         */
+/* function : Ptable entry for the given counts of wrong and right         */
+/*            predictions, and the bits the arithmetic coder needs for     */
+/*            them.                                                        */
+/*                                                                         */
+/***************************************************************************/
+
+static int CalcEntry(long Wrong, long Right, int Default, double *Bits)
+{
+  int  p;
+
+  if (Wrong + Right == 0)
+  {
+    *Bits = 0.0;
+    return Default;
+  }
+
+  p = (int) ((AC_PROBS * (double) Wrong) / (Wrong + Right) + 0.5);
+  p = MAX(1, MIN(AC_PROBS / 2, p));
+
+  *Bits = Wrong * log2((double) AC_PROBS / p) + Right * log2((double) AC_PROBS / (AC_PROBS - p));
+  return p;
+}
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : CalcPtable                                                   */
+/*                                                                         */
+/* function : Ptable for the histogram of a filter, of the length that     */
+/*            takes the fewest bits (the last entry covers all higher      */
+/*            indexes).                                                    */
+/*                                                                         */
+/* pre      : CP, Hist[][]                                                 */
+/*                                                                         */
+/* post     : T->PtableLen, T->P_one[], returns the bits of the Ptable and */
+/*            of the arithmetic code of the bits it covers                 */
+/*                                                                         */
+/***************************************************************************/
+
+static double CalcPtable(CodedTable *CP, long Hist[AC_HISMAX][2], TableSet *T)
+{
+  double  BestBits;
+  double  Bits;
+  double  EntryBits[AC_HISMAX];
+  double  TailBits;
+  long    Wrong;
+  long    Right;
+  int     Entry[AC_HISMAX];
+  int     Len;
+  int     MaxLen;
+  int     j;
+
+  /* entries up to the last index in use */
+  for (MaxLen = AC_HISMAX; MaxLen > 1 && Hist[MaxLen - 1][0] + Hist[MaxLen - 1][1] == 0; MaxLen--)
+    ;
+  for (j = 0; j < MaxLen; j++)
+  {
+    Entry[j] = CalcEntry(Hist[j][0], Hist[j][1], (j > 0) ? Entry[j - 1] : AC_PROBS / 2, &EntryBits[j]);
+  }
+
+  /* a Ptable of one entry is 128, it takes no bits in the stream */
+  for (j = 0, Wrong = 0, Right = 0; j < MaxLen; j++)
+  {
+    Wrong += Hist[j][0];
+    Right += Hist[j][1];
+  }
+  BestBits = AC_HISBITS + Wrong + Right;
+  T->PtableLen = 1;
+  T->P_one[0]  = AC_PROBS / 2;
+
+  for (Len = MaxLen; Len > 1; Len--)
+  {
+    /* the last entry merges the tail */
+    Wrong = 0;
+    Right = 0;
+    for (j = Len - 1; j < MaxLen; j++)
+    {
+      Wrong += Hist[j][0];
+      Right += Hist[j][1];
+    }
+    Entry[Len - 1] = CalcEntry(Wrong, Right, Entry[Len - 2], &TailBits);
+
+    for (j = 0, Bits = TailBits; j < Len - 1; j++)
+    {
+      Bits += EntryBits[j];
+    }
+    if (Bits + AC_HISBITS >= BestBits)
+    {
+      continue;
+    }
+
+    Bits += AC_HISBITS + CCP_CalcCoding(CP, 0, Entry, Len);
+    if (Bits < BestBits)
+    {
+      BestBits = Bits;
+      T->PtableLen = Len;
+      memcpy(T->P_one, Entry, Len * sizeof(*Entry));
+    }
+  }
+
+  return BestBits;
+}
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : CalcTableSet                                                 */
+/*                                                                         */
+/* function : Quantize a filter, and find its Ptable and the bits they     */
+/*            take for the given channels.                                 */
+/*                                                                         */
+/* pre      : E->DSDBits[], FirstCh, NrOfCh, a[], PredOrder, Scale         */
+/*                                                                         */
+/* post     : T                                                            */
+/*                                                                         */
+/***************************************************************************/
+
+static void CalcTableSet(encbunch *E, int FirstCh, int NrOfCh, const double *a, int PredOrder, double Scale, TableSet *T)
+{
+  const int  NrOfBitsPerCh = E->D.FrameHdr.NrOfBitsPerCh;
+  long       Hist[AC_HISMAX][2];
+  int        ChNr;
+  int        CoefNr;
+
+  T->PredOrder = PredOrder;
+  for (CoefNr = 0; CoefNr < PredOrder; CoefNr++)
+  {
+    T->ICoef[CoefNr] = (int) floor(a[CoefNr] * Scale + 0.5);
+    T->ICoef[CoefNr] = MAX(-(1 << (SIZE_PREDCOEF - 1)), MIN((1 << (SIZE_PREDCOEF - 1)) - 1, T->ICoef[CoefNr]));
+  }
+
+  /* the tables of the chosen filters are made when the frame is coded */
+  CalcCoefTableI(T->ICoef, PredOrder, E->ICoefI[0]);
+
+  memset(Hist, 0, sizeof(Hist));
+  for (ChNr = FirstCh; ChNr < FirstCh + NrOfCh; ChNr++)
+  {
+    CalcHistogram(&E->DSDBits[ChNr * NrOfBitsPerCh], NrOfBitsPerCh, PredOrder, E->ICoefI[0], PredOrder, Hist);
+  }
+
+  T->Bits  = SIZE_CODEDPREDORDER + CCP_CalcCoding(&E->D.StrFilter, 0, T->ICoef, PredOrder);
+  T->Bits += CalcPtable(&E->D.StrPtable, Hist, T);
+  T->Bits += NrOfCh * PredOrder;
+}
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : ChooseTableSet                                               */
+/*                                                                         */
+/* function : Try the filters the effort level allows for the given        */
+/*            channels and keep the one that takes the fewest bits.        */
+/*                                                                         */
+/* pre      : E->Effort, E->DSDBits[], FirstCh, NrOfCh, R[] (summed over   */
+/*            the channels)                                                */
+/*                                                                         */
+/* post     : Best                                                         */
+/*                                                                         */
+/***************************************************************************/
+
+static void ChooseTableSet(encbunch *E, int FirstCh, int NrOfCh, const double *R, TableSet *Best)
+{
+  TableSet  T;
+  double    a[1 << SIZE_CODEDPREDORDER];
+  double    MaxCoef;
+  double    Scale;
+  int       PredOrder;
+  int       OrderNr;
+  int       ScaleNr;
+  int       k;
+
+  Best->Bits = -1.0;
+
+  for (OrderNr = 0; OrderNr < ((E->Effort >= HALF_ORDER_EFFORT) ? 2 : 1); OrderNr++)
+  {
+    PredOrder = EffortPredOrder[E->Effort] >> OrderNr;
+    CalcPredCoefs(R, PredOrder, a);
+
+    for (k = 0, MaxCoef = 0.0; k < PredOrder; k++)
+    {
+      MaxCoef = MAX(MaxCoef, fabs(a[k]));
+    }
+
+    for (ScaleNr = 0; ScaleNr < EffortScaleCount[E->Effort]; ScaleNr++)
+    {
+      /* the largest scale the coefficients fit, the prediction of a sure
+         bit then spreads over the Ptable indexes */
+      Scale = EffortScale[ScaleNr] * MIN(AC_PROBS, ((1 << (SIZE_PREDCOEF - 1)) - 1) / MAX(MaxCoef, 1.0e-3));
+      if (Scale * MaxCoef > (1 << (SIZE_PREDCOEF - 1)) && ScaleNr > 0)
+      {
+        continue;
+      }
+
+      CalcTableSet(E, FirstCh, NrOfCh, a, PredOrder, Scale, &T);
+      if (Best->Bits < 0.0 || T.Bits < Best->Bits)
+      {
+        *Best = T;
+      }
+    }
+  }
+}
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : SetFrameHeader                                               */
+/*                                                                         */
+/* function : Fill in the frame header and the coded tables for one        */
+/*            segment per channel, with a filter and Ptable per channel or */
+/*            one for all channels.                                        */
+/*                                                                         */
+/* pre      : Sets[0..NrOfFilters-1], NrOfFilters (1 or NrOfChannels)      */
+/*                                                                         */
+/* post     : D->FrameHdr, D->StrFilter, D->StrPtable, D->P_one[][]        */
+/*                                                                         */
+/***************************************************************************/
+
+static void SetFrameHeader(ebunch *D, TableSet *Sets, int NrOfFilters)
+{
+  FrameHeader  *FH = &D->FrameHdr;
+  int          ChNr;
+  int          CoefNr;
+  int          FilterNr;
+
+  FH->DSTCoded      = 1;
+  FH->NrOfFilters   = NrOfFilters;
+  FH->NrOfPtables   = NrOfFilters;
+  FH->PSameSegAsF   = 1;
+  FH->PSameMapAsF   = 1;
+  FH->FSameSegAllCh = 1;
+  FH->PSameSegAllCh = 1;
+  FH->FSameMapAllCh = (NrOfFilters == 1);
+  FH->PSameMapAllCh = (NrOfFilters == 1);
+  FH->FSeg.Resolution = 1;
+  FH->PSeg.Resolution = 1;
+
+  for (ChNr = 0; ChNr < FH->NrOfChannels; ChNr++)
+  {
+    FH->FSeg.NrOfSegments[ChNr]     = 1;
+    FH->FSeg.SegmentLen[ChNr][0]    = 0;
+    FH->FSeg.Table4Segment[ChNr][0] = (NrOfFilters == 1) ? 0 : ChNr;
+    FH->PSeg.NrOfSegments[ChNr]     = 1;
+    FH->PSeg.SegmentLen[ChNr][0]    = 0;
+    FH->PSeg.Table4Segment[ChNr][0] = FH->FSeg.Table4Segment[ChNr][0];
+    FH->HalfProb[ChNr]              = 1;
+    FH->NrOfHalfBits[ChNr]          = Sets[FH->FSeg.Table4Segment[ChNr][0]].PredOrder;
+  }
+
+  for (FilterNr = 0; FilterNr < NrOfFilters; FilterNr++)
+  {
+    TableSet *T = &Sets[FilterNr];
+
+    FH->PredOrder[FilterNr] = T->PredOrder;
+    for (CoefNr = 0; CoefNr < (1 << SIZE_CODEDPREDORDER); CoefNr++)
+    {
+      FH->ICoefA[FilterNr][CoefNr] = (int16_t) ((CoefNr < T->PredOrder) ? T->ICoef[CoefNr] : 0);
+    }
+    CCP_CalcCoding(&D->StrFilter, FilterNr, T->ICoef, T->PredOrder);
+
+    FH->PtableLen[FilterNr] = T->PtableLen;
+    memcpy(D->P_one[FilterNr], T->P_one, T->PtableLen * sizeof(*T->P_one));
+    if (T->PtableLen > 1)
+    {
+      CCP_CalcCoding(&D->StrPtable, FilterNr, T->P_one, T->PtableLen);
+    }
+    else
+    {
+      D->StrPtable.Coded[FilterNr]      = 0;
+      D->StrPtable.BestMethod[FilterNr] = -1;
+    }
+  }
+}
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : EncodeArithmeticData                                         */
+/*                                                                         */
+/* function : Predict all bits of the frame and arithmetic encode the      */
+/*            residuals, in the order the decoder takes them.              */
+/*                                                                         */
+/* pre      : E->DSDBits[], D->FrameHdr, D->P_one[][] (set by              */
+/*            SetFrameHeader)                                              */
+/*                                                                         */
+/* post     : D->AData[], D->ADataLen, returns -1 if the code grows past   */
+/*            the size of a plain DSD frame                                */
+/*                                                                         */
+/***************************************************************************/
+
+static int EncodeArithmeticData(encbunch *E, TableSet *Sets)
+{
+  ebunch       *D = &E->D;
+  FrameHeader  *FH = &D->FrameHdr;
+  ACData       AC;
+  uint32_t     Status[MAX_CHANNELS][4];
+  int16_t      Predict;
+  int          NrOfTables[2 * MAX_CHANNELS];
+  int          BitNr;
+  int          ChNr;
+  int          FilterNr;
+  int          Index;
+  int          Residual;
+  int          Limit;
+  int          p;
+
+  for (FilterNr = 0; FilterNr < FH->NrOfFilters; FilterNr++)
+  {
+    CalcCoefTableI(Sets[FilterNr].ICoef, FH->PredOrder[FilterNr], E->ICoefI[FilterNr]);
+    NrOfTables[FilterNr] = (FH->PredOrder[FilterNr] + 7) / 8;
+  }
+  memset(Status, 0xaa, sizeof(Status));
+
+  /* a symbol shifts out at most AC_BITS code bits */
+  Limit = FH->BitStreamLen - AC_BITS * (MAX_CHANNELS + 2);
+
+  AC.Init = 1;
+  DST_ACEncodeBit(&AC, 0, Reverse7LSBs(FH->ICoefA[0][0]), D->AData, &D->ADataLen, 0);
+
+  for (BitNr = 0; BitNr < FH->NrOfBitsPerCh; BitNr++)
+  {
+    for (ChNr = 0; ChNr < FH->NrOfChannels; ChNr++)
+    {
+      const uint8_t BitVal = E->DSDBits[ChNr * FH->NrOfBitsPerCh + BitNr];
+
+      FilterNr = FH->FSeg.Table4Segment[ChNr][0];
+      Predict  = RunFilter(E->ICoefI[FilterNr], (uint8_t *) Status[ChNr], NrOfTables[FilterNr]);
+      Residual = (BitVal ^ (((uint16_t)Predict) >> 15)) & 1;
+
+      if ((FH->HalfProb[ChNr]) && (BitNr < FH->NrOfHalfBits[ChNr]))
+      {
+        p = AC_PROBS / 2;
+      }
+      else
+      {
+        Index = (Predict > 0 ? Predict : -Predict) >> AC_QSTEP;
+        if (Index >= FH->PtableLen[FilterNr])
+        {
+          Index = FH->PtableLen[FilterNr] - 1;
+        }
+        p = D->P_one[FilterNr][Index];
+      }
+      DST_ACEncodeBit(&AC, (unsigned char) Residual, p, D->AData, &D->ADataLen, 0);
+
+      UpdateStatus(Status[ChNr], BitVal);
+    }
+
+    if (AC.cbptr > Limit)
+    {
+      return -1;
+    }
+  }
+
+  DST_ACEncodeBit(&AC, 0, 0, D->AData, &D->ADataLen, 1);
+
+  return 0;
+}
+
+/*============================================================================*/
+/*       FUNCTION IMPLEMENTATIONS                                             */
+/*============================================================================*/
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : DST_InitEncoder                                              */
+/*                                                                         */
+/* function : Complete initialisation of the DST encoder, the tables are   */
+/*            allocated as for the decoder.                                */
+/*                                                                         */
+/* pre      : NrOfChannels, SampleRate (64, 128 or 256), Effort            */
+/*                                                                         */
+/* post     : E, returns 0 on success                                      */
+/*                                                                         */
+/***************************************************************************/
+
+int DST_InitEncoder(encbunch *E, int NrOfChannels, int SampleRate, int Effort)
+{
+  int  retval;
+
+  memset(E, 0, sizeof(encbunch));
+
+  retval = DST_InitDecoder(&E->D, NrOfChannels, SampleRate);
+  if (retval == 0)
+  {
+    E->Effort  = MAX(MIN_EFFORT, MIN(MAX_EFFORT, Effort));
+    E->DSDBits = (uint8_t *) malloc(E->D.FrameHdr.BitStreamLen);
+    if (E->DSDBits == NULL)
+    {
+      DST_CloseDecoder(&E->D);
+      retval = -1;
+    }
+  }
+
+  return retval;
+}
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : DST_FramDSTEncode                                            */
+/*                                                                         */
+/* function : DST encode a complete frame (all channels).                  */
+/*                                                                         */
+/* pre      : MuxedDSDdata[] (interleaved, MSB first, as on disc),         */
+/*            DSTdata[] with room for a plain DSD frame and its header     */
+/*            byte, E initialised by DST_InitEncoder                       */
+/*                                                                         */
+/* post     : DSTdata[], returns the number of bytes of the DST frame      */
+/*                                                                         */
+/***************************************************************************/
+
+int DST_FramDSTEncode(uint8_t *MuxedDSDdata, uint8_t *DSTdata, int FrameCnt, encbunch *E)
+{
+  ebunch       *D = &E->D;
+  FrameHeader  *FH = &D->FrameHdr;
+  TableSet     Sets[MAX_CHANNELS];
+  TableSet     Shared;
+  double       R[(1 << SIZE_CODEDPREDORDER) + 1];
+  double       Bits;
+  int          ChNr;
+  int          FrameSize;
+  int          MaxOrder;
+  int          PlainSize;
+  int          k;
+
+  FH->FrameNr = FrameCnt;
+  PlainSize   = 1 + FH->ByteStreamLen;
+  MaxOrder    = EffortPredOrder[E->Effort];
+
+  UnpackDSDBits(E, MuxedDSDdata);
+
+  /* a filter for each channel */
+  for (ChNr = 0, Bits = 0.0; ChNr < FH->NrOfChannels; ChNr++)
+  {
+    CalcAutoCorr(&E->DSDBits[ChNr * FH->NrOfBitsPerCh], FH->NrOfBitsPerCh, MaxOrder, E->AutoCorr[ChNr]);
+    ChooseTableSet(E, ChNr, 1, E->AutoCorr[ChNr], &Sets[ChNr]);
+    Bits += Sets[ChNr].Bits + Log2RoundUp(ChNr);
+  }
+
+  /* or one filter for all channels */
+  if (FH->NrOfChannels > 1 && E->Effort >= SHARED_FILTER_EFFORT)
+  {
+    for (k = 0; k <= MaxOrder; k++)
+    {
+      for (ChNr = 0, R[k] = 0.0; ChNr < FH->NrOfChannels; ChNr++)
+      {
+        R[k] += E->AutoCorr[ChNr][k];
+      }
+    }
+    ChooseTableSet(E, 0, FH->NrOfChannels, R, &Shared);
+  }
+  else
+  {
+    Shared.Bits = -1.0;
+  }
+
+  if (Shared.Bits >= 0.0 && Shared.Bits < Bits)
+  {
+    SetFrameHeader(D, &Shared, 1);
+    k = EncodeArithmeticData(E, &Shared);
+  }
+  else
+  {
+    SetFrameHeader(D, Sets, FH->NrOfChannels);
+    k = EncodeArithmeticData(E, Sets);
+  }
+
+  /* keep the coded frame only if it is smaller than the plain one */
+  if (k == 0)
+  {
+    FrameSize = PackDSTframe(D, MuxedDSDdata, DSTdata, PlainSize - 1);
+    if (FrameSize > 0)
+    {
+      return FrameSize;
+    }
+  }
+
+  FH->DSTCoded = 0;
+  return PackDSTframe(D, MuxedDSDdata, DSTdata, PlainSize);
+}
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : DST_CloseEncoder                                             */
+/*                                                                         */
+/* function : Complete termination of the DST encoder.                     */
+/*                                                                         */
+/* pre      : E initialised by DST_InitEncoder                             */
+/*                                                                         */
+/* post     : None                                                         */
+/*                                                                         */
+/***************************************************************************/
+
+int DST_CloseEncoder(encbunch *E)
+{
+  free(E->DSDBits);
+  E->DSDBits = NULL;
+
+  return DST_CloseDecoder(&E->D);
+}
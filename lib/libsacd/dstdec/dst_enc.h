@@ -0,0 +1,39 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef __DST_ENC_H_INCLUDED
+#define __DST_ENC_H_INCLUDED
+
+/*============================================================================*/
+/*       INCLUDES                                                             */
+/*============================================================================*/
+
+#include "types.h"
+
+/*============================================================================*/
+/*       FUNCTION PROTOTYPES                                                  */
+/*============================================================================*/
+
+int DST_InitEncoder(encbunch *E, int NrOfChannels, int SampleRate, int Effort);
+int DST_FramDSTEncode(uint8_t *MuxedDSDdata, uint8_t *DSTdata, int FrameCnt, encbunch *E);
+int DST_CloseEncoder(encbunch *E);
+
+#endif  /* __DST_ENC_H_INCLUDED */
@@ -0,0 +1,254 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <logging.h>
+#include <utils.h>
+#include <timeout.h>
+#include <trace.h>
+
+#include "dst_encoder.h"
+#include "yarn.h"
+#include "dst_enc.h"
+
+/* -- parallel encoding -- */
+
+/* encode jobs in the window for each encode thread, so that a thread finds
+   the next frame queued while the frame before is passed to the callback */
+#define JOBS_PER_THREAD 2
+
+/* DSD silence, pads a short frame */
+#define DSD_SILENCE 0x69
+
+/* an encode thread and its encoder state -- the state of a DST encoder is
+   large (the tables of the decoder and the filter output of every channel),
+   so each thread keeps its own rather than each job */
+typedef struct encode_thread_s
+{
+    dst_encoder_t *encoder;
+    thread *th;
+    encbunch E;
+}
+encode_thread_t;
+
+/* encode the input of a job */
+static void encode_job(dst_encoder_t *dst_encoder, encode_job_t *job, encbunch *E)
+{
+    double start = 0.0;
+    TRACE_BEGIN(span);
+
+    if (dst_encoder->encode_time)
+        start = timeout_gettime();
+
+    job->out_len = (size_t) DST_FramDSTEncode(job->in, job->out, job->frame_nr, E);
+
+    if (dst_encoder->encode_time)
+        metrics_record_time(dst_encoder->encode_time, start);
+    TRACE_END(span, "dst encode", job->frame_nr);
+}
+
+/* take the queued jobs in order and encode them, until told to quit -- the
+   state lock is bumped when a job is queued or done */
+static void encode_thread(void *arg)
+{
+    encode_thread_t *self = (encode_thread_t *) arg;
+    dst_encoder_t *dst_encoder = self->encoder;
+    encode_job_t *job;
+
+    TRACE_THREAD_NAME("dst encode");
+
+    for (;;)
+    {
+        possess(dst_encoder->state);
+        while (dst_encoder->encoding == dst_encoder->sequence && !dst_encoder->quit)
+            wait_for(dst_encoder->state, NOT_TO_BE, peek_lock(dst_encoder->state));
+        if (dst_encoder->encoding == dst_encoder->sequence)
+        {
+            release(dst_encoder->state);
+            break;
+        }
+        job = &dst_encoder->window[dst_encoder->encoding % dst_encoder->window_size];
+        dst_encoder->encoding++;
+        release(dst_encoder->state);
+
+        encode_job(dst_encoder, job, &self->E);
+
+        possess(dst_encoder->state);
+        job->state = ENCODE_JOB_DONE;
+        twist(dst_encoder->state, BY, 1);
+    }
+}
+
+/* pass the encoded frames to the callback in order, waiting for the frames
+   up to until (a sequence number) and taking the ones after as far as they
+   are done */
+static void write_encoded(dst_encoder_t *dst_encoder, long until)
+{
+    encode_job_t *job;
+
+    while (dst_encoder->written < dst_encoder->sequence)
+    {
+        job = &dst_encoder->window[dst_encoder->written % dst_encoder->window_size];
+
+        possess(dst_encoder->state);
+        if (dst_encoder->written >= until && job->state != ENCODE_JOB_DONE)
+        {
+            release(dst_encoder->state);
+            break;
+        }
+        if (job->state != ENCODE_JOB_DONE)
+        {
+            TRACE_BEGIN(wait);
+            while (job->state != ENCODE_JOB_DONE)
+                wait_for(dst_encoder->state, NOT_TO_BE, peek_lock(dst_encoder->state));
+            TRACE_END(wait, "wait for encoded frame", job->frame_nr);
+        }
+        release(dst_encoder->state);
+
+        dst_encoder->frame_encoded_callback(job->out, job->out_len, dst_encoder->userdata);
+
+        /* only the calling thread queues jobs, so a free job is left alone */
+        job->state = ENCODE_JOB_FREE;
+        dst_encoder->written++;
+    }
+}
+
+dst_encoder_t* dst_encoder_create(int channel_count, int sample_rate, int effort, int procs, frame_encoded_callback_t frame_encoded_callback, void *userdata)
+{
+    dst_encoder_t *dst_encoder;
+    size_t out_size;
+    int i;
+
+    if (sample_rate != 64 && sample_rate != 128 && sample_rate != 256)
+    {
+        LOG(lm_main, LOG_ERROR, ("ERROR: DST encoder does not support sample rate %d", sample_rate));
+        return NULL;
+    }
+
+    if (procs <= 0)
+        procs = (int) processor_count();
+    if (procs < 1)
+        procs = 1;
+
+    dst_encoder = (dst_encoder_t *) calloc(1, sizeof(dst_encoder_t));
+    if (dst_encoder == NULL)
+        exit(1);
+
+    dst_encoder->procs = procs;
+    dst_encoder->channel_count = channel_count;
+    dst_encoder->sample_rate = sample_rate;
+    dst_encoder->effort = effort;
+    dst_encoder->frame_size = (size_t) 588 * sample_rate / 8 * channel_count;
+    dst_encoder->frame_encoded_callback = frame_encoded_callback;
+    dst_encoder->userdata = userdata;
+
+    dst_encoder->threads = (encode_thread_t *) calloc(procs, sizeof(encode_thread_t));
+    if (dst_encoder->threads == NULL)
+        exit(1);
+    for (i = 0; i < procs; i++)
+    {
+        if (DST_InitEncoder(&dst_encoder->threads[i].E, channel_count, sample_rate, effort) != 0)
+        {
+            LOG(lm_main, LOG_ERROR, ("ERROR: could not initialize the DST encoder for %d channels", channel_count));
+            while (i-- > 0)
+                DST_CloseEncoder(&dst_encoder->threads[i].E);
+            free(dst_encoder->threads);
+            free(dst_encoder);
+            return NULL;
+        }
+        dst_encoder->threads[i].encoder = dst_encoder;
+    }
+
+    out_size = DST_ENCODER_MAX_FRAME_SIZE(channel_count, sample_rate);
+    dst_encoder->window_size = JOBS_PER_THREAD * procs;
+    dst_encoder->window = (encode_job_t *) calloc(dst_encoder->window_size, sizeof(encode_job_t));
+    dst_encoder->window_buffers = (uint8_t *) malloc(dst_encoder->window_size * (dst_encoder->frame_size + out_size));
+    if (dst_encoder->window == NULL || dst_encoder->window_buffers == NULL)
+        exit(1);
+    for (i = 0; i < dst_encoder->window_size; i++)
+    {
+        dst_encoder->window[i].in = dst_encoder->window_buffers + i * (dst_encoder->frame_size + out_size);
+        dst_encoder->window[i].out = dst_encoder->window[i].in + dst_encoder->frame_size;
+    }
+
+    dst_encoder->state = new_lock(0);
+    for (i = 0; i < procs; i++)
+        dst_encoder->threads[i].th = launch(encode_thread, &dst_encoder->threads[i]);
+
+    return dst_encoder;
+}
+
+void dst_encoder_destroy(dst_encoder_t *dst_encoder)
+{
+    int i;
+
+    dst_encoder_flush(dst_encoder);
+
+    possess(dst_encoder->state);
+    dst_encoder->quit = 1;
+    twist(dst_encoder->state, BY, 1);
+
+    for (i = 0; i < dst_encoder->procs; i++)
+    {
+        join(dst_encoder->threads[i].th);
+        DST_CloseEncoder(&dst_encoder->threads[i].E);
+    }
+
+    free_lock(dst_encoder->state);
+    free(dst_encoder->window_buffers);
+    free(dst_encoder->window);
+    free(dst_encoder->threads);
+    free(dst_encoder);
+}
+
+void dst_encoder_encode(dst_encoder_t *dst_encoder, uint8_t* frame_data, size_t frame_size)
+{
+    encode_job_t *job;
+
+    /* make room for the frame, the oldest frame is waited for when the window is full */
+    write_encoded(dst_encoder, dst_encoder->sequence - dst_encoder->window_size + 1);
+
+    job = &dst_encoder->window[dst_encoder->sequence % dst_encoder->window_size];
+    if (frame_size > dst_encoder->frame_size)
+        frame_size = dst_encoder->frame_size;
+    memcpy(job->in, frame_data, frame_size);
+    memset(job->in + frame_size, DSD_SILENCE, dst_encoder->frame_size - frame_size);
+    job->frame_nr = (int) dst_encoder->sequence;
+    job->out_len = 0;
+
+    possess(dst_encoder->state);
+    job->state = ENCODE_JOB_QUEUED;
+    dst_encoder->sequence++;
+    twist(dst_encoder->state, BY, 1);
+}
+
+void dst_encoder_set_metrics(dst_encoder_t *dst_encoder, metrics_t *metrics)
+{
+    dst_encoder->encode_time = metrics_histogram(metrics, "dst encode", "us per frame");
+}
+
+void dst_encoder_flush(dst_encoder_t *dst_encoder)
+{
+    write_encoded(dst_encoder, dst_encoder->sequence);
+}
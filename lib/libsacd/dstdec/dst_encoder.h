@@ -0,0 +1,119 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef DST_ENCODER_H
+#define DST_ENCODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "metrics.h"
+#include "yarn.h"
+
+struct dst_encoder_s;
+struct encode_thread_s;
+
+/* states of an encode job, a job cycles from free to queued (filled in by
+   dst_encoder_encode) to done (encoded by an encode thread) and back to free
+   (once passed to the callback) */
+#define ENCODE_JOB_FREE    0
+#define ENCODE_JOB_QUEUED  1
+#define ENCODE_JOB_DONE    2
+
+/* encode job, in the window at seq % window_size */
+typedef struct encode_job_t
+{
+    int state;                                /* ENCODE_JOB_FREE, _QUEUED or _DONE */
+    int frame_nr;                             /* DSD frame number */
+    uint8_t *in;                              /* input DSD data to encode */
+    uint8_t *out;                             /* resulting DST frame */
+    size_t out_len;
+}
+encode_job_t;
+
+/* effort levels, from the fastest encoding to the smallest frames -- the
+   effort sets the prediction order (16 to 128) and how many filter variants
+   are tried for a frame */
+#define DST_ENCODER_MIN_EFFORT     1
+#define DST_ENCODER_MAX_EFFORT     9
+#define DST_ENCODER_DEFAULT_EFFORT 5
+
+/* bytes of a DST frame at most, the plain DSD frame and a header byte */
+#define DST_ENCODER_MAX_FRAME_SIZE(channel_count, sample_rate) ((size_t) 588 * (sample_rate) / 8 * (channel_count) + 1)
+
+/* an encoded frame is handed over in the order the DSD frames came in, from
+   the thread calling dst_encoder_encode() or dst_encoder_flush() */
+typedef void (*frame_encoded_callback_t)(uint8_t* frame_data, size_t frame_size, void *userdata);
+
+typedef struct dst_encoder_s
+{
+    int procs;            /* number of encode threads (>= 1) */
+    int channel_count;
+    int sample_rate;      /* multiple of 44.1 kHz: 64, 128 or 256 */
+    int effort;           /* DST_ENCODER_MIN_EFFORT .. DST_ENCODER_MAX_EFFORT */
+    size_t frame_size;    /* bytes of a DSD frame */
+
+    /* sequence numbers, all guarded by state */
+    long sequence;        /* frames passed to dst_encoder_encode() */
+    long encoding;        /* frames taken by the encode threads */
+    long written;         /* frames passed to the callback */
+    int quit;             /* tells the encode threads to return */
+
+    /* window of preallocated jobs -- it bounds the frames queued, being
+       encoded and waiting to be passed to the callback */
+    encode_job_t *window;
+    int window_size;
+    uint8_t *window_buffers;  /* input and output buffers of all jobs */
+
+    lock *state;              /* guards the jobs, bumped on every change */
+
+    struct encode_thread_s *threads;  /* encode threads, with the DST encoder state of each */
+
+    frame_encoded_callback_t frame_encoded_callback;
+    void *userdata;
+
+    metric_t *encode_time;    /* microseconds per frame, or NULL */
+} dst_encoder_t;
+
+/* create an encoder for frames of channel_count channels at sample_rate
+   times 44.1 kHz (64, 128 or 256) running procs encode threads, 0 for one
+   per processor -- NULL for other rates or when out of memory */
+dst_encoder_t* dst_encoder_create(int channel_count, int sample_rate, int effort, int procs, frame_encoded_callback_t frame_encoded_callback, void *userdata);
+
+/* pass the frames still being encoded to the callback, stop the encode
+   threads and free the encoder */
+void dst_encoder_destroy(dst_encoder_t *dst_encoder);
+
+/* queue an interleaved DSD frame (MSB first, as on disc) for encoding, a
+   shorter frame is padded with DSD silence -- frames encoded by then are
+   passed to the callback, and when the window is full it waits for the
+   oldest one */
+void dst_encoder_encode(dst_encoder_t *dst_encoder, uint8_t* frame_data, size_t frame_size);
+
+/* record the encoding time of each frame in metrics, call before the first
+   frame is passed to dst_encoder_encode() */
+void dst_encoder_set_metrics(dst_encoder_t *dst_encoder, metrics_t *metrics);
+
+/* wait until all frames passed to dst_encoder_encode() went through the
+   callback */
+void dst_encoder_flush(dst_encoder_t *dst_encoder);
+
+
+#endif /* DST_ENCODER_H */
@@ -183,7 +183,7 @@ static __inline int LT_ACGetPtableIndex(int16_t PredicVal, int PtableLen)
 /*                                                                         */
 /***************************************************************************/
 
-static void FillTable4Bit(int NrOfChannels, int NrOfBitsPerCh, Segment *S, char Table4Bit[MAX_CHANNELS][MAX_DSDBITS_INFRAME])
+static void FillTable4Bit(int NrOfChannels, int NrOfBitsPerCh, Segment *S, char **Table4Bit)
 {
     int BitNr;
     int ChNr;
@@ -282,20 +282,6 @@ static void LT_InitStatus(ebunch *D, uint8_t Status[MAX_CHANNELS][16])
     }
 }
 
-/***************************************************************************/
-/*                                                                         */
-/* name     : DST_FramDSTDecode                                            */
-/*                                                                         */
-/* function : DST decode a complete frame (all channels)     .             */
-/*                                                                         */
-/* pre      : D->CodOpt  : .NrOfBitsPerCh, .NrOfChannels,                  */
-/*            D->FrameHdr: .PredOrder[], .NrOfHalfBits[], .ICoefA[][],     */
-/*                         .NrOfFilters, .NrOfPtables, .FrameNr            */
-/*            D->P_one[][], D->AData[], D->ADataLen,                       */
-/*                                                                         */
-/* post     : D->WM.Pwm                                                    */
-/*                                                                         */
-/***************************************************************************/
 #define LT_RUN_FILTER_I(FilterTable, ChannelStatus) \
     Predict  = FilterTable[ 0][ChannelStatus[ 0]]; \
     Predict += FilterTable[ 1][ChannelStatus[ 1]]; \
@@ -329,94 +315,159 @@ static void LT_InitStatus(ebunch *D, uint8_t Status[MAX_CHANNELS][16])
         Predict = (Predict32 >> 16) + (Predict32 & 0xffff); \
     }
 
-int DST_FramDSTDecode(uint8_t *DSTdata, uint8_t *MuxedDSDdata, int FrameSizeInBytes, int FrameCnt, ebunch *D)
+/* Per frame state of the bit decoding loop, kept apart from the ebunch so
+   that several frames can be decoded in lockstep by one thread */
+typedef struct
+{
+#ifdef _MSC_VER
+    __declspec(align(16)) int16_t  ICoefI[2 * MAX_CHANNELS][16][256];
+    __declspec(align(16)) uint8_t  Status[MAX_CHANNELS][16];
+#else
+    int16_t  ICoefI[2 * MAX_CHANNELS][16][256]  __attribute__ ((aligned (16)));
+    uint8_t  Status[MAX_CHANNELS][16] __attribute__ ((aligned (16)));
+#endif
+    ACData   AC;
+    uint8_t  *MuxedDSD;
+    int      ByteStep;                     /* MuxedDSD[] distance of successive bytes of a channel */
+    int      ChStep;                       /* MuxedDSD[] distance of successive channels */
+    int      BitXor;                       /* 7 for MSB first, 0 for LSB first */
+    int      Active;                       /* 1 if the bit loop must run for this frame */
+} LT_FrameState;
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : LT_DecodeBegin                                               */
+/*                                                                         */
+/* function : Unpack a DST frame and prepare the bit decoding loop.        */
+/*                                                                         */
+/* pre      : DSTdata, FrameSizeInBytes, FrameCnt, D                       */
+/*                                                                         */
+/* post     : F->Active, F->ICoefI[][][], F->Status[][], F->AC,            */
+/*            returns the unpack error                                     */
+/*                                                                         */
+/***************************************************************************/
+static int LT_DecodeBegin(uint8_t *DSTdata, uint8_t *MuxedDSDdata, int FrameSizeInBytes, int FrameCnt, ebunch *D, LT_FrameState *F)
 {
     int       error;
-    int       BitNr;
-    int       ChNr;
     uint8_t   ACError;
     const int NrOfBitsPerCh = D->FrameHdr.NrOfBitsPerCh;
     const int NrOfChannels = D->FrameHdr.NrOfChannels;
-    uint8_t   *MuxedDSD = MuxedDSDdata;
 
     D->FrameHdr.FrameNr       = FrameCnt;
     D->FrameHdr.CalcNrOfBytes = FrameSizeInBytes;
     D->FrameHdr.CalcNrOfBits  = D->FrameHdr.CalcNrOfBytes * 8;
 
+    F->MuxedDSD = MuxedDSDdata;
+    F->Active = 0;
+    if (D->Planar)
+    {
+        F->ByteStep = 1;
+        F->ChStep = NrOfBitsPerCh / 8;
+        F->BitXor = 0;
+    }
+    else
+    {
+        F->ByteStep = NrOfChannels;
+        F->ChStep = 1;
+        F->BitXor = 7;
+    }
+
     /* unpack DST frame: segmentation, mapping, arithmatic data */
     error = UnpackDSTframe(D, DSTdata, MuxedDSDdata);
 
     if (error == DSTErr_NoError && D->FrameHdr.DSTCoded == 1)
     {
-        ACData AC;
-#ifdef _MSC_VER
-        __declspec(align(16)) int16_t  LT_ICoefI[2 * MAX_CHANNELS][16][256];
-        __declspec(align(16)) uint8_t  LT_Status[MAX_CHANNELS][16];
-#else
-        int16_t  LT_ICoefI[2 * MAX_CHANNELS][16][256]  __attribute__ ((aligned (16)));
-        uint8_t  LT_Status[MAX_CHANNELS][16] __attribute__ ((aligned (16)));
-#endif
-
         FillTable4Bit(NrOfChannels, NrOfBitsPerCh, &D->FrameHdr.FSeg, D->FrameHdr.Filter4Bit);
         FillTable4Bit(NrOfChannels, NrOfBitsPerCh, &D->FrameHdr.PSeg, D->FrameHdr.Ptable4Bit);
 
-        LT_InitCoefTablesI(D, LT_ICoefI);
+        LT_InitCoefTablesI(D, F->ICoefI);
         //LT_InitCoefTablesU(D, LT_ICoefU);
-        LT_InitStatus(D, LT_Status);
+        LT_InitStatus(D, F->Status);
 
-        LT_ACDecodeBit_Init(&AC, D->AData, D->ADataLen);
-        LT_ACDecodeBit_Decode(&AC, &ACError, Reverse7LSBs(D->FrameHdr.ICoefA[0][0]), D->AData, D->ADataLen);
+        LT_ACDecodeBit_Init(&F->AC, D->AData, D->ADataLen);
+        LT_ACDecodeBit_Decode(&F->AC, &ACError, Reverse7LSBs(D->FrameHdr.ICoefA[0][0]), D->AData, D->ADataLen);
 
-        memset(MuxedDSD, 0, NrOfBitsPerCh * NrOfChannels / 8); 
-        for (BitNr = 0; BitNr < NrOfBitsPerCh; BitNr++)
-        {
-            int ByteNr = BitNr / 8;
+        memset(MuxedDSDdata, 0, NrOfBitsPerCh * NrOfChannels / 8); 
+        F->Active = 1;
+    }
 
-            for (ChNr = 0; ChNr < NrOfChannels; ChNr++)
-            {
-                int16_t Predict;
-                uint8_t Residual;
-                int16_t BitVal;
-                const int Filter = D->FrameHdr.Filter4Bit[ChNr][BitNr];
-
-                /* Calculate output value of the FIR filter */
-                LT_RUN_FILTER_I(LT_ICoefI[Filter], LT_Status[ChNr]);
-                //LT_RUN_FILTER_U(LT_ICoefU[Filter], LT_Status[ChNr]);
-                //Predict = LT_RunFilterI(LT_ICoefI[Filter], LT_Status[ChNr]);
-                //Predict = LT_RunFilterU(LT_ICoefU[Filter], LT_Status[ChNr]);
-
-                /* Arithmetic decode the incoming bit */
-                if ((D->FrameHdr.HalfProb[ChNr]/* == 1*/) && (BitNr < D->FrameHdr.NrOfHalfBits[ChNr]))
-                {
-                    LT_ACDecodeBit_Decode(&AC, &Residual, AC_PROBS / 2, D->AData, D->ADataLen);
-                }
-                else
-                {
-                    const int table4bit = D->FrameHdr.Ptable4Bit[ChNr][BitNr];
-                    const int PtableIndex = LT_ACGetPtableIndex(Predict, D->FrameHdr.PtableLen[table4bit]);
+    return error;
+}
 
-                    LT_ACDecodeBit_Decode(&AC, &Residual, D->P_one[table4bit][PtableIndex], D->AData, D->ADataLen);
-                }
+/***************************************************************************/
+/*                                                                         */
+/* name     : LT_DecodeBit                                                 */
+/*                                                                         */
+/* function : Decode one bit of one channel: predict, arithmetic decode    */
+/*            the residual and update the filter status.                   */
+/*                                                                         */
+/* pre      : D, F prepared by LT_DecodeBegin(), BitNr, ChNr               */
+/*                                                                         */
+/* post     : F->MuxedDSD[], F->Status[ChNr][], F->AC                      */
+/*                                                                         */
+/***************************************************************************/
+static __inline void LT_DecodeBit(ebunch *D, LT_FrameState *F, const int BitNr, const int ChNr)
+{
+    int16_t Predict;
+    uint8_t Residual;
+    int16_t BitVal;
+    const int Filter = D->FrameHdr.Filter4Bit[ChNr][BitNr];
+
+    /* Calculate output value of the FIR filter */
+    LT_RUN_FILTER_I(F->ICoefI[Filter], F->Status[ChNr]);
+    //LT_RUN_FILTER_U(LT_ICoefU[Filter], LT_Status[ChNr]);
+    //Predict = LT_RunFilterI(LT_ICoefI[Filter], LT_Status[ChNr]);
+    //Predict = LT_RunFilterU(LT_ICoefU[Filter], LT_Status[ChNr]);
+
+    /* Arithmetic decode the incoming bit */
+    if ((D->FrameHdr.HalfProb[ChNr]/* == 1*/) && (BitNr < D->FrameHdr.NrOfHalfBits[ChNr]))
+    {
+        LT_ACDecodeBit_Decode(&F->AC, &Residual, AC_PROBS / 2, D->AData, D->ADataLen);
+    }
+    else
+    {
+        const int table4bit = D->FrameHdr.Ptable4Bit[ChNr][BitNr];
+        const int PtableIndex = LT_ACGetPtableIndex(Predict, D->FrameHdr.PtableLen[table4bit]);
 
-                /* Channel bit depends on the predicted bit and BitResidual[][] */
-                BitVal = ((((uint16_t)Predict) >> 15) ^ Residual) & 1;
+        LT_ACDecodeBit_Decode(&F->AC, &Residual, D->P_one[table4bit][PtableIndex], D->AData, D->ADataLen);
+    }
 
-                /* Shift the result into the correct bit position */ \
-                MuxedDSD[ByteNr * NrOfChannels + ChNr] |= (uint8_t)(BitVal << (7 - BitNr % 8));
+    /* Channel bit depends on the predicted bit and BitResidual[][] */
+    BitVal = ((((uint16_t)Predict) >> 15) ^ Residual) & 1;
 
-                /* Update filter */
-                {
-                    uint32_t* const st = (uint32_t*)LT_Status[ChNr];
-                    st[3] = (st[3] << 1) | ((st[2] >> 31) & 1);
-                    st[2] = (st[2] << 1) | ((st[1] >> 31) & 1);
-                    st[1] = (st[1] << 1) | ((st[0] >> 31) & 1);
-                    st[0] = (st[0] << 1) | BitVal;
-                }
-            }
-        }
+    /* Shift the result into the correct bit position */
+    F->MuxedDSD[(BitNr / 8) * F->ByteStep + ChNr * F->ChStep] |= (uint8_t)(BitVal << ((BitNr % 8) ^ F->BitXor));
+
+    /* Update filter */
+    {
+        uint32_t* const st = (uint32_t*)F->Status[ChNr];
+        st[3] = (st[3] << 1) | ((st[2] >> 31) & 1);
+        st[2] = (st[2] << 1) | ((st[1] >> 31) & 1);
+        st[1] = (st[1] << 1) | ((st[0] >> 31) & 1);
+        st[0] = (st[0] << 1) | BitVal;
+    }
+}
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : LT_DecodeEnd                                                 */
+/*                                                                         */
+/* function : Flush the arithmetic decoder and silence the frame output    */
+/*            in case of an error.                                         */
+/*                                                                         */
+/* pre      : error returned by LT_DecodeBegin(), D, F                     */
+/*                                                                         */
+/* post     : returns the frame error                                      */
+/*                                                                         */
+/***************************************************************************/
+static int LT_DecodeEnd(int error, ebunch *D, LT_FrameState *F)
+{
+    uint8_t ACError;
 
+    if (F->Active)
+    {
         /* Flush the arithmetic decoder */
-        LT_ACDecodeBit_Flush(&AC, &ACError, 0, D->AData, D->ADataLen);
+        LT_ACDecodeBit_Flush(&F->AC, &ACError, 0, D->AData, D->ADataLen);
 
         if (ACError != 1)
             error = DSTErr_ArithmeticDecoder;
@@ -425,12 +476,121 @@ int DST_FramDSTDecode(uint8_t *DSTdata, uint8_t *MuxedDSDdata, int FrameSizeInBy
     if (error != DSTErr_NoError)
     {
         /* Clear the frame output - set to DSD silence */
-        memset(MuxedDSDdata, 0x55, (NrOfBitsPerCh * NrOfChannels) / 8);
+        memset(F->MuxedDSD, D->Planar ? 0xaa : 0x55, (D->FrameHdr.NrOfBitsPerCh * D->FrameHdr.NrOfChannels) / 8);
     }
 
     return error;
 }
 
+/***************************************************************************/
+/*                                                                         */
+/* name     : DST_FramDSTDecode                                            */
+/*                                                                         */
+/* function : DST decode a complete frame (all channels)     .             */
+/*                                                                         */
+/* pre      : D->CodOpt  : .NrOfBitsPerCh, .NrOfChannels,                  */
+/*            D->FrameHdr: .PredOrder[], .NrOfHalfBits[], .ICoefA[][],     */
+/*                         .NrOfFilters, .NrOfPtables, .FrameNr            */
+/*            D->P_one[][], D->AData[], D->ADataLen,                       */
+/*            D->Planar                                                    */
+/*                                                                         */
+/* post     : D->WM.Pwm                                                    */
+/*                                                                         */
+/***************************************************************************/
+int DST_FramDSTDecode(uint8_t *DSTdata, uint8_t *MuxedDSDdata, int FrameSizeInBytes, int FrameCnt, ebunch *D)
+{
+    int           error;
+    int           BitNr;
+    int           ChNr;
+    LT_FrameState F;
+    const int     NrOfBitsPerCh = D->FrameHdr.NrOfBitsPerCh;
+    const int     NrOfChannels = D->FrameHdr.NrOfChannels;
+
+    error = LT_DecodeBegin(DSTdata, MuxedDSDdata, FrameSizeInBytes, FrameCnt, D, &F);
+
+    if (F.Active)
+    {
+        for (BitNr = 0; BitNr < NrOfBitsPerCh; BitNr++)
+        {
+            for (ChNr = 0; ChNr < NrOfChannels; ChNr++)
+            {
+                LT_DecodeBit(D, &F, BitNr, ChNr);
+            }
+        }
+    }
+
+    return LT_DecodeEnd(error, D, &F);
+}
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : DST_FramDSTDecode2                                           */
+/*                                                                         */
+/* function : DST decode two independent frames in lockstep. The bit      */
+/*            loops of both frames are interleaved so that their serial    */
+/*            predict/decode/update chains can overlap in the CPU.         */
+/*                                                                         */
+/* pre      : as DST_FramDSTDecode(), for each of the two frames; D[0]     */
+/*            and D[1] must be distinct decoder instances                  */
+/*                                                                         */
+/* post     : MuxedDSDdata[0..1], error[0..1]                              */
+/*                                                                         */
+/***************************************************************************/
+void DST_FramDSTDecode2(uint8_t *DSTdata[2], uint8_t *MuxedDSDdata[2], int FrameSizeInBytes[2], int FrameCnt[2], ebunch *D[2], int error[2])
+{
+    int           BitNr;
+    int           ChNr;
+    int           i;
+    LT_FrameState F[2];
+
+    for (i = 0; i < 2; i++)
+    {
+        error[i] = LT_DecodeBegin(DSTdata[i], MuxedDSDdata[i], FrameSizeInBytes[i], FrameCnt[i], D[i], &F[i]);
+    }
+
+    if (F[0].Active && F[1].Active &&
+        D[0]->FrameHdr.NrOfBitsPerCh == D[1]->FrameHdr.NrOfBitsPerCh &&
+        D[0]->FrameHdr.NrOfChannels == D[1]->FrameHdr.NrOfChannels)
+    {
+        const int NrOfBitsPerCh = D[0]->FrameHdr.NrOfBitsPerCh;
+        const int NrOfChannels = D[0]->FrameHdr.NrOfChannels;
+
+        for (BitNr = 0; BitNr < NrOfBitsPerCh; BitNr++)
+        {
+            for (ChNr = 0; ChNr < NrOfChannels; ChNr++)
+            {
+                LT_DecodeBit(D[0], &F[0], BitNr, ChNr);
+                LT_DecodeBit(D[1], &F[1], BitNr, ChNr);
+            }
+        }
+    }
+    else
+    {
+        /* nothing to interleave (plain DSD frame, unpack error, ..) */
+        for (i = 0; i < 2; i++)
+        {
+            if (F[i].Active)
+            {
+                const int NrOfBitsPerCh = D[i]->FrameHdr.NrOfBitsPerCh;
+                const int NrOfChannels = D[i]->FrameHdr.NrOfChannels;
+
+                for (BitNr = 0; BitNr < NrOfBitsPerCh; BitNr++)
+                {
+                    for (ChNr = 0; ChNr < NrOfChannels; ChNr++)
+                    {
+                        LT_DecodeBit(D[i], &F[i], BitNr, ChNr);
+                    }
+                }
+            }
+        }
+    }
+
+    for (i = 0; i < 2; i++)
+    {
+        error[i] = LT_DecodeEnd(error[i], D[i], &F[i]);
+    }
+}
+
 static const char *DST_ErrorMessages[] =
 {
     "",
@@ -449,6 +609,7 @@ static const char *DST_ErrorMessages[] =
     "Illegal stuffing pattern",
     "Illegal arithmetic code",
     "Arithmetic decoding error",
+    "Frame larger than a DSD frame",
 };
 
 const char *DST_GetErrorMessage(int error)
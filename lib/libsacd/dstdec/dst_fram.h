@@ -73,6 +73,7 @@ Changes:
 /*============================================================================*/
 
 int DST_FramDSTDecode(uint8_t *DSTdata, uint8_t *MuxedDSDdata, int FrameSizeInBytes, int FrameCnt, ebunch *D);
+void DST_FramDSTDecode2(uint8_t *DSTdata[2], uint8_t *MuxedDSDdata[2], int FrameSizeInBytes[2], int FrameCnt[2], ebunch *D[2], int error[2]);
 const char *DST_GetErrorMessage(int error);
 
 #endif  /* __DST_FRAM_H_INCLUDED */
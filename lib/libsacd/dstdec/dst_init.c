@@ -230,6 +230,10 @@ static void FreeDecMemory (ebunch * D)
   MemoryFree(D->P_one[0]);
   MemoryFree(D->P_one);
   MemoryFree(D->AData);
+  MemoryFree(D->FrameHdr.Filter4Bit[0]);
+  MemoryFree(D->FrameHdr.Filter4Bit);
+  MemoryFree(D->FrameHdr.Ptable4Bit[0]);
+  MemoryFree(D->FrameHdr.Ptable4Bit);
 }
 
 /* Allocate memory for all dynamic variables of the decoder. */
@@ -253,6 +257,25 @@ static void AllocateDecMemory (ebunch * D)
   D->StrPtable.CPredCoef = AllocateArray(2, sizeof(**D->StrPtable.CPredCoef), NROFPRICEMETHODS, MAXCPREDORDER);
   D->P_one = AllocateArray(2, sizeof(**D->P_one), D->FrameHdr.MaxNrOfPtables, AC_HISMAX);
   D->AData = MemoryAllocate(D->FrameHdr.BitStreamLen,  sizeof(*D->AData));
+  D->FrameHdr.Filter4Bit = AllocateArray(2, sizeof(**D->FrameHdr.Filter4Bit), D->FrameHdr.NrOfChannels, D->FrameHdr.NrOfBitsPerCh);
+  D->FrameHdr.Ptable4Bit = AllocateArray(2, sizeof(**D->FrameHdr.Ptable4Bit), D->FrameHdr.NrOfChannels, D->FrameHdr.NrOfBitsPerCh);
+}
+
+/* Set the channel count, the sample rate and the stream sizes that depend */
+/* on them. */
+static void SetFrameFormat(ebunch * D, int NrOfChannels, int SampleRate)
+{
+  /*  64FS =>  4704 */
+  /* 128FS =>  9408 */
+  /* 256FS => 18816 */
+  D->FrameHdr.Fsample44      = SampleRate;
+  D->FrameHdr.MaxFrameLen    = (588 * SampleRate / 8); 
+  D->FrameHdr.NrOfBitsPerCh  = D->FrameHdr.MaxFrameLen   * RESOL;
+  D->FrameHdr.NrOfChannels   = NrOfChannels;
+  D->FrameHdr.ByteStreamLen  = D->FrameHdr.MaxFrameLen   * D->FrameHdr.NrOfChannels;
+  D->FrameHdr.BitStreamLen   = D->FrameHdr.ByteStreamLen * RESOL;
+  D->FrameHdr.MaxNrOfFilters = 2 * D->FrameHdr.NrOfChannels;
+  D->FrameHdr.MaxNrOfPtables = 2 * D->FrameHdr.NrOfChannels;
 }
 
 /***************************************************************************/
@@ -286,16 +309,9 @@ int DST_InitDecoder(ebunch * D, int NrOfChannels, int SampleRate)
 
   memset(D, 0, sizeof(ebunch));
 
-  D->FrameHdr.NrOfChannels   = NrOfChannels;
-  /*  64FS =>  4704 */
-  /* 128FS =>  9408 */
-  /* 256FS => 18816 */
-  D->FrameHdr.MaxFrameLen    = (588 * SampleRate / 8); 
-  D->FrameHdr.ByteStreamLen  = D->FrameHdr.MaxFrameLen   * D->FrameHdr.NrOfChannels;
-  D->FrameHdr.BitStreamLen   = D->FrameHdr.ByteStreamLen * RESOL;
-  D->FrameHdr.NrOfBitsPerCh  = D->FrameHdr.MaxFrameLen   * RESOL;
-  D->FrameHdr.MaxNrOfFilters = 2 * D->FrameHdr.NrOfChannels;
-  D->FrameHdr.MaxNrOfPtables = 2 * D->FrameHdr.NrOfChannels;
+  SetFrameFormat(D, NrOfChannels, SampleRate);
+  D->MaxNrOfChannels         = NrOfChannels;
+  D->MaxSampleRate           = SampleRate;
 
   D->FrameHdr.FrameNr = 0;
   D->StrFilter.TableType = FILTER;
@@ -336,6 +352,59 @@ int DST_InitDecoder(ebunch * D, int NrOfChannels, int SampleRate)
   return(retval);
 }
 
+/***************************************************************************/
+/*                                                                         */
+/* name     : DST_ReconfigureDecoder                                       */
+/*                                                                         */
+/* function : Switch an initialised DST decoder to another channel count  */
+/*            and sample rate. The arrays are only reallocated when they   */
+/*            are too small, so a decoder can be reused for streams of any */
+/*            channel count and sample rate.                               */
+/*                                                                         */
+/* pre      : D initialised by DST_InitDecoder, NrOfChannels, SampleRate   */
+/*                                                                         */
+/* post     : D->FrameHdr: .NrOfChannels, .Fsample44, .MaxFrameLen,        */
+/*                         .NrOfBitsPerCh, .ByteStreamLen, .BitStreamLen,  */
+/*                         .MaxNrOfFilters, .MaxNrOfPtables                */
+/*                                                                         */
+/***************************************************************************/
+
+int DST_ReconfigureDecoder(ebunch * D, int NrOfChannels, int SampleRate)
+{
+  int  retval = 0;
+
+  if (NrOfChannels == D->FrameHdr.NrOfChannels && SampleRate == D->FrameHdr.Fsample44)
+  {
+    return(retval);
+  }
+
+  if (NrOfChannels > D->MaxNrOfChannels || SampleRate > D->MaxSampleRate)
+  {
+    /* grow to cover both the old and the new format */
+    FreeDecMemory(D);
+    if (NrOfChannels > D->MaxNrOfChannels)
+    {
+      D->MaxNrOfChannels = NrOfChannels;
+    }
+    if (SampleRate > D->MaxSampleRate)
+    {
+      D->MaxSampleRate = SampleRate;
+    }
+    SetFrameFormat(D, D->MaxNrOfChannels, D->MaxSampleRate);
+    AllocateDecMemory(D);
+
+    retval = CCP_CalcInit(&D->StrFilter);
+    if (retval==0) 
+    {
+      retval = CCP_CalcInit(&D->StrPtable);
+    }
+  }
+
+  SetFrameFormat(D, NrOfChannels, SampleRate);
+
+  return(retval);
+}
+
 /***************************************************************************/
 /*                                                                         */
 /* name     : DST_CloseDecoder                                             */
@@ -354,6 +423,10 @@ int DST_CloseDecoder(ebunch * D)
   /* Free the memory that was used for the arrays */
   FreeDecMemory(D);
 
+  /* Free the copy of the last DST frame */
+  free(D->S.pDSTdata);
+  D->S.pDSTdata = NULL;
+
   return(retval);
 }
 
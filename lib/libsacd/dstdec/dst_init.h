@@ -68,6 +68,7 @@ Changes:
 /*============================================================================*/
 
 int DST_InitDecoder(ebunch * D, int NrOfChannels, int SampleRate);
+int DST_ReconfigureDecoder(ebunch * D, int NrOfChannels, int SampleRate);
 int DST_CloseDecoder(ebunch * D);
 
 #endif  /* __DST_INIT_H_INCLUDED */
@@ -0,0 +1,582 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+  Packing of DST frames, the counterpart of unpack_dst.c -- every field is
+  written as UnpackDSTframe() reads it back.
+*/
+
+/*============================================================================*/
+/*       INCLUDES                                                             */
+/*============================================================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "pack_dst.h"
+
+
+/*============================================================================*/
+/*       Forward declaration function prototypes                              */
+/*============================================================================*/
+
+int WriteDSDframe(StrData       *SD,
+                  long          MaxFrameLen, 
+                  int           NrOfChannels, 
+                  unsigned char *DSDFrame);
+
+int RiceEncode(StrData* SD, int x, int m);
+int Log2RoundUp(long x);
+
+int WriteTableSegmentData(StrData *SD, 
+                          int     NrOfChannels, 
+                          int     FrameLen,
+                          int     MinSegLen, 
+                          Segment *S,
+                          int     SameSegAllCh);
+int WriteSegmentData(StrData *SD, FrameHeader *FH);
+int WriteTableMappingData(StrData *SD,
+                          int     NrOfChannels, 
+                          Segment *S, 
+                          int     SameMapAllCh);
+int WriteMappingData(StrData *SD, FrameHeader *FH);
+int WriteFilterCoefSets(StrData *SD, FrameHeader *FH, CodedTable *CF);
+int WriteProbabilityTables(StrData *SD, FrameHeader *FH, CodedTable *CP, int **P_one);
+int WriteArithmeticCodedData(StrData *SD, int ADataLen, unsigned char *AData);
+
+
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : WriteDSDframe                                                */
+/*                                                                         */
+/* function : Write the DSD signal of this frame to the DST output file.   */
+/*                                                                         */
+/* pre      : MaxFrameLen, NrOfChannels, DSDFrame[] (interleaved, MSB      */
+/*            first)                                                       */
+/*                                                                         */
+/* post     : Returns -1 if the frame does not fit the output buffer       */
+/*                                                                         */
+/* uses     : fio_bit.h                                                    */
+/*                                                                         */
+/***************************************************************************/
+
+int WriteDSDframe(StrData       *SD,
+                  long          MaxFrameLen, 
+                  int           NrOfChannels, 
+                  unsigned char *DSDFrame)
+{
+  int             ByteNr;
+  int             max = (MaxFrameLen*NrOfChannels);
+
+  for (ByteNr = 0; ByteNr < max; ByteNr++) 
+  {
+    if (FIO_BitPutIntUnsigned(SD, 8, DSDFrame[ByteNr]))
+      return -1;
+  }
+
+  return 0;
+}
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : RiceEncode                                                   */
+/*                                                                         */
+/* function : Write a Rice code to the DST file                            */
+/*                                                                         */
+/* pre      : a buffer must be set by using SetWriteBuffer(), x, m         */
+/*                                                                         */
+/* post     : Returns -1 if the code does not fit the output buffer        */
+/*                                                                         */
+/* uses     : fio_bit.h                                                    */
+/*                                                                         */
+/***************************************************************************/
+
+int RiceEncode(StrData* SD, int x, int m)
+{
+  int Nr;
+  int RunLength;
+
+  Nr = (x < 0) ? -x : x;
+
+  /* Write run length code */
+  for (RunLength = Nr >> m; RunLength > 16; RunLength -= 16)
+  {
+    if (FIO_BitPutIntUnsigned(SD, 16, 0))
+      return -1;
+  }
+  if (FIO_BitPutIntUnsigned(SD, RunLength + 1, 1))
+    return -1;
+
+  /* Write least significant bits */
+  if (FIO_BitPutIntUnsigned(SD, m, Nr & ((1 << m) - 1)))
+    return -1;
+
+  /* Write optional sign bit */
+  if (Nr != 0)
+  {
+    if (FIO_BitPutIntUnsigned(SD, 1, (x < 0) ? 1 : 0))
+      return -1;
+  }
+
+  return 0;
+}
+
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : WriteTableSegmentData                                        */
+/*                                                                         */
+/* function : Write segmentation data for filters or Ptables.              */
+/*                                                                         */
+/* pre      : NrOfChannels, FrameLen, MinSegLen, SameSegAllCh,             */
+/*            S->Resolution, S->SegmentLen[][], S->NrOfSegments[]          */
+/*                                                                         */
+/* post     : Returns -1 if the data does not fit the output buffer        */
+/*                                                                         */
+/* uses     : types.h, fio_bit.h                                           */
+/*                                                                         */
+/***************************************************************************/
+
+int WriteTableSegmentData(StrData *SD,
+                          int     NrOfChannels, 
+                          int     FrameLen,
+                          int     MinSegLen, 
+                          Segment *S,
+                          int     SameSegAllCh)
+{
+  int ChNr;
+  int ResolWritten = 0;
+  int SegNr;
+  int MaxSegSize;
+
+  if (FIO_BitPutIntUnsigned(SD, 1, SameSegAllCh))
+    return -1;
+
+  /* with the same segmentation for all channels only channel 0 is written */
+  for (ChNr = 0; ChNr < ((SameSegAllCh == 1) ? 1 : NrOfChannels); ChNr++)
+  {
+    MaxSegSize = FrameLen - MinSegLen/8;
+
+    for (SegNr = 0; SegNr < S->NrOfSegments[ChNr] - 1; SegNr++)
+    {
+      /* EndOfChannel */
+      if (FIO_BitPutIntUnsigned(SD, 1, 0))
+        return -1;
+
+      if (ResolWritten == 0)
+      {
+        if (FIO_BitPutIntUnsigned(SD, Log2RoundUp(FrameLen - MinSegLen/8), S->Resolution))
+          return -1;
+
+        ResolWritten = 1;
+      }
+
+      if (FIO_BitPutIntUnsigned(SD, Log2RoundUp(MaxSegSize / S->Resolution), S->SegmentLen[ChNr][SegNr]))
+        return -1;
+
+      MaxSegSize -= S->Resolution * S->SegmentLen[ChNr][SegNr];
+    }
+
+    if (FIO_BitPutIntUnsigned(SD, 1, 1))
+      return -1;
+  }
+
+  return 0;
+}
+
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : WriteSegmentData                                             */
+/*                                                                         */
+/* function : Write segmentation data for filters and Ptables.             */
+/*                                                                         */
+/* pre      : FH-> : NrOfChannels, MaxFrameLen, PSameSegAsF,               */
+/*                   FSeg, FSameSegAllCh, PSeg, PSameSegAllCh              */
+/*                                                                         */
+/* post     : Returns -1 if the data does not fit the output buffer        */
+/*                                                                         */
+/* uses     : types.h, conststr.h, fio_bit.h                               */
+/*                                                                         */
+/***************************************************************************/
+
+int WriteSegmentData(StrData *SD, FrameHeader *FH)
+{
+  if (FIO_BitPutIntUnsigned(SD, 1, FH->PSameSegAsF))
+    return -1;
+
+  if (WriteTableSegmentData(SD,
+                            FH->NrOfChannels, 
+                            FH->MaxFrameLen, 
+                            MIN_FSEG_LEN, 
+                            &FH->FSeg, 
+                            FH->FSameSegAllCh))
+  {
+    return -1;
+  }
+
+  if (FH->PSameSegAsF == 0)
+  {
+    return WriteTableSegmentData(SD,
+                                 FH->NrOfChannels, 
+                                 FH->MaxFrameLen,
+                                 MIN_PSEG_LEN, 
+                                 &FH->PSeg, 
+                                 FH->PSameSegAllCh);
+  }
+
+  return 0;
+}
+
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : WriteTableMappingData                                        */
+/*                                                                         */
+/* function : Write mapping data for filters or Ptables.                   */
+/*                                                                         */
+/* pre      : NrOfChannels, S->NrOfSegments[], S->Table4Segment[][],       */
+/*            SameMapAllCh, a new table takes the next table number        */
+/*                                                                         */
+/* post     : Returns -1 if the data does not fit the output buffer        */
+/*                                                                         */
+/* uses     : types.h, fio_bit.h                                           */
+/*                                                                         */
+/***************************************************************************/
+
+int WriteTableMappingData(StrData *SD,
+                          int     NrOfChannels, 
+                          Segment *S, 
+                          int     SameMapAllCh)
+{
+  int ChNr;
+  int CountTables = 1;
+  int SegNr;
+
+  if (FIO_BitPutIntUnsigned(SD, 1, SameMapAllCh))
+    return -1;
+
+  for (ChNr = 0; ChNr < ((SameMapAllCh == 1) ? 1 : NrOfChannels); ChNr++)
+  {
+    for (SegNr = 0; SegNr < S->NrOfSegments[ChNr]; SegNr++)
+    {
+      if ((ChNr != 0) || (SegNr != 0))
+      {
+        if (FIO_BitPutIntUnsigned(SD, Log2RoundUp(CountTables), S->Table4Segment[ChNr][SegNr]))
+          return -1;
+
+        if (S->Table4Segment[ChNr][SegNr] == CountTables)
+          CountTables++;
+      }
+    }
+  }
+
+  return 0;
+}
+
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : WriteMappingData                                             */
+/*                                                                         */
+/* function : Write mapping data (which channel uses which filter/Ptable). */
+/*                                                                         */
+/* pre      : FH-> : NrOfChannels, PSameMapAsF, FSeg, FSameMapAllCh,       */
+/*                   PSeg, PSameMapAllCh, HalfProb[]                       */
+/*                                                                         */
+/* post     : Returns -1 if the data does not fit the output buffer        */
+/*                                                                         */
+/* uses     : types.h, conststr.h, fio_bit.h                               */
+/*                                                                         */
+/***************************************************************************/
+
+int WriteMappingData(StrData *SD, FrameHeader *FH)
+{
+  int j;
+
+  if (FIO_BitPutIntUnsigned(SD, 1, FH->PSameMapAsF))
+    return -1;
+
+  if (WriteTableMappingData(SD, FH->NrOfChannels, &FH->FSeg, FH->FSameMapAllCh))
+    return -1;
+
+  if (FH->PSameMapAsF == 0)
+  {
+    if (WriteTableMappingData(SD, FH->NrOfChannels, &FH->PSeg, FH->PSameMapAllCh))
+      return -1;
+  }
+
+  for (j = 0; j < FH->NrOfChannels; j++)
+  {
+    if (FIO_BitPutIntUnsigned(SD, 1, FH->HalfProb[j]))
+      return -1;
+  }
+
+  return 0;
+}
+
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : WriteFilterCoefSets                                          */
+/*                                                                         */
+/* function : Write all filter data to the DST file, which contains:       */
+/*            - for each filter:                                           */
+/*              ~ prediction order                                         */
+/*              ~ all coefficients                                         */
+/*                                                                         */
+/* pre      : FH->NrOfFilters, FH->PredOrder[], FH->ICoefA[][],            */
+/*            CF->CPredOrder[], CF->Coded[], CF->BestMethod[], CF->m[][],  */
+/*            CF->Data[][] (set by CCP_CalcCoding)                         */
+/*                                                                         */
+/* post     : Returns -1 if the data does not fit the output buffer        */
+/*                                                                         */
+/* uses     : types.h, fio_bit.h, conststr.h                               */
+/*                                                                         */
+/***************************************************************************/
+
+int WriteFilterCoefSets(StrData     *SD,
+                        FrameHeader *FH,
+                        CodedTable  *CF)
+{
+  int CoefNr;
+  int FilterNr;
+
+  for (FilterNr = 0; FilterNr < FH->NrOfFilters; FilterNr++)
+  {
+    if (FIO_BitPutIntUnsigned(SD, SIZE_CODEDPREDORDER, FH->PredOrder[FilterNr] - 1))
+      return -1;
+
+    if (FIO_BitPutIntUnsigned(SD, 1, CF->Coded[FilterNr]))
+      return -1;
+
+    if (CF->Coded[FilterNr] == 0)
+    {
+      for (CoefNr = 0; CoefNr < FH->PredOrder[FilterNr]; CoefNr++)
+      {
+        if (FIO_BitPutIntSigned(SD, SIZE_PREDCOEF, FH->ICoefA[FilterNr][CoefNr]))
+          return -1;
+      }
+    }
+    else
+    {
+      int bestmethod = CF->BestMethod[FilterNr];
+
+      if (FIO_BitPutIntUnsigned(SD, SIZE_RICEMETHOD, bestmethod))
+        return -1;
+
+      for (CoefNr = 0; CoefNr < CF->CPredOrder[bestmethod]; CoefNr++)
+      {
+        if (FIO_BitPutIntSigned(SD, SIZE_PREDCOEF, FH->ICoefA[FilterNr][CoefNr]))
+          return -1;
+      }
+
+      if (FIO_BitPutIntUnsigned(SD, SIZE_RICEM, CF->m[FilterNr][bestmethod]))
+        return -1;
+
+      for (CoefNr = CF->CPredOrder[bestmethod]; CoefNr < FH->PredOrder[FilterNr]; CoefNr++)
+      {
+        if (RiceEncode(SD, CF->Data[FilterNr][CoefNr], CF->m[FilterNr][bestmethod]))
+          return -1;
+      }
+    }
+  }
+
+  return 0;
+}
+
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : WriteProbabilityTables                                       */
+/*                                                                         */
+/* function : Write all Ptable data to the DST file, which contains:       */
+/*            - for each Ptable all entries                                */
+/*                                                                         */
+/* pre      : FH->NrOfPtables, FH->PtableLen[], P_one[][],                 */
+/*            CP->CPredOrder[], CP->Coded[], CP->BestMethod[], CP->m[][],  */
+/*            CP->Data[][] (set by CCP_CalcCoding)                         */
+/*                                                                         */
+/* post     : Returns -1 if the data does not fit the output buffer        */
+/*                                                                         */
+/* uses     : types.h, fio_bit.h, conststr.h                               */
+/*                                                                         */
+/***************************************************************************/
+
+int WriteProbabilityTables(StrData      *SD,
+                           FrameHeader  *FH,
+                           CodedTable   *CP,
+                           int          **P_one)
+{
+  int EntryNr;
+  int PtableNr;
+
+  for (PtableNr = 0; PtableNr < FH->NrOfPtables; PtableNr++)
+  {
+    if (FIO_BitPutIntUnsigned(SD, AC_HISBITS, FH->PtableLen[PtableNr] - 1))
+      return -1;
+
+    /* a Ptable of one entry is always 128 and has no entries in the stream */
+    if (FH->PtableLen[PtableNr] > 1)
+    {
+      if (FIO_BitPutIntUnsigned(SD, 1, CP->Coded[PtableNr]))
+        return -1;
+
+      if (CP->Coded[PtableNr] == 0)
+      {
+        for (EntryNr = 0; EntryNr < FH->PtableLen[PtableNr]; EntryNr++)
+        {
+          if (FIO_BitPutIntUnsigned(SD, AC_BITS - 1, P_one[PtableNr][EntryNr] - 1))
+            return -1;
+        }
+      }
+      else
+      {
+        int bestmethod = CP->BestMethod[PtableNr];
+
+        if (FIO_BitPutIntUnsigned(SD, SIZE_RICEMETHOD, bestmethod))
+          return -1;
+
+        for (EntryNr = 0; EntryNr < CP->CPredOrder[bestmethod]; EntryNr++)
+        {
+          if (FIO_BitPutIntUnsigned(SD, AC_BITS - 1, P_one[PtableNr][EntryNr] - 1))
+            return -1;
+        }
+
+        if (FIO_BitPutIntUnsigned(SD, SIZE_RICEM, CP->m[PtableNr][bestmethod]))
+          return -1;
+
+        for (EntryNr = CP->CPredOrder[bestmethod]; EntryNr < FH->PtableLen[PtableNr]; EntryNr++)
+        {
+          if (RiceEncode(SD, CP->Data[PtableNr][EntryNr], CP->m[PtableNr][bestmethod]))
+            return -1;
+        }
+      }
+    }
+  }
+
+  return 0;
+}
+
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : WriteArithmeticCodedData                                     */
+/*                                                                         */
+/* function : Write the arithmetic coded data to the DST file, its length  */
+/*            follows from the frame length.                               */
+/*                                                                         */
+/* pre      : ADataLen, AData[] (one bit per byte)                         */
+/*                                                                         */
+/* post     : Returns -1 if the data does not fit the output buffer        */
+/*                                                                         */
+/* uses     : fio_bit.h                                                    */
+/*                                                                         */
+/***************************************************************************/
+
+int WriteArithmeticCodedData(StrData       *SD,
+                             int           ADataLen, 
+                             unsigned char *AData)
+{
+  int j;
+  int k;
+  int val;
+
+  for (j = 0; j < ADataLen-7; j += 8)
+  {
+    for (k = 0, val = 0; k < 8; k++)
+      val = (val << 1) | AData[j + k];
+
+    if (FIO_BitPutIntUnsigned(SD, 8, val))
+      return -1;
+  }
+  /* Handle remaining bits */
+  for (; j < ADataLen; j++)
+  {
+    if (FIO_BitPutIntUnsigned(SD, 1, AData[j]))
+      return -1;
+  }
+
+  return 0;
+}
+
+
+/***************************************************************************/
+/*                                                                         */
+/* name     : PackDSTframe                                                 */
+/*                                                                         */
+/* function : Write a complete frame to the DST output buffer, the last    */
+/*            byte is padded with zeros (which the arithmetic decoder      */
+/*            reads as part of the code).                                  */
+/*                                                                         */
+/* pre      : D->FrameHdr, D->StrFilter, D->StrPtable, D->P_one[][],       */
+/*            D->AData[], D->ADataLen if DSTCoded, DSDdataframe otherwise, */
+/*            MaxFrameSize                                                 */
+/*                                                                         */
+/* post     : Returns the number of bytes of the frame, or -1 if it would  */
+/*            take more than MaxFrameSize bytes                            */
+/*                                                                         */
+/* uses     : types.h, fio_bit.h                                           */
+/*                                                                         */
+/***************************************************************************/
+
+int PackDSTframe(ebunch*  D, 
+                 uint8_t* DSDdataframe, 
+                 uint8_t* DSTdataframe,
+                 int      MaxFrameSize)
+{
+  StrData  SD;
+
+  SetWriteBuffer(&SD, DSTdataframe, MaxFrameSize);
+
+  /* write DST header byte */
+  if (FIO_BitPutIntUnsigned(&SD, 1, D->FrameHdr.DSTCoded))
+    return -1;
+
+  if (D->FrameHdr.DSTCoded == 0)
+  {
+    /* the unused DstX bit and the stuffing pattern */
+    if (FIO_BitPutIntUnsigned(&SD, 7, 0))
+      return -1;
+
+    if (WriteDSDframe(&SD, D->FrameHdr.MaxFrameLen, D->FrameHdr.NrOfChannels, DSDdataframe))
+      return -1;
+  }
+  else
+  {
+    if (WriteSegmentData(&SD, &D->FrameHdr))
+      return -1;
+
+    if (WriteMappingData(&SD, &D->FrameHdr))
+      return -1;
+
+    if (WriteFilterCoefSets(&SD, &D->FrameHdr, &D->StrFilter))
+      return -1;
+
+    if (WriteProbabilityTables(&SD, &D->FrameHdr, &D->StrPtable, D->P_one))
+      return -1;
+
+    if (WriteArithmeticCodedData(&SD, D->ADataLen, D->AData))
+      return -1;
+  }
+
+  return SD.ByteCounter;
+}
@@ -0,0 +1,44 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#if !defined(__PACKDST_H)
+#define __PACKDST_H
+
+
+/*============================================================================*/
+/*       INCLUDES                                                             */
+/*============================================================================*/
+
+#include "types.h"
+#include "dst_data.h"
+
+
+/*============================================================================*/
+/*       FUNCTION PROTOTYPES                                                  */
+/*============================================================================*/
+
+int PackDSTframe(ebunch*  D, 
+                 uint8_t* DSDdataframe, 
+                 uint8_t* DSTdataframe,
+                 int      MaxFrameSize);
+
+
+#endif /* __PACKDST_H */
@@ -106,9 +106,9 @@ typedef struct
                                                                 /* start of each frame are optionally coded   */
                                                                 /* with p=0.5                                 */
     Segment FSeg;                                               /* Contains segmentation data for filters     */
-    char    Filter4Bit[MAX_CHANNELS][MAX_DSDBITS_INFRAME];      /* Filter4Bit[ChNr][BitNr]                    */
+    char    **Filter4Bit;                                       /* Filter4Bit[ChNr][BitNr]                    */
     Segment PSeg;                                               /* Contains segmentation data for Ptables     */
-    char    Ptable4Bit[MAX_CHANNELS][MAX_DSDBITS_INFRAME];      /* Ptable4Bit[ChNr][BitNr]                    */
+    char    **Ptable4Bit;                                       /* Ptable4Bit[ChNr][BitNr]                    */
     int     PSameSegAsF;                                        /* 1 if segmentation is equal for F and P     */
     int     PSameMapAsF;                                        /* 1 if mapping is equal for F and P          */
     int     FSameSegAllCh;                                      /* 1 if all channels have same Filtersegm.    */
@@ -169,6 +169,21 @@ typedef struct
     StrData      S;                                              /* DST data stream */
 
     int          SSE2;
+    int          MaxNrOfChannels;                                /* Channel capacity of the allocated arrays    */
+    int          MaxSampleRate;                                  /* Rate capacity of the allocated arrays       */
+    int          Planar;                                         /* 1=output per channel, LSB first (DSF),      */
+                                                                 /* 0=output interleaved, MSB first             */
 } ebunch;
 
+typedef struct
+{
+    ebunch       D;                                              /* Frame header, tables and arithmetic code    */
+                                                                 /* as the decoder reads them back              */
+    int          Effort;                                         /* MIN_EFFORT (fastest) .. MAX_EFFORT          */
+    uint8_t      *DSDBits;                                       /* DSDBits[ChNr * NrOfBitsPerCh + BitNr]       */
+    double       AutoCorr[MAX_CHANNELS][(1 << SIZE_CODEDPREDORDER) + 1];
+                                                                 /* Autocorrelation of each channel             */
+    int16_t      ICoefI[2 * MAX_CHANNELS][16][256];              /* Filter output for each byte of the status   */
+} encbunch;
+
 #endif  /* __TYPES_H_INCLUDED */
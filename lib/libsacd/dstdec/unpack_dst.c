@@ -70,6 +70,7 @@ Changes:
 void ReadDSDframe(StrData       *SD,
                   long          MaxFrameLen, 
                   int           NrOfChannels, 
+                  int           Planar, 
                   unsigned char *DSDFrame);
 
 int RiceDecode(StrData* SD, int m);
@@ -104,9 +105,9 @@ void ReadArithmeticCodedData(StrData *SD, int ADataLen, unsigned char *AData);
 /* function : Read DSD signal of this frame from the DST input file.       */
 /*                                                                         */
 /* pre      : a file must be opened by using getbits_init(),               */
-/*            MaxFrameLen, NrOfChannels                                    */
+/*            MaxFrameLen, NrOfChannels, Planar                            */
 /*                                                                         */
-/* post     : BS11[][]                                                     */
+/* post     : BS11[][], interleaved or per channel with the bits reversed  */
 /*                                                                         */
 /* uses     : fio_bit.h                                                    */
 /*                                                                         */
@@ -115,13 +116,32 @@ void ReadArithmeticCodedData(StrData *SD, int ADataLen, unsigned char *AData);
 void ReadDSDframe(StrData      *S,
                   long          MaxFrameLen, 
                   int           NrOfChannels, 
+                  int           Planar, 
                   unsigned char *DSDFrame)
 {
   int             ByteNr;
+  int             ChNr;
   int             max = (MaxFrameLen*NrOfChannels);
+  unsigned char   c;
   
-  for (ByteNr = 0; ByteNr < max; ByteNr++) 
-    FIO_BitGetChrUnsigned(S, 8,&DSDFrame[ByteNr]);
+  if (!Planar)
+  {
+    for (ByteNr = 0; ByteNr < max; ByteNr++) 
+      FIO_BitGetChrUnsigned(S, 8,&DSDFrame[ByteNr]);
+    return;
+  }
+
+  for (ByteNr = 0; ByteNr < MaxFrameLen; ByteNr++) 
+  {
+    for (ChNr = 0; ChNr < NrOfChannels; ChNr++) 
+    {
+      FIO_BitGetChrUnsigned(S, 8, &c);
+      c = (unsigned char) (((c & 0xf0) >> 4) | ((c & 0x0f) << 4));
+      c = (unsigned char) (((c & 0xcc) >> 2) | ((c & 0x33) << 2));
+      c = (unsigned char) (((c & 0xaa) >> 1) | ((c & 0x55) << 1));
+      DSDFrame[ChNr * MaxFrameLen + ByteNr] = c;
+    }
+  }
 }
 
 /***************************************************************************/
@@ -913,7 +933,7 @@ int UnpackDSTframe(ebunch*  D,
       return DSTErr_InvalidStuffingPattern;
 
     /* Read DSD data and put in output stream */
-    ReadDSDframe(&D->S, D->FrameHdr.MaxFrameLen, D->FrameHdr.NrOfChannels, DSDdataframe);
+    ReadDSDframe(&D->S, D->FrameHdr.MaxFrameLen, D->FrameHdr.NrOfChannels, D->Planar, DSDdataframe);
   }
   else
   {
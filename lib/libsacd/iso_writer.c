@@ -32,7 +32,7 @@
 
 static size_t iso_write_frame(scarletbook_output_format_t *ft, const uint8_t *buf, size_t len)
 {
-    return fwrite(buf, 1, len * SACD_LSN_SIZE, ft->fd);
+    return output_sink_write(ft->sink, buf, len * SACD_LSN_SIZE);
 }
 
 scarletbook_format_handler_t const * iso_format_fn(void) 
@@ -43,6 +43,8 @@ scarletbook_format_handler_t const * iso_format_fn(void)
         "iso", 
         0, 
         iso_write_frame,
+        0,
+        0,
         0, 
         OUTPUT_FLAG_RAW,
         0
@@ -0,0 +1,367 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "output_sink.h"
+
+/* -- file -- */
+
+typedef struct
+{
+    output_sink_t       sink;
+    FILE               *fd;
+}
+file_sink_t;
+
+static int file_seek(FILE *fd, uint64_t offset)
+{
+#ifdef _WIN32
+    return _fseeki64(fd, (__int64) offset, SEEK_SET);
+#elif defined(__ANDROID__)
+    return fseek(fd, (long) offset, SEEK_SET);
+#elif defined(__lv2ppu__) || defined(__APPLE__)
+    return fseeko(fd, (off_t) offset, SEEK_SET);
+#else
+    return fseeko64(fd, (off64_t) offset, SEEK_SET);
+#endif
+}
+
+static size_t file_write(output_sink_t *sink, const uint8_t *buf, size_t len)
+{
+    return fwrite(buf, 1, len, ((file_sink_t *) sink)->fd);
+}
+
+static int file_patch(output_sink_t *sink, uint64_t offset, const uint8_t *buf, size_t len)
+{
+    FILE *fd = ((file_sink_t *) sink)->fd;
+    int result = 0;
+
+    if (file_seek(fd, offset) != 0)
+        return -1;
+    if (fwrite(buf, 1, len, fd) != len)
+        result = -1;
+
+    // carry on appending at the end
+    if (file_seek(fd, sink->position) != 0)
+        result = -1;
+    return result;
+}
+
+static void file_destroy(output_sink_t *sink)
+{
+    free(sink);
+}
+
+static const output_sink_ops_t file_sink_ops = 
+{
+    file_write, 
+    0, 
+    0, 
+    file_patch, 
+    file_destroy
+};
+
+output_sink_t *output_sink_file_create(FILE *fd)
+{
+    file_sink_t *file_sink = (file_sink_t *) calloc(1, sizeof(file_sink_t));
+
+    if (!file_sink)
+        return 0;
+    file_sink->sink.ops = &file_sink_ops;
+    file_sink->fd = fd;
+    return &file_sink->sink;
+}
+
+/* -- memory ring -- */
+
+typedef struct
+{
+    output_sink_t       sink;
+    uint8_t            *buffer;
+    size_t              size;
+    size_t              head;                       // index of the first unread byte
+    size_t              count;                      // unread bytes
+}
+ring_sink_t;
+
+// make room for len more bytes, the unread bytes move to the start
+static int ring_grow(ring_sink_t *ring, size_t len)
+{
+    uint8_t *buffer;
+    size_t size, first;
+
+    if (ring->count + len <= ring->size)
+        return 0;
+
+    size = ring->size ? ring->size : 4096;
+    while (size < ring->count + len)
+        size <<= 1;
+
+    buffer = (uint8_t *) malloc(size);
+    if (!buffer)
+        return -1;
+
+    first = ring->size - ring->head;
+    if (first > ring->count)
+        first = ring->count;
+    if (ring->count)
+    {
+        memcpy(buffer, ring->buffer + ring->head, first);
+        memcpy(buffer + first, ring->buffer, ring->count - first);
+    }
+    free(ring->buffer);
+    ring->buffer = buffer;
+    ring->size = size;
+    ring->head = 0;
+    return 0;
+}
+
+// copy len bytes in at index, wrapping around the end
+static void ring_put(ring_sink_t *ring, size_t index, const uint8_t *buf, size_t len)
+{
+    size_t first = ring->size - index;
+
+    if (first > len)
+        first = len;
+    memcpy(ring->buffer + index, buf, first);
+    memcpy(ring->buffer, buf + first, len - first);
+}
+
+static size_t ring_write(output_sink_t *sink, const uint8_t *buf, size_t len)
+{
+    ring_sink_t *ring = (ring_sink_t *) sink;
+
+    if (len == 0 || ring_grow(ring, len) != 0)
+        return 0;
+    ring_put(ring, (ring->head + ring->count) % ring->size, buf, len);
+    ring->count += len;
+    return len;
+}
+
+static uint8_t *ring_reserve(output_sink_t *sink, size_t len)
+{
+    ring_sink_t *ring = (ring_sink_t *) sink;
+    size_t tail;
+
+    if (len == 0 || ring_grow(ring, len) != 0)
+        return 0;
+
+    // only a span that does not wrap can be filled in place
+    tail = (ring->head + ring->count) % ring->size;
+    if (tail + len > ring->size)
+        return 0;
+    return ring->buffer + tail;
+}
+
+static size_t ring_commit(output_sink_t *sink, uint8_t *span, size_t len)
+{
+    ring_sink_t *ring = (ring_sink_t *) sink;
+
+    (void) span;
+    ring->count += len;
+    return len;
+}
+
+static int ring_patch(output_sink_t *sink, uint64_t offset, const uint8_t *buf, size_t len)
+{
+    ring_sink_t *ring = (ring_sink_t *) sink;
+    uint64_t first = sink->position - ring->count;   // stream offset of ring->head
+
+    // nothing to put (the ring may not even be allocated yet)
+    if (len == 0 || ring->size == 0)
+        return len == 0 && offset <= sink->position ? 0 : -1;
+
+    // bytes read back already are gone
+    if (offset < first || offset + len > sink->position)
+        return -1;
+    ring_put(ring, (ring->head + (size_t) (offset - first)) % ring->size, buf, len);
+    return 0;
+}
+
+static void ring_destroy(output_sink_t *sink)
+{
+    ring_sink_t *ring = (ring_sink_t *) sink;
+
+    free(ring->buffer);
+    free(ring);
+}
+
+static const output_sink_ops_t ring_sink_ops = 
+{
+    ring_write, 
+    ring_reserve, 
+    ring_commit, 
+    ring_patch, 
+    ring_destroy
+};
+
+output_sink_t *output_sink_ring_create(size_t size)
+{
+    ring_sink_t *ring = (ring_sink_t *) calloc(1, sizeof(ring_sink_t));
+
+    if (!ring)
+        return 0;
+    ring->sink.ops = &ring_sink_ops;
+    if (size && ring_grow(ring, size) != 0)
+    {
+        free(ring);
+        return 0;
+    }
+    return &ring->sink;
+}
+
+size_t output_sink_ring_available(output_sink_t *sink)
+{
+    return ((ring_sink_t *) sink)->count;
+}
+
+size_t output_sink_ring_read(output_sink_t *sink, uint8_t *buf, size_t len)
+{
+    ring_sink_t *ring = (ring_sink_t *) sink;
+    size_t first;
+
+    if (len > ring->count)
+        len = ring->count;
+    if (len == 0)
+        return 0;
+
+    first = ring->size - ring->head;
+    if (first > len)
+        first = len;
+    memcpy(buf, ring->buffer + ring->head, first);
+    memcpy(buf + first, ring->buffer, len - first);
+    ring->head = (ring->head + len) % ring->size;
+    ring->count -= len;
+    return len;
+}
+
+/* -- callback -- */
+
+typedef struct
+{
+    output_sink_t           sink;
+    output_sink_callback_t  callback;
+    void                   *userdata;
+}
+callback_sink_t;
+
+static size_t callback_write(output_sink_t *sink, const uint8_t *buf, size_t len)
+{
+    callback_sink_t *callback_sink = (callback_sink_t *) sink;
+
+    return callback_sink->callback(buf, len, callback_sink->userdata);
+}
+
+static void callback_destroy(output_sink_t *sink)
+{
+    free(sink);
+}
+
+static const output_sink_ops_t callback_sink_ops = 
+{
+    callback_write, 
+    0, 
+    0, 
+    0, 
+    callback_destroy
+};
+
+output_sink_t *output_sink_callback_create(output_sink_callback_t callback, void *userdata)
+{
+    callback_sink_t *callback_sink = (callback_sink_t *) calloc(1, sizeof(callback_sink_t));
+
+    if (!callback_sink)
+        return 0;
+    callback_sink->sink.ops = &callback_sink_ops;
+    callback_sink->callback = callback;
+    callback_sink->userdata = userdata;
+    return &callback_sink->sink;
+}
+
+/* -- common -- */
+
+size_t output_sink_write(output_sink_t *sink, const uint8_t *buf, size_t len)
+{
+    size_t written = sink->ops->write(sink, buf, len);
+
+    sink->position += written;
+    return written;
+}
+
+size_t output_sink_writev(output_sink_t *sink, const output_sink_iovec_t *iov, int iovcnt)
+{
+    size_t written = 0, n;
+    int i;
+
+    for (i = 0; i < iovcnt; i++)
+    {
+        n = output_sink_write(sink, (const uint8_t *) iov[i].base, iov[i].len);
+        written += n;
+        if (n != iov[i].len)
+            break;
+    }
+    return written;
+}
+
+uint8_t *output_sink_reserve(output_sink_t *sink, size_t len)
+{
+    uint8_t *span = sink->ops->reserve ? sink->ops->reserve(sink, len) : 0;
+
+    if (span)
+        return span;
+
+    // fill in a staging buffer instead, written out on commit
+    if (sink->staging_size < len)
+    {
+        free(sink->staging);
+        sink->staging = (uint8_t *) malloc(len);
+        sink->staging_size = sink->staging ? len : 0;
+    }
+    return sink->staging;
+}
+
+size_t output_sink_commit(output_sink_t *sink, uint8_t *span, size_t len)
+{
+    size_t written;
+
+    if (span == sink->staging)
+        return output_sink_write(sink, span, len);
+
+    written = sink->ops->commit(sink, span, len);
+    sink->position += written;
+    return written;
+}
+
+int output_sink_patch(output_sink_t *sink, uint64_t offset, const uint8_t *buf, size_t len)
+{
+    return sink->ops->patch ? sink->ops->patch(sink, offset, buf, len) : -1;
+}
+
+void output_sink_destroy(output_sink_t *sink)
+{
+    if (!sink)
+        return;
+    free(sink->staging);
+    sink->ops->destroy(sink);
+}
@@ -0,0 +1,91 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef OUTPUT_SINK_H_INCLUDED
+#define OUTPUT_SINK_H_INCLUDED
+
+#include <stdio.h>
+#include <stddef.h>
+#include <inttypes.h>
+
+// An output sink is where the output format handlers put their bytes. It
+// can be a file, a memory ring that is read back (the VFS), or a callback.
+//
+// write/writev append at the end of the stream. reserve hands out a span of
+// len bytes at the end to fill in place, which commit appends once filled.
+// patch overwrites bytes written before (e.g. a header whose sizes are only
+// known at the end), it fails with -1 if they can no longer be reached.
+
+typedef struct output_sink_t output_sink_t;
+
+typedef struct output_sink_iovec_t
+{
+    const void         *base;
+    size_t              len;
+}
+output_sink_iovec_t;
+
+typedef struct output_sink_ops_t
+{
+    size_t   (*write)(output_sink_t *sink, const uint8_t *buf, size_t len);
+    uint8_t *(*reserve)(output_sink_t *sink, size_t len);          // optional
+    size_t   (*commit)(output_sink_t *sink, uint8_t *span, size_t len);   // with reserve
+    int      (*patch)(output_sink_t *sink, uint64_t offset, const uint8_t *buf, size_t len);   // optional
+    void     (*destroy)(output_sink_t *sink);
+}
+output_sink_ops_t;
+
+struct output_sink_t
+{
+    const output_sink_ops_t *ops;
+    uint64_t            position;                   // bytes appended so far
+
+    // span for sinks that cannot hand out their own memory
+    uint8_t            *staging;
+    size_t              staging_size;
+};
+
+typedef size_t (*output_sink_callback_t)(const uint8_t *buf, size_t len, void *userdata);
+
+// writes to fd, which stays open after the sink is destroyed
+output_sink_t *output_sink_file_create(FILE *fd);
+
+// keeps the bytes in memory until read back, grows as needed
+output_sink_t *output_sink_ring_create(size_t size);
+size_t output_sink_ring_available(output_sink_t *sink);
+size_t output_sink_ring_read(output_sink_t *sink, uint8_t *buf, size_t len);
+
+// hands the bytes to callback, patches are not possible
+output_sink_t *output_sink_callback_create(output_sink_callback_t callback, void *userdata);
+
+size_t output_sink_write(output_sink_t *sink, const uint8_t *buf, size_t len);
+size_t output_sink_writev(output_sink_t *sink, const output_sink_iovec_t *iov, int iovcnt);
+uint8_t *output_sink_reserve(output_sink_t *sink, size_t len);
+size_t output_sink_commit(output_sink_t *sink, uint8_t *span, size_t len);
+int output_sink_patch(output_sink_t *sink, uint64_t offset, const uint8_t *buf, size_t len);
+void output_sink_destroy(output_sink_t *sink);
+
+static inline uint64_t output_sink_tell(output_sink_t *sink)
+{
+    return sink->position;
+}
+
+#endif /* OUTPUT_SINK_H_INCLUDED */
@@ -24,6 +24,7 @@
 
 #include <inttypes.h>
 #include <list.h>
+#include <arena.h>
 
 #undef ATTRIBUTE_PACKED
 #undef PRAGMA_PACK_BEGIN
@@ -72,6 +73,9 @@
 #define MAX_CATEGORY_COUNT             3
 
 #define MAX_PROCESSING_BLOCK_SIZE      512U
+#define MAX_FRAME_THREADS              16
+#define MIN_FRAME_CHUNK_SIZE           64             // sectors per thread worth walking in parallel
+#define FRAME_INDEX_INTERVAL           256            // frames between absolute entries of a frame index
 
 typedef enum
 {
@@ -164,6 +168,8 @@ typedef enum
 } 
 track_type_t;
 
+#define TRACK_TEXT_TYPE_COUNT    14
+
 #if PRAGMA_PACK
 #pragma pack(1)
 #endif
@@ -372,22 +378,12 @@ typedef struct
 }
 ATTRIBUTE_PACKED area_toc_t;
 
+// the text of a track stays on disc until it is first asked for through
+// scarletbook_track_text(), which converts it to UTF-8 and keeps it
 typedef struct
 {
-    char *track_type_title;
-    char *track_type_performer;
-    char *track_type_songwriter;
-    char *track_type_composer;
-    char *track_type_arranger;
-    char *track_type_message;
-    char *track_type_extra_message;
-    char *track_type_title_phonetic;
-    char *track_type_performer_phonetic;
-    char *track_type_songwriter_phonetic;
-    char *track_type_composer_phonetic;
-    char *track_type_arranger_phonetic;
-    char *track_type_message_phonetic;
-    char *track_type_extra_message_phonetic;
+    uint32_t    offset[TRACK_TEXT_TYPE_COUNT];      // into area_data, 0 when missing
+    char       *text[TRACK_TEXT_TYPE_COUNT];        // converted, 0 until asked for
 } 
 area_track_text_t;
 
@@ -549,6 +545,7 @@ typedef struct
     area_text_t              * area_text;
     area_track_text_t          area_track_text[255];                      // max of 255 supported tracks
     area_isrc_genre_t        * area_isrc_genre;
+    area_access_list_t       * area_access_list;                        // 0 when missing or not usable
 
     char                     * description;
     char                     * copyright;
@@ -559,7 +556,7 @@ scarletbook_area_t;
 
 typedef struct scarletbook_audio_frame_t
 {
-    uint8_t            *data;
+    uint8_t            *data;                   // head of a frame carried over from the previous block
     int                 size;
     int                 started;
 
@@ -567,12 +564,117 @@ typedef struct scarletbook_audio_frame_t
     int                 channel_count;
 
     int                 dst_encoded;
+
+    int                 first_segment;          // where the frame starts in the batch segments
+    uint8_t            *spare;                  // takes the next carry while a batch still points at data
+    uint8_t            *gather;                 // frames of more than one segment are flattened here
+    uint8_t            *buffer;                 // backs data, spare and gather
 } 
 scarletbook_audio_frame_t;
 
+// a contiguous piece of an audio frame
+typedef struct
+{
+    uint8_t            *data;
+    size_t              size;
+}
+scarletbook_frame_segment_t;
+
+// an audio frame found in a processed block, its bytes are the concatenation of
+// its segments, which point into the read buffer or at the carried over head
+typedef struct
+{
+    scarletbook_frame_segment_t *segments;
+    int                 first_segment;
+    int                 segment_count;
+    size_t              size;
+
+    uint8_t            *data;                   // the frame when it is a single segment, else 0
+
+    int                 channel_count;
+    int                 dst_encoded;
+}
+scarletbook_frame_desc_t;
+
+typedef struct
+{
+    scarletbook_frame_desc_t    *frames;
+    int                          frame_count;
+    int                          frames_allocated;
+
+    scarletbook_frame_segment_t *segments;
+    int                          segment_count;
+    int                          segments_allocated;
+
+    int                          failed;                // out of memory, the batch holds no frames
+}
+scarletbook_frame_batch_t;
+
+// where a frame starts, relative to the frame before it
+typedef struct
+{
+    uint16_t            lsn_delta;
+    uint16_t            offset;                 // of its first packet within the sector
+    uint16_t            size;
+}
+ATTRIBUTE_PACKED scarletbook_frame_index_entry_t;
+
+typedef struct
+{
+    uint32_t            lsn;
+    uint64_t            position;               // sum of the sizes of the frames before
+}
+scarletbook_frame_index_base_t;
+
+// the frames of an area as found from the audio sector headers
+typedef struct
+{
+    int                 area;
+    uint32_t            start_lsn;
+    uint32_t            end_lsn;
+
+    uint32_t            frame_count;
+    uint64_t            total_size;
+
+    scarletbook_frame_index_entry_t *entries;
+    scarletbook_frame_index_base_t  *bases;     // one per FRAME_INDEX_INTERVAL frames
+}
+scarletbook_frame_index_t;
+
+// what scarletbook_probe() finds of an area, the text is as on disc, in charset
+typedef struct
+{
+    int                 channel_count;
+    int                 track_count;
+    int                 frame_format;
+    uint32_t            total_frames;
+    const char         *charset;
+    const char         *track_title[255];       // into the probe buffer, 0 when missing
+}
+scarletbook_probe_area_t;
+
+typedef struct
+{
+    const char         *charset;
+    const char         *album_title;            // into the probe buffer, 0 when missing
+    const char         *album_artist;
+
+    int                 twoch_area_idx;
+    int                 mulch_area_idx;
+    int                 area_count;
+    scarletbook_probe_area_t area[2];
+}
+scarletbook_probe_t;
+
+// the master TOC, and per area its first sector and its track text
+#define SCARLETBOOK_PROBE_BUFFER_SIZE    (16 * SACD_LSN_SIZE)
+
+typedef struct scarletbook_frame_pool_t scarletbook_frame_pool_t;
+
 typedef struct
 {
     void                     * sacd;                                      // sacd_reader_t
+    arena_t                  * arena;                                     // holds the handle and what it parsed
 
     uint8_t                  * master_data;
     master_toc_t             * master_toc;
@@ -585,8 +687,11 @@ typedef struct
     scarletbook_area_t         area[2];
 
     scarletbook_audio_frame_t  frame;
+    scarletbook_frame_batch_t  frame_batch;
     audio_sector_t             audio_sector;
-    int                        packet_info_idx;
+
+    int                        frame_threads;               // sector runs walked in parallel per block
+    scarletbook_frame_pool_t * frame_pool;                  // the threads walking them, launched on first use
 } 
 scarletbook_handle_t;
 
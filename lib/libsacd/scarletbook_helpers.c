@@ -25,6 +25,7 @@
 #include <utils.h>
 
 #include "scarletbook_helpers.h"
+#include "scarletbook_read.h"
 
 char *get_album_dir(scarletbook_handle_t *handle)
 {
@@ -111,14 +112,14 @@ char *get_music_filename(scarletbook_handle_t *handle, int area, int track, cons
         album_title = master_text->disc_title_phonetic;
 
     memset(track_artist, 0, sizeof(track_artist));
-    c = handle->area[area].area_track_text[track].track_type_performer;
+    c = scarletbook_track_text(handle, area, track, TRACK_TYPE_PERFORMER);
     if (c)
     {
         strncpy(track_artist, c, 59);
     }
 
     memset(track_title, 0, sizeof(track_title));
-    c = handle->area[area].area_track_text[track].track_type_title;
+    c = scarletbook_track_text(handle, area, track, TRACK_TYPE_TITLE);
     if (c)
     {
         strncpy(track_title, c, 59);
@@ -30,6 +30,7 @@
 #include <charset.h>
 
 #include "scarletbook.h"
+#include "scarletbook_read.h"
 
 #include <id3.h>
 #include <genre.dat>
@@ -78,9 +79,10 @@ int scarletbook_id3_tag_render(scarletbook_handle_t *handle, uint8_t *buffer, in
 
     memset(tmp, 0, sizeof(tmp));
 
-    if (handle->area[area].area_track_text[track].track_type_title)
+    if (scarletbook_track_text(handle, area, track, TRACK_TYPE_TITLE))
     {
-        char *track_type_title = charset_convert(handle->area[area].area_track_text[track].track_type_title, strlen(handle->area[area].area_track_text[track].track_type_title), "UTF-8", "ISO-8859-1");
+        char *track_type_title = scarletbook_track_text(handle, area, track, TRACK_TYPE_TITLE);
+        track_type_title = charset_convert(track_type_title, strlen(track_type_title), "UTF-8", "ISO-8859-1");
         frame = id3_add_frame(tag, ID3_TIT2);
         id3_set_text(frame, track_type_title);
         free(track_type_title);
@@ -107,9 +109,9 @@ int scarletbook_id3_tag_render(scarletbook_handle_t *handle, uint8_t *buffer, in
             free(album_title);
         }
     }
-    if (handle->area[area].area_track_text[track].track_type_performer)
+    if (scarletbook_track_text(handle, area, track, TRACK_TYPE_PERFORMER))
     {
-        char *performer = handle->area[area].area_track_text[track].track_type_performer; 
+        char *performer = scarletbook_track_text(handle, area, track, TRACK_TYPE_PERFORMER);
         frame = id3_add_frame(tag, ID3_TPE1);
         performer = charset_convert(performer, strlen(performer), "UTF-8", "ISO-8859-1");
         id3_set_text(frame, performer);
@@ -194,6 +194,8 @@ static int create_output_file(scarletbook_output_format_t *ft)
     ft->write_cache = malloc(WRITE_CACHE_SIZE);
     setvbuf(ft->fd, ft->write_cache, _IOFBF , WRITE_CACHE_SIZE);
 
+    ft->sink = output_sink_file_create(ft->fd);
+
     ft->priv = calloc(1, ft->handler.priv_size);
 
     result = ft->handler.startwrite ? (*ft->handler.startwrite)(ft) : 0;
@@ -212,6 +214,7 @@ static inline int close_output_file(scarletbook_output_format_t * ft)
 
     result = ft->handler.stopwrite ? (*ft->handler.stopwrite)(ft) : 0;
 
+    output_sink_destroy(ft->sink);
     if (ft->fd)
     {
         fclose(ft->fd);
@@ -253,6 +256,14 @@ static inline size_t write_block(scarletbook_output_format_t * ft, const uint8_t
 static void frame_decoded_callback(uint8_t* frame_data, size_t frame_size, void *userdata)
 {
     scarletbook_output_format_t *ft = (scarletbook_output_format_t *) userdata;
+#ifndef __lv2ppu__
+    if (ft->handler.write_planar)
+    {
+        // the decoder was set up to emit planar frames for this handler
+        ft->write_length += (*ft->handler.write_planar)(ft, frame_data, frame_size);
+        return;
+    }
+#endif
     write_block(ft, frame_data, frame_size);
 }
 
@@ -268,210 +279,339 @@ static void frame_error_callback(int frame_count, int frame_error_code, const ch
     free(wide_errormessage);
 }
 
-static void frame_read_callback(scarletbook_handle_t *handle, uint8_t* frame_data, size_t frame_size, void *userdata)
+static void write_frame_batch(scarletbook_output_format_t *ft, scarletbook_handle_t *frames, scarletbook_frame_batch_t *batch)
 {
-    scarletbook_output_format_t *ft = (scarletbook_output_format_t *) userdata;
+    int i;
 
-    if (ft->dsd_encoded_export && ft->dst_encoded_import)
+    for (i = 0; i < batch->frame_count; i++)
     {
-        dst_decoder_decode(ft->dst_decoder, frame_data, frame_size);
+        scarletbook_frame_desc_t *frame = &batch->frames[i];
+
+        if (ft->dsd_encoded_export && ft->dst_encoded_import)
+        {
+            dst_decoder_decode(ft->dst_decoder, scarletbook_frame_data(frames, frame), frame->size);
+        }
+        else if (ft->handler.write_segments)
+        {
+            // straight from the read buffer
+            ft->write_length += (*ft->handler.write_segments)(ft, frame->segments, frame->segment_count);
+        }
+        else
+        {
+            write_block(ft, scarletbook_frame_data(frames, frame), frame->size);
+        }
+    }
+}
+
+// a thread ripping tracks off the queue, each with its own frame state and read buffer
+typedef struct rip_worker_t
+{
+    scarletbook_output_t   *output;
+    scarletbook_handle_t   *frames;
+    uint8_t                *read_buffer;
+#ifndef __lv2ppu__
+    thread                 *pool_thread;
+#endif
+}
+rip_worker_t;
+
+static inline void output_lock(scarletbook_output_t *output)
+{
+#ifndef __lv2ppu__
+    possess(output->rip_lock);
+#endif
+}
+
+static inline void output_unlock(scarletbook_output_t *output)
+{
+#ifndef __lv2ppu__
+    release(output->rip_lock);
+#endif
+}
+
+// with one worker the current file is the track being ripped, tracks ripped
+// side by side are reported as a total only
+static void update_file_stats(scarletbook_output_t *output, scarletbook_output_format_t *ft)
+{
+    if (output->rip_workers > 1)
+    {
+        output->stats_current_file_total_sectors = output->stats_total_sectors;
+        output->stats_current_file_sectors_processed = output->stats_total_sectors_processed;
     }
     else
     {
-        write_block(ft, frame_data, frame_size);
+        output->stats_current_file_total_sectors = ft->length_lsn;
+        output->stats_current_file_sectors_processed = ft->current_lsn - ft->start_lsn;
     }
 }
 
+// rips a track and closes it, returns 0 if the user cancelled, the file is removed then
+static int rip_track(rip_worker_t *worker, scarletbook_output_format_t *ft)
+{
+    scarletbook_output_t *output = worker->output;
+    scarletbook_handle_t *handle = output->sb_handle;
+    int cancelled, created;
+
+    if (ft->dsd_encoded_export && ft->dst_encoded_import)
+    {
 #ifdef __lv2ppu__
-static void processing_thread(void *arg)
+        ft->dst_decoder = dst_decoder_create(ft->channel_count, frame_decoded_callback, frame_error_callback, ft);
 #else
-static void *processing_thread(void *arg)
+        dst_decoder_limits_t limits;
+
+        // let the decoder write in the layout of the output format if it has one
+        memset(&limits, 0, sizeof(limits));
+        limits.planar = ft->handler.write_planar != 0;
+        ft->dst_decoder = dst_decoder_create_limited(ft->channel_count, 64, &limits, frame_decoded_callback, frame_error_callback, ft);
 #endif
-{
-    scarletbook_output_t *output = (scarletbook_output_t *) arg;
-    scarletbook_handle_t *handle = output->sb_handle;
-    struct list_head * node_ptr;
-    scarletbook_output_format_t * ft;
-    int non_encrypted_disc = 0;
-    int checked_for_non_encrypted_disc = 0;
+    }
 
-    sysAtomicSet(&output->processing, 1);
-    while (!list_empty(&output->ripping_queue))
+    scarletbook_frame_init(worker->frames);
+    ft->current_lsn = ft->start_lsn;
+
+    // the headers take the track text, which is converted into the shared handle
+    output_lock(output);
+    update_file_stats(output, ft);
+    output->stats_current_track++;
+
+    if (output->stats_track_callback)
     {
-        node_ptr = output->ripping_queue.next;
+        output->stats_track_callback(ft->filename, output->stats_current_track, output->stats_total_tracks);
+    }
 
-        ft = list_entry(node_ptr, scarletbook_output_format_t, siblings);
-        list_del(node_ptr);
+    created = create_output_file(ft) == 0;
+    output_unlock(output);
 
-        if (ft->dsd_encoded_export && ft->dst_encoded_import)
+    if (created)
+    {
+        uint32_t block_size, end_lsn;
+        uint32_t encrypted_start_1 = 0;
+        uint32_t encrypted_start_2 = 0;
+        uint32_t encrypted_end_1 = 0;
+        uint32_t encrypted_end_2 = 0;
+        int encrypted;
+
+        // set the encryption range
+        if (handle->area[0].area_toc != 0)
         {
-            ft->dst_decoder = dst_decoder_create(ft->channel_count, frame_decoded_callback, frame_error_callback, ft);
+            encrypted_start_1 = handle->area[0].area_toc->track_start;
+            encrypted_end_1 = handle->area[0].area_toc->track_end;
         }
-
-        output->stats_current_file_total_sectors = ft->length_lsn;
-        output->stats_current_file_sectors_processed = 0;
-        output->stats_current_track++;
-
-        if (output->stats_track_callback)
+        if (handle->area[1].area_toc != 0)
         {
-            output->stats_track_callback(ft->filename, output->stats_current_track, output->stats_total_tracks);
+            encrypted_start_2 = handle->area[1].area_toc->track_start;
+            encrypted_end_2 = handle->area[1].area_toc->track_end;
         }
 
-        scarletbook_frame_init(handle);
+        // what blocks do we need to process?
+        end_lsn = ft->start_lsn + ft->length_lsn;
 
-        if (create_output_file(ft) == 0)
+        while (sysAtomicRead(&output->stop_processing) == 0)
         {
-            uint32_t block_size, end_lsn;
-            uint32_t encrypted_start_1 = 0;
-            uint32_t encrypted_start_2 = 0;
-            uint32_t encrypted_end_1 = 0;
-            uint32_t encrypted_end_2 = 0;
-            int encrypted;
-
-            // set the encryption range
-            if (handle->area[0].area_toc != 0)
+            if (ft->current_lsn < end_lsn)
             {
-                encrypted_start_1 = handle->area[0].area_toc->track_start;
-                encrypted_end_1 = handle->area[0].area_toc->track_end;
-            }
-            if (handle->area[1].area_toc != 0)
-            {
-                encrypted_start_2 = handle->area[1].area_toc->track_start;
-                encrypted_end_2 = handle->area[1].area_toc->track_end;
-            }
-
-            // what blocks do we need to process?
-            ft->current_lsn = ft->start_lsn;
-            end_lsn = ft->start_lsn + ft->length_lsn;
+                // check what block ranges are encrypted..
+                if (ft->current_lsn < encrypted_start_1)
+                {
+                    block_size = min(encrypted_start_1 - ft->current_lsn, MAX_PROCESSING_BLOCK_SIZE);
+                    encrypted = 0;
+                }
+                else if (ft->current_lsn >= encrypted_start_1 && ft->current_lsn <= encrypted_end_1)
+                {
+                    block_size = min(encrypted_end_1 + 1 - ft->current_lsn, MAX_PROCESSING_BLOCK_SIZE);
+                    encrypted = 1;
+                }
+                else if (ft->current_lsn > encrypted_end_1 && ft->current_lsn < encrypted_start_2)
+                {
+                    block_size = min(encrypted_start_2 - ft->current_lsn, MAX_PROCESSING_BLOCK_SIZE);
+                    encrypted = 0;
+                }
+                else if (ft->current_lsn >= encrypted_start_2 && ft->current_lsn <= encrypted_end_2)
+                {
+                    block_size = min(encrypted_end_2 + 1 - ft->current_lsn, MAX_PROCESSING_BLOCK_SIZE);
+                    encrypted = 1;
+                }
+                else
+                {
+                    block_size = MAX_PROCESSING_BLOCK_SIZE;
+                    encrypted = 0;
+                }
+                block_size = min(end_lsn - ft->current_lsn, block_size);
 
-            sysAtomicSet(&output->stop_processing, 0);
+                // read some blocks, the workers share the reader
+                output_lock(output);
+                block_size = (uint32_t) sacd_read_block_raw(ft->sb_handle->sacd, ft->current_lsn, block_size, worker->read_buffer);
 
-            while (sysAtomicRead(&output->stop_processing) == 0)
-            {
-                if (ft->current_lsn < end_lsn)
+                // the ATAPI call which returns the flag if the disc is encrypted or not is unknown at this point. 
+                // user reports tell me that the only non-encrypted discs out there are DSD 3 14/16 discs. 
+                // this is a quick hack/fix for these discs.
+                if (encrypted && output->checked_for_non_encrypted_disc == 0)
                 {
-                    // check what block ranges are encrypted..
-                    if (ft->current_lsn < encrypted_start_1)
-                    {
-                        block_size = min(encrypted_start_1 - ft->current_lsn, MAX_PROCESSING_BLOCK_SIZE);
-                        encrypted = 0;
-                    }
-                    else if (ft->current_lsn >= encrypted_start_1 && ft->current_lsn <= encrypted_end_1)
-                    {
-                        block_size = min(encrypted_end_1 + 1 - ft->current_lsn, MAX_PROCESSING_BLOCK_SIZE);
-                        encrypted = 1;
-                    }
-                    else if (ft->current_lsn > encrypted_end_1 && ft->current_lsn < encrypted_start_2)
+                    switch (handle->area[ft->area].area_toc->frame_format)
                     {
-                        block_size = min(encrypted_start_2 - ft->current_lsn, MAX_PROCESSING_BLOCK_SIZE);
-                        encrypted = 0;
+                    case FRAME_FORMAT_DSD_3_IN_14:
+                    case FRAME_FORMAT_DSD_3_IN_16:
+                        output->non_encrypted_disc = *(uint64_t *)(worker->read_buffer + 16) == 0;
+                        break;
                     }
-                    else if (ft->current_lsn >= encrypted_start_2 && ft->current_lsn <= encrypted_end_2)
-                    {
-                        block_size = min(encrypted_end_2 + 1 - ft->current_lsn, MAX_PROCESSING_BLOCK_SIZE);
-                        encrypted = 1;
-                    }
-                    else
-                    {
-                        block_size = MAX_PROCESSING_BLOCK_SIZE;
-                        encrypted = 0;
-                    }
-                    block_size = min(end_lsn - ft->current_lsn, block_size);
-
-                    // read some blocks
-                    block_size = (uint32_t) sacd_read_block_raw(ft->sb_handle->sacd, ft->current_lsn, block_size, output->read_buffer);
 
-                    ft->current_lsn += block_size;
-                    output->stats_total_sectors_processed += block_size;
-                    output->stats_current_file_sectors_processed += block_size;
-
-                    // the ATAPI call which returns the flag if the disc is encrypted or not is unknown at this point. 
-                    // user reports tell me that the only non-encrypted discs out there are DSD 3 14/16 discs. 
-                    // this is a quick hack/fix for these discs.
-                    if (encrypted && checked_for_non_encrypted_disc == 0)
-                    {
-                        switch (handle->area[ft->area].area_toc->frame_format)
-                        {
-                        case FRAME_FORMAT_DSD_3_IN_14:
-                        case FRAME_FORMAT_DSD_3_IN_16:
-                            non_encrypted_disc = *(uint64_t *)(output->read_buffer + 16) == 0;
-                            break;
-                        }
-
-                        checked_for_non_encrypted_disc = 1;
-                    }
+                    output->checked_for_non_encrypted_disc = 1;
+                }
 
-                    // encrypted blocks need to be decrypted first
-                    if (encrypted && non_encrypted_disc == 0)
-                    {
-                        sacd_decrypt(ft->sb_handle->sacd, output->read_buffer, block_size);
-                    }
+                // encrypted blocks need to be decrypted first
+                if (encrypted && output->non_encrypted_disc == 0)
+                {
+                    sacd_decrypt(ft->sb_handle->sacd, worker->read_buffer, block_size);
+                }
+                output_unlock(output);
 
-                    // process DSD & DST frames
-                    if (ft->handler.flags & OUTPUT_FLAG_DSD || ft->handler.flags & OUTPUT_FLAG_DST)
-                    {
-                        scarletbook_process_frames(ft->sb_handle, output->read_buffer, block_size, ft->current_lsn == end_lsn, frame_read_callback, ft);
-                    }
-                    // ISO output is written without frame processing                        
-                    else if (ft->handler.flags & OUTPUT_FLAG_RAW)
-                    {
-                        write_block(ft, output->read_buffer, block_size);
-                    }
+                ft->current_lsn += block_size;
 
-                    // update statistics
-                    if (output->stats_progress_callback)
-                    {
-                        output->stats_progress_callback(output->stats_total_sectors, output->stats_total_sectors_processed, 
-                            output->stats_current_file_total_sectors, output->stats_current_file_sectors_processed);
-                    }
+                // process DSD & DST frames
+                if (ft->handler.flags & OUTPUT_FLAG_DSD || ft->handler.flags & OUTPUT_FLAG_DST)
+                {
+                    write_frame_batch(ft, worker->frames, scarletbook_process_frame_batch(worker->frames, worker->read_buffer, block_size, ft->current_lsn == end_lsn));
                 }
-                else
+                // ISO output is written without frame processing                        
+                else if (ft->handler.flags & OUTPUT_FLAG_RAW)
                 {
-                    break;
+                    write_block(ft, worker->read_buffer, block_size);
                 }
+
+                // update statistics
+                output_lock(output);
+                output->stats_total_sectors_processed += block_size;
+                update_file_stats(output, ft);
+                if (output->stats_progress_callback)
+                {
+                    output->stats_progress_callback(output->stats_total_sectors, output->stats_total_sectors_processed, 
+                        output->stats_current_file_total_sectors, output->stats_current_file_sectors_processed);
+                }
+                output_unlock(output);
+            }
+            else
+            {
+                break;
             }
         }
+    }
 
-        if (sysAtomicRead(&output->stop_processing) == 1)
-        {
-            // make a copy of the filename
-            char *file_to_remove = strdup(ft->filename);
+    cancelled = sysAtomicRead(&output->stop_processing) == 1;
 
-            sysAtomicSet(&output->processing, 0);
+    if (ft->dsd_encoded_export && ft->dst_encoded_import)
+    {
+        dst_decoder_destroy(ft->dst_decoder);
+    }
 
-            if (ft->dsd_encoded_export && ft->dst_encoded_import)
-            {
-                dst_decoder_destroy(ft->dst_decoder);
-            }
+    if (cancelled)
+    {
+        // make a copy of the filename
+        char *file_to_remove = strdup(ft->filename);
 
-            close_output_file(ft);
+        output_lock(output);
+        close_output_file(ft);
+        output_unlock(output);
 
-            // remove the file being worked on
+        // remove the file being worked on
 #ifdef __lv2ppu__
-            if (sysFsUnlink(file_to_remove) != 0)
+        if (sysFsUnlink(file_to_remove) != 0)
 #else
-            if (remove(file_to_remove) != 0)
+        if (remove(file_to_remove) != 0)
 #endif
-            {
-                LOG(lm_main, LOG_ERROR, ("user cancelled, error removing: %s, [%s]", file_to_remove, strerror(errno)));
-            }
-            free(file_to_remove);
+        {
+            LOG(lm_main, LOG_ERROR, ("user cancelled, error removing: %s, [%s]", file_to_remove, strerror(errno)));
+        }
+        free(file_to_remove);
+
+        return 0;
+    }
+
+    output_lock(output);
+    close_output_file(ft);
+    output_unlock(output);
+
+    return 1;
+}
+
+static void rip_tracks(void *arg)
+{
+    rip_worker_t *worker = (rip_worker_t *) arg;
+    scarletbook_output_t *output = worker->output;
+    struct list_head * node_ptr;
+    scarletbook_output_format_t * ft;
+
+    for (;;)
+    {
+        output_lock(output);
+        if (sysAtomicRead(&output->stop_processing) == 1 || list_empty(&output->ripping_queue))
+        {
+            output_unlock(output);
+            break;
+        }
+        node_ptr = output->ripping_queue.next;
+
+        ft = list_entry(node_ptr, scarletbook_output_format_t, siblings);
+        list_del(node_ptr);
+        output_unlock(output);
+
+        if (!rip_track(worker, ft))
+            break;
+    }
+}
 
-            destroy_ripping_queue(output);
 #ifdef __lv2ppu__
-            sysThreadExit(-1);
+static void processing_thread(void *arg)
 #else
-            pthread_exit(0);
+static void *processing_thread(void *arg)
+#endif
+{
+    scarletbook_output_t *output = (scarletbook_output_t *) arg;
+    rip_worker_t *workers;
+    int worker_count;
+#ifndef __lv2ppu__
+    int i;
 #endif
-        }
 
-        if (ft->dsd_encoded_export && ft->dst_encoded_import)
-        {
-            dst_decoder_destroy(ft->dst_decoder);
-        }
+    worker_count = output->rip_threads;
+    if (worker_count > output->stats_total_tracks)
+        worker_count = output->stats_total_tracks;
+    if (worker_count < 1)
+        worker_count = 1;
+    output->rip_workers = worker_count;
+
+    // the first worker runs on this thread with the frame state of the handle
+    workers = (rip_worker_t *) calloc(worker_count, sizeof(rip_worker_t));
+    workers[0].output = output;
+    workers[0].frames = output->sb_handle;
+    workers[0].read_buffer = output->read_buffer;
+#ifndef __lv2ppu__
+    // fork before any worker runs, the workers fill in the track text of the handle
+    for (i = 1; i < worker_count; i++)
+    {
+        workers[i].output = output;
+        workers[i].frames = scarletbook_frame_fork(output->sb_handle);
+        workers[i].read_buffer = (uint8_t *) malloc(MAX_PROCESSING_BLOCK_SIZE * SACD_LSN_SIZE);
+    }
+    for (i = 1; i < worker_count; i++)
+    {
+        if (workers[i].frames && workers[i].read_buffer)
+            workers[i].pool_thread = launch(rip_tracks, &workers[i]);
+    }
+#endif
+
+    rip_tracks(&workers[0]);
+
+#ifndef __lv2ppu__
+    for (i = 1; i < worker_count; i++)
+    {
+        if (workers[i].pool_thread)
+            join(workers[i].pool_thread);
+        scarletbook_frame_fork_close(workers[i].frames);
+        free(workers[i].read_buffer);
+    }
+#endif
+    free(workers);
 
-        close_output_file(ft);
-    } 
     destroy_ripping_queue(output);
     sysAtomicSet(&output->processing, 0);
 
@@ -495,6 +635,9 @@ scarletbook_output_t *scarletbook_output_create(scarletbook_handle_t *handle, st
     output->stats_progress_callback = cb_progress;
     output->fwprintf_callback = cb_fwprintf;
 
+    // tracks are ripped one at a time unless scarletbook_output_set_threads() says otherwise
+    output->rip_threads = 1;
+
     return output;
 }
 
@@ -508,6 +651,14 @@ int scarletbook_output_start(scarletbook_output_t *output)
     int ret = 0;
 
     scarletbook_output_init_stats(output);
+    sysAtomicSet(&output->stop_processing, 0);
+    sysAtomicSet(&output->processing, 1);
+    output->non_encrypted_disc = 0;
+    output->checked_for_non_encrypted_disc = 0;
+#ifndef __lv2ppu__
+    if (!output->rip_lock)
+        output->rip_lock = new_lock(0);
+#endif
 
 #ifdef __lv2ppu__
     ret = sysThreadCreate(&output->processing_thread_id,
@@ -522,12 +673,23 @@ int scarletbook_output_start(scarletbook_output_t *output)
 #endif
     if (ret)
     {
+        sysAtomicSet(&output->processing, 0);
         LOG(lm_main, LOG_ERROR, ("return code from processing thread creation is %d\n", ret));
     }
 
     return ret;
 }
 
+void scarletbook_output_set_threads(scarletbook_output_t *output, int threads)
+{
+#ifdef __lv2ppu__
+    threads = 1;
+#endif
+    if (threads == 0)
+        threads = (int) processor_count();
+    output->rip_threads = threads < 1 ? 1 : min(threads, MAX_RIP_THREADS);
+}
+
 void scarletbook_output_interrupt(scarletbook_output_t *output)
 {
     sysAtomicSet(&output->stop_processing, 1);
@@ -560,6 +722,10 @@ int scarletbook_output_destroy(scarletbook_output_t *output)
     // If decoding is aborted (eg. ctrl+C), then free() buffers after the decoder has been destroyed,
     // to ensure that buffers aren't still in use when they're free()d.
     free(output->read_buffer);
+#ifndef __lv2ppu__
+    if (output->rip_lock)
+        free_lock(output->rip_lock);
+#endif
     free(output);
 
     return ret;
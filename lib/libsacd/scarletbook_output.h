@@ -29,6 +29,7 @@
 #endif
 
 #include "scarletbook.h"
+#include "output_sink.h"
 #include <sys/atomic.h>
 
 #if !defined(__lv2ppu__)
@@ -54,6 +55,10 @@ typedef struct scarletbook_format_handler_t
     char const *name;
     int (*startwrite)(scarletbook_output_format_t *ft);
     size_t (*write)(scarletbook_output_format_t *ft, const uint8_t *buf, size_t len);
+    // optional, takes planar DSD frames (a block per channel, LSB first) from the DST decoder
+    size_t (*write_planar)(scarletbook_output_format_t *ft, const uint8_t *buf, size_t len);
+    // optional, takes a plain DSD or DST frame as the segments it occupies in the read buffer
+    size_t (*write_segments)(scarletbook_output_format_t *ft, const scarletbook_frame_segment_t *segments, int segment_count);
     int (*stopwrite)(scarletbook_output_format_t *ft);
     int         flags;
     size_t      priv_size;
@@ -74,6 +79,7 @@ struct scarletbook_output_format_t
     int                             channel_count;
 
     FILE                           *fd;
+    output_sink_t                  *sink;           // where the handler writes to
     char                           *write_cache;
     uint64_t                        write_length;
     uint64_t                        write_offset;
@@ -81,6 +87,9 @@ struct scarletbook_output_format_t
     int                             dst_encoded_import;
     int                             dsd_encoded_export;
 
+    int                             streaming;      // written front to back and never patched (dsdiff only)
+    uint64_t                        stream_size;    // file size announced by startwrite when streaming
+
     scarletbook_format_handler_t    handler;
     void                           *priv;
 
@@ -100,12 +109,22 @@ typedef void (*stats_progress_callback_t)(uint32_t stats_total_sectors, uint32_t
 
 typedef void (*stats_track_callback_t)(char *filename, int current_track, int total_tracks);
 
+#define MAX_RIP_THREADS 4
+
 typedef struct scarletbook_output_s
 {
     struct list_head    ripping_queue;
 
     uint8_t            *read_buffer;
 
+    int                 rip_threads;                // tracks ripped at the same time
+    int                 rip_workers;                // of those, the workers of the current run
+#ifndef __lv2ppu__
+    lock               *rip_lock;                   // serializes the reads, the stats and the creating and closing of files
+#endif
+    int                 non_encrypted_disc;
+    int                 checked_for_non_encrypted_disc;
+
 #ifdef __lv2ppu__
     sys_ppu_thread_t    processing_thread_id;
 #else
@@ -134,6 +153,7 @@ int scarletbook_output_destroy(scarletbook_output_t *);
 int scarletbook_output_enqueue_track(scarletbook_output_t *, int, int, char *, char *, int);
 int scarletbook_output_enqueue_raw_sectors(scarletbook_output_t *, int, int, char *, char *);
 int scarletbook_output_start(scarletbook_output_t *);
+void scarletbook_output_set_threads(scarletbook_output_t *, int);
 void scarletbook_output_interrupt(scarletbook_output_t *);
 int scarletbook_output_is_busy(scarletbook_output_t *);
 
@@ -35,6 +35,7 @@
 #include <utils.h>
 
 #include "scarletbook.h"
+#include "scarletbook_read.h"
 #include "scarletbook_print.h"
 
 static const wchar_t *ucs(const char* str) 
@@ -153,41 +154,41 @@ static void scarletbook_print_master_toc(scarletbook_handle_t *handle)
     scarletbook_print_album_text(handle);
 }
 
+static const struct
+{
+    track_type_t   track_type;
+    const wchar_t *label;
+}
+track_text_labels[] =
+{
+      { TRACK_TYPE_TITLE, L"Title" }
+    , { TRACK_TYPE_TITLE_PHONETIC, L"Title Phonetic" }
+    , { TRACK_TYPE_PERFORMER, L"Performer" }
+    , { TRACK_TYPE_PERFORMER_PHONETIC, L"Performer Phonetic" }
+    , { TRACK_TYPE_SONGWRITER, L"Songwriter" }
+    , { TRACK_TYPE_SONGWRITER_PHONETIC, L"Songwriter Phonetic" }
+    , { TRACK_TYPE_COMPOSER, L"Composer" }
+    , { TRACK_TYPE_COMPOSER_PHONETIC, L"Composer Phonetic" }
+    , { TRACK_TYPE_ARRANGER, L"Arranger" }
+    , { TRACK_TYPE_ARRANGER_PHONETIC, L"Arranger Phonetic" }
+    , { TRACK_TYPE_MESSAGE, L"Message" }
+    , { TRACK_TYPE_MESSAGE_PHONETIC, L"Message Phonetic" }
+    , { TRACK_TYPE_EXTRA_MESSAGE, L"Extra Message" }
+    , { TRACK_TYPE_EXTRA_MESSAGE_PHONETIC, L"Extra Message Phonetic" }
+};
+
 static void scarletbook_print_area_text(scarletbook_handle_t *handle, int area_idx)
 {
-    int i;
+    int i, j;
     fwprintf(stdout, L"\tTrack list [%d]:\n", area_idx);
     for (i = 0; i < handle->area[area_idx].area_toc->track_count; i++)
     {
-        area_track_text_t *track_text = &handle->area[area_idx].area_track_text[i];
-        if (track_text->track_type_title)
-            fwprintf(stdout, L"\t\tTitle[%d]: %ls\n", i, ucs(track_text->track_type_title));
-        if (track_text->track_type_title_phonetic)
-            fwprintf(stdout, L"\t\tTitle Phonetic[%d]: %ls\n", i, ucs(track_text->track_type_title_phonetic));
-        if (track_text->track_type_performer)
-            fwprintf(stdout, L"\t\tPerformer[%d]: %ls\n", i, ucs(track_text->track_type_performer));
-        if (track_text->track_type_performer_phonetic)
-            fwprintf(stdout, L"\t\tPerformer Phonetic[%d]: %ls\n", i, ucs(track_text->track_type_performer_phonetic));
-        if (track_text->track_type_songwriter)
-            fwprintf(stdout, L"\t\tSongwriter[%d]: %ls\n", i, ucs(track_text->track_type_songwriter));
-        if (track_text->track_type_songwriter_phonetic)
-            fwprintf(stdout, L"\t\tSongwriter Phonetic[%d]: %ls\n", i, ucs(track_text->track_type_songwriter_phonetic));
-        if (track_text->track_type_composer)
-            fwprintf(stdout, L"\t\tComposer[%d]: %ls\n", i, ucs(track_text->track_type_composer));
-        if (track_text->track_type_composer_phonetic)
-            fwprintf(stdout, L"\t\tComposer Phonetic[%d]: %ls\n", i, ucs(track_text->track_type_composer_phonetic));
-        if (track_text->track_type_arranger)
-            fwprintf(stdout, L"\t\tArranger[%d]: %ls\n", i, ucs(track_text->track_type_arranger));
-        if (track_text->track_type_arranger_phonetic)
-            fwprintf(stdout, L"\t\tArranger Phonetic[%d]: %ls\n", i, ucs(track_text->track_type_arranger_phonetic));
-        if (track_text->track_type_message)
-            fwprintf(stdout, L"\t\tMessage[%d]: %ls\n", i, ucs(track_text->track_type_message));
-        if (track_text->track_type_message_phonetic)
-            fwprintf(stdout, L"\t\tMessage Phonetic[%d]: %ls\n", i, ucs(track_text->track_type_message_phonetic));
-        if (track_text->track_type_extra_message)
-            fwprintf(stdout, L"\t\tExtra Message[%d]: %ls\n", i, ucs(track_text->track_type_extra_message));
-        if (track_text->track_type_extra_message_phonetic)
-            fwprintf(stdout, L"\t\tExtra Message Phonetic[%d]: %ls\n", i, ucs(track_text->track_type_extra_message_phonetic));
+        for (j = 0; j < TRACK_TEXT_TYPE_COUNT; j++)
+        {
+            char *text = scarletbook_track_text(handle, area_idx, i, track_text_labels[j].track_type);
+            if (text)
+                fwprintf(stdout, L"\t\t%ls[%d]: %ls\n", track_text_labels[j].label, i, ucs(text));
+        }
     }
 }
 
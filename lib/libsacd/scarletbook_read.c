@@ -28,6 +28,7 @@
 #endif
 
 #include <charset.h>
+#include <utils.h>
 
 #include "endianess.h"
 #include "scarletbook.h"
@@ -35,6 +36,9 @@
 #include "scarletbook_helpers.h"
 #include "sacd_reader.h"
 #include "sacd_read_internal.h"
+#ifndef __lv2ppu__
+#include "yarn.h"
+#endif
 
 #ifndef NDEBUG
 #define CHECK_ZERO0(arg)                                                       \
@@ -57,6 +61,42 @@ static const uint8_t my_friendly_zeros[2048];
 #define CHECK_ZERO(arg)     (void) (arg)
 #endif
 
+#ifndef __lv2ppu__
+// a run of sectors walked on a thread of the frame pool
+typedef struct
+{
+    scarletbook_frame_pool_t   *pool;
+    thread                     *thread;
+
+    uint8_t                    *read_buffer;
+    int                         blocks_read;
+    int                         frame_start_seen;
+
+    audio_sector_t              audio_sector;
+    scarletbook_audio_frame_t   frame;
+    scarletbook_frame_batch_t   batch;
+    scarletbook_frame_batch_t   lead;
+}
+scarletbook_frame_chunk_t;
+
+// the threads of a handle walking the runs of its blocks, the first run of a
+// block is walked by the thread processing it
+struct scarletbook_frame_pool_t
+{
+    lock                       *work;           // blocks handed out, -1 when the threads are to quit
+    lock                       *done;           // threads done with the current block
+    int                         chunk_count;
+    scarletbook_frame_chunk_t   chunks[MAX_FRAME_THREADS];
+};
+
+static void frame_pool_destroy(scarletbook_frame_pool_t *);
+#endif
+
+// the first block of the arena takes the handle, the frame buffer and the master TOC,
+// the area TOCs and the disc text go in blocks added as needed
+#define SCARLETBOOK_ARENA_SIZE          (sizeof(scarletbook_handle_t) + 3 * MAX_DST_SIZE + MASTER_TOC_LEN * SACD_LSN_SIZE + 256)
+#define SCARLETBOOK_ARENA_BLOCK_SIZE    (16 * 1024)
+
 /* Prototypes for internal functions */
 static int scarletbook_read_master_toc(scarletbook_handle_t *);
 static int scarletbook_read_area_toc(scarletbook_handle_t *, int);
@@ -64,19 +104,19 @@ static int scarletbook_read_area_toc(scarletbook_handle_t *, int);
 scarletbook_handle_t *scarletbook_open(sacd_reader_t *sacd, int title)
 {
     scarletbook_handle_t *sb;
+    arena_t *arena;
 
-    sb = (scarletbook_handle_t *) calloc(sizeof(scarletbook_handle_t), 1);
-    if (!sb)
+    arena = arena_create(SCARLETBOOK_ARENA_SIZE, SCARLETBOOK_ARENA_BLOCK_SIZE);
+    if (!arena)
         return NULL;
 
-#ifdef __lv2ppu__
-    sb->frame.data = (uint8_t *) memalign(128, MAX_DST_SIZE);
-#else
-    sb->frame.data = (uint8_t *) malloc(MAX_DST_SIZE);
-#endif
+    sb = (scarletbook_handle_t *) arena_calloc(arena, sizeof(scarletbook_handle_t));
+    sb->arena = arena;
+    sb->frame.buffer = (uint8_t *) arena_memalign(arena, 128, 3 * MAX_DST_SIZE);
 
-    if (!sb->frame.data)
-        return NULL;
+    sb->frame.data = sb->frame.buffer;
+    sb->frame.spare = sb->frame.buffer + MAX_DST_SIZE;
+    sb->frame.gather = sb->frame.buffer + 2 * MAX_DST_SIZE;
 
     sb->sacd      = sacd;
     sb->twoch_area_idx = -1;
@@ -91,7 +131,7 @@ scarletbook_handle_t *scarletbook_open(sacd_reader_t *sacd, int title)
 
     if (sb->master_toc->area_1_toc_1_start)
     {
-        sb->area[sb->area_count].area_data = malloc(sb->master_toc->area_1_toc_size * SACD_LSN_SIZE);
+        sb->area[sb->area_count].area_data = arena_alloc(sb->arena, sb->master_toc->area_1_toc_size * SACD_LSN_SIZE);
         if (!sb->area[sb->area_count].area_data)
         {
             scarletbook_close(sb);
@@ -114,7 +154,7 @@ scarletbook_handle_t *scarletbook_open(sacd_reader_t *sacd, int title)
     }
     if (sb->master_toc->area_2_toc_1_start)
     {
-        sb->area[sb->area_count].area_data = malloc(sb->master_toc->area_2_toc_size * SACD_LSN_SIZE);
+        sb->area[sb->area_count].area_data = arena_alloc(sb->arena, sb->master_toc->area_2_toc_size * SACD_LSN_SIZE);
         if (!sb->area[sb->area_count].area_data)
         {
             scarletbook_close(sb);
@@ -139,81 +179,32 @@ scarletbook_handle_t *scarletbook_open(sacd_reader_t *sacd, int title)
     return sb;
 }
 
-static void free_area(scarletbook_area_t *area)
-{
-    int i;
-    
-    for (i = 0; i < area->area_toc->track_count; i++)
-    {
-        free(area->area_track_text[i].track_type_title);
-        free(area->area_track_text[i].track_type_performer);
-        free(area->area_track_text[i].track_type_songwriter);
-        free(area->area_track_text[i].track_type_composer);
-        free(area->area_track_text[i].track_type_arranger);
-        free(area->area_track_text[i].track_type_message);
-        free(area->area_track_text[i].track_type_extra_message);
-        free(area->area_track_text[i].track_type_title_phonetic);
-        free(area->area_track_text[i].track_type_performer_phonetic);
-        free(area->area_track_text[i].track_type_songwriter_phonetic);
-        free(area->area_track_text[i].track_type_composer_phonetic);
-        free(area->area_track_text[i].track_type_arranger_phonetic);
-        free(area->area_track_text[i].track_type_message_phonetic);
-        free(area->area_track_text[i].track_type_extra_message_phonetic);
-    }
-
-    free(area->description);
-    free(area->copyright);
-    free(area->description_phonetic);
-    free(area->copyright_phonetic);
-}
-
 void scarletbook_close(scarletbook_handle_t *handle)
 {
     if (!handle)
         return;
 
-    if (has_two_channel(handle))
-    {
-        free_area(&handle->area[handle->twoch_area_idx]);
-        free(handle->area[handle->twoch_area_idx].area_data);
-    }
-
-    if (has_multi_channel(handle))
-    {
-        free_area(&handle->area[handle->mulch_area_idx]);
-        free(handle->area[handle->mulch_area_idx].area_data);
-    }
-
-    {
-        master_text_t *mt = &handle->master_text;
-        free(mt->album_title);
-        free(mt->album_title_phonetic);
-        free(mt->album_artist);
-        free(mt->album_artist_phonetic);
-        free(mt->album_publisher);
-        free(mt->album_publisher_phonetic);
-        free(mt->album_copyright);
-        free(mt->album_copyright_phonetic);
-        free(mt->disc_title);
-        free(mt->disc_title_phonetic);
-        free(mt->disc_artist);
-        free(mt->disc_artist_phonetic);
-        free(mt->disc_publisher);
-        free(mt->disc_publisher_phonetic);
-        free(mt->disc_copyright);
-        free(mt->disc_copyright_phonetic);
-    } 
+#ifndef __lv2ppu__
+    if (handle->frame_pool)
+        frame_pool_destroy(handle->frame_pool);
+#endif
 
-    if (handle->master_data)
-        free((void *) handle->master_data);
+    // the frame batches grow as needed and stay on the heap
+    free(handle->frame_batch.frames);
+    free(handle->frame_batch.segments);
 
-    if (handle->frame.data)
-        free((void *) handle->frame.data);
+    // everything else, the handle included, goes with the arena
+    arena_destroy(handle->arena);
+}
 
-    memset(handle, 0, sizeof(scarletbook_handle_t));
+// converts disc text to UTF-8 and keeps it with the handle
+static char *scarletbook_text(scarletbook_handle_t *handle, const char *raw, const char *charset)
+{
+    char *converted = charset_convert(raw, strlen(raw), charset, "UTF-8");
+    char *text = arena_strdup(handle->arena, converted);
 
-    free(handle);
-    handle = 0;
+    free(converted);
+    return text;
 }
 
 static int scarletbook_read_master_toc(scarletbook_handle_t *handle)
@@ -222,7 +213,7 @@ static int scarletbook_read_master_toc(scarletbook_handle_t *handle)
     uint8_t      * p;
     master_toc_t *master_toc;
 
-    handle->master_data = malloc(MASTER_TOC_LEN * SACD_LSN_SIZE);
+    handle->master_data = arena_alloc(handle->arena, MASTER_TOC_LEN * SACD_LSN_SIZE);
     if (!handle->master_data)
         return 0;
 
@@ -309,38 +300,38 @@ static int scarletbook_read_master_toc(scarletbook_handle_t *handle)
             char *current_charset = (char *) character_set[handle->master_toc->locales[i].character_set & 0x07];
 
             if (master_text->album_title_position)
-                handle->master_text.album_title = charset_convert((char *) master_text + master_text->album_title_position, strlen((char *) master_text + master_text->album_title_position), current_charset, "UTF-8");
+                handle->master_text.album_title = scarletbook_text(handle, (char *) master_text + master_text->album_title_position, current_charset);
             if (master_text->album_title_phonetic_position)
-                handle->master_text.album_title_phonetic = charset_convert((char *) master_text + master_text->album_title_phonetic_position, strlen((char *) master_text + master_text->album_title_phonetic_position), current_charset, "UTF-8");
+                handle->master_text.album_title_phonetic = scarletbook_text(handle, (char *) master_text + master_text->album_title_phonetic_position, current_charset);
             if (master_text->album_artist_position)
-                handle->master_text.album_artist = charset_convert((char *) master_text + master_text->album_artist_position, strlen((char *) master_text + master_text->album_artist_position), current_charset, "UTF-8");
+                handle->master_text.album_artist = scarletbook_text(handle, (char *) master_text + master_text->album_artist_position, current_charset);
             if (master_text->album_artist_phonetic_position)
-                handle->master_text.album_artist_phonetic = charset_convert((char *) master_text + master_text->album_artist_phonetic_position, strlen((char *) master_text + master_text->album_artist_phonetic_position), current_charset, "UTF-8");
+                handle->master_text.album_artist_phonetic = scarletbook_text(handle, (char *) master_text + master_text->album_artist_phonetic_position, current_charset);
             if (master_text->album_publisher_position)
-                handle->master_text.album_publisher = charset_convert((char *) master_text + master_text->album_publisher_position, strlen((char *) master_text + master_text->album_publisher_position), current_charset, "UTF-8");
+                handle->master_text.album_publisher = scarletbook_text(handle, (char *) master_text + master_text->album_publisher_position, current_charset);
             if (master_text->album_publisher_phonetic_position)
-                handle->master_text.album_publisher_phonetic = charset_convert((char *) master_text + master_text->album_publisher_phonetic_position, strlen((char *) master_text + master_text->album_publisher_phonetic_position), current_charset, "UTF-8");
+                handle->master_text.album_publisher_phonetic = scarletbook_text(handle, (char *) master_text + master_text->album_publisher_phonetic_position, current_charset);
             if (master_text->album_copyright_position)
-                handle->master_text.album_copyright = charset_convert((char *) master_text + master_text->album_copyright_position, strlen((char *) master_text + master_text->album_copyright_position), current_charset, "UTF-8");
+                handle->master_text.album_copyright = scarletbook_text(handle, (char *) master_text + master_text->album_copyright_position, current_charset);
             if (master_text->album_copyright_phonetic_position)
-                handle->master_text.album_copyright_phonetic = charset_convert((char *) master_text + master_text->album_copyright_phonetic_position, strlen((char *) master_text + master_text->album_copyright_phonetic_position), current_charset, "UTF-8");
+                handle->master_text.album_copyright_phonetic = scarletbook_text(handle, (char *) master_text + master_text->album_copyright_phonetic_position, current_charset);
 
             if (master_text->disc_title_position)
-                handle->master_text.disc_title = charset_convert((char *) master_text + master_text->disc_title_position, strlen((char *) master_text + master_text->disc_title_position), current_charset, "UTF-8");
+                handle->master_text.disc_title = scarletbook_text(handle, (char *) master_text + master_text->disc_title_position, current_charset);
             if (master_text->disc_title_phonetic_position)
-                handle->master_text.disc_title_phonetic = charset_convert((char *) master_text + master_text->disc_title_phonetic_position, strlen((char *) master_text + master_text->disc_title_phonetic_position), current_charset, "UTF-8");
+                handle->master_text.disc_title_phonetic = scarletbook_text(handle, (char *) master_text + master_text->disc_title_phonetic_position, current_charset);
             if (master_text->disc_artist_position)
-                handle->master_text.disc_artist = charset_convert((char *) master_text + master_text->disc_artist_position, strlen((char *) master_text + master_text->disc_artist_position), current_charset, "UTF-8");
+                handle->master_text.disc_artist = scarletbook_text(handle, (char *) master_text + master_text->disc_artist_position, current_charset);
             if (master_text->disc_artist_phonetic_position)
-                handle->master_text.disc_artist_phonetic = charset_convert((char *) master_text + master_text->disc_artist_phonetic_position, strlen((char *) master_text + master_text->disc_artist_phonetic_position), current_charset, "UTF-8");
+                handle->master_text.disc_artist_phonetic = scarletbook_text(handle, (char *) master_text + master_text->disc_artist_phonetic_position, current_charset);
             if (master_text->disc_publisher_position)
-                handle->master_text.disc_publisher = charset_convert((char *) master_text + master_text->disc_publisher_position, strlen((char *) master_text + master_text->disc_publisher_position), current_charset, "UTF-8");
+                handle->master_text.disc_publisher = scarletbook_text(handle, (char *) master_text + master_text->disc_publisher_position, current_charset);
             if (master_text->disc_publisher_phonetic_position)
-                handle->master_text.disc_publisher_phonetic = charset_convert((char *) master_text + master_text->disc_publisher_phonetic_position, strlen((char *) master_text + master_text->disc_publisher_phonetic_position), current_charset, "UTF-8");
+                handle->master_text.disc_publisher_phonetic = scarletbook_text(handle, (char *) master_text + master_text->disc_publisher_phonetic_position, current_charset);
             if (master_text->disc_copyright_position)
-                handle->master_text.disc_copyright = charset_convert((char *) master_text + master_text->disc_copyright_position, strlen((char *) master_text + master_text->disc_copyright_position), current_charset, "UTF-8");
+                handle->master_text.disc_copyright = scarletbook_text(handle, (char *) master_text + master_text->disc_copyright_position, current_charset);
             if (master_text->disc_copyright_phonetic_position)
-                handle->master_text.disc_copyright_phonetic = charset_convert((char *) master_text + master_text->disc_copyright_phonetic_position, strlen((char *) master_text + master_text->disc_copyright_phonetic_position), current_charset, "UTF-8");
+                handle->master_text.disc_copyright_phonetic = scarletbook_text(handle, (char *) master_text + master_text->disc_copyright_phonetic_position, current_charset);
         }
 
         p += SACD_LSN_SIZE;
@@ -355,9 +346,52 @@ static int scarletbook_read_master_toc(scarletbook_handle_t *handle)
     return 1;
 }
 
+// a main access list entry, the sector takes its last three bytes
+static inline uint32_t access_list_lsn(const area_access_list_t *access_list, int i)
+{
+    const uint8_t *entry = access_list->main_access_list[i];
+    return (uint32_t) entry[2] << 16 | (uint32_t) entry[3] << 8 | entry[4];
+}
+
+// entry i of the main access list gives the sector of frame i * main_step_size,
+// a list that doesn't fit the area is left unused
+static int access_list_usable(scarletbook_area_t *area)
+{
+    area_access_list_t *access_list = area->area_access_list;
+    uint32_t total_frames = TIME_FRAMECOUNT(&area->area_toc->total_playtime);
+    uint32_t lsn, prev_lsn = area->area_toc->track_start;
+    int i;
+
+    if (access_list->entry_count == 0 || access_list->entry_count > 6550 || access_list->main_step_size == 0)
+        return 0;
+
+    if ((uint32_t) (access_list->entry_count - 1) * access_list->main_step_size > total_frames)
+        return 0;
+
+    for (i = 0; i < access_list->entry_count; i++)
+    {
+        lsn = access_list_lsn(access_list, i);
+        if (lsn < prev_lsn || lsn > area->area_toc->track_end)
+            return 0;
+        prev_lsn = lsn;
+    }
+    return 1;
+}
+
+// where a type of track text goes in area_track_text_t, -1 for unknown types
+static int track_text_index(uint8_t track_type)
+{
+    int index = (track_type & 0x7f) - TRACK_TYPE_TITLE;
+
+    if (index < 0 || index >= TRACK_TEXT_TYPE_COUNT / 2)
+        return -1;
+
+    return (track_type & 0x80) ? index + TRACK_TEXT_TYPE_COUNT / 2 : index;
+}
+
 static int scarletbook_read_area_toc(scarletbook_handle_t *handle, int area_idx)
 {
-    int                 i, j;
+    int                 i, j, index;
     area_toc_t         *area_toc;
     uint8_t            *area_data;
     uint8_t            *p;
@@ -398,13 +432,13 @@ static int scarletbook_read_area_toc(scarletbook_handle_t *handle, int area_idx)
     current_charset = (char *) character_set[area->area_toc->languages[sacd_text_idx].character_set & 0x07];
 
     if (area_toc->copyright_offset)
-        area->description_phonetic = charset_convert((char *) area_toc + area_toc->copyright_offset, strlen((char *) area_toc + area_toc->copyright_offset), current_charset, "UTF-8");
+        area->description_phonetic = scarletbook_text(handle, (char *) area_toc + area_toc->copyright_offset, current_charset);
     if (area_toc->copyright_phonetic_offset)
-        area->description_phonetic = charset_convert((char *) area_toc + area_toc->copyright_phonetic_offset, strlen((char *) area_toc + area_toc->copyright_phonetic_offset), current_charset, "UTF-8");
+        area->description_phonetic = scarletbook_text(handle, (char *) area_toc + area_toc->copyright_phonetic_offset, current_charset);
     if (area_toc->area_description_offset)
-        area->description_phonetic = charset_convert((char *) area_toc + area_toc->area_description_offset, strlen((char *) area_toc + area_toc->area_description_offset), current_charset, "UTF-8");
+        area->description_phonetic = scarletbook_text(handle, (char *) area_toc + area_toc->area_description_offset, current_charset);
     if (area_toc->area_description_phonetic_offset)
-        area->description_phonetic = charset_convert((char *) area_toc + area_toc->area_description_phonetic_offset, strlen((char *) area_toc + area_toc->area_description_phonetic_offset), current_charset, "UTF-8");
+        area->description_phonetic = scarletbook_text(handle, (char *) area_toc + area_toc->area_description_phonetic_offset, current_charset);
 
     if (area_toc->version.major > SUPPORTED_VERSION_MAJOR || area_toc->version.minor > SUPPORTED_VERSION_MINOR)
     {
@@ -449,53 +483,10 @@ static int scarletbook_read_area_toc(scarletbook_handle_t *handle, int area_idx)
                             track_type = *track_ptr;
                             track_ptr++;
                             track_ptr++;                         // skip unknown 0x20
-                            if (*track_ptr != 0)
+                            index = track_text_index(track_type);
+                            if (*track_ptr != 0 && index >= 0)
                             {
-                                switch (track_type)
-                                {
-                                case TRACK_TYPE_TITLE:
-                                    area->area_track_text[i].track_type_title = charset_convert(track_ptr, strlen(track_ptr), current_charset, "UTF-8");
-                                    break;
-                                case TRACK_TYPE_PERFORMER:
-                                    area->area_track_text[i].track_type_performer = charset_convert(track_ptr, strlen(track_ptr), current_charset, "UTF-8");
-                                    break;
-                                case TRACK_TYPE_SONGWRITER:
-                                    area->area_track_text[i].track_type_songwriter = charset_convert(track_ptr, strlen(track_ptr), current_charset, "UTF-8");
-                                    break;
-                                case TRACK_TYPE_COMPOSER:
-                                    area->area_track_text[i].track_type_composer = charset_convert(track_ptr, strlen(track_ptr), current_charset, "UTF-8");
-                                    break;
-                                case TRACK_TYPE_ARRANGER:
-                                    area->area_track_text[i].track_type_arranger = charset_convert(track_ptr, strlen(track_ptr), current_charset, "UTF-8");
-                                    break;
-                                case TRACK_TYPE_MESSAGE:
-                                    area->area_track_text[i].track_type_message = charset_convert(track_ptr, strlen(track_ptr), current_charset, "UTF-8");
-                                    break;
-                                case TRACK_TYPE_EXTRA_MESSAGE:
-                                    area->area_track_text[i].track_type_extra_message = charset_convert(track_ptr, strlen(track_ptr), current_charset, "UTF-8");
-                                    break;
-                                case TRACK_TYPE_TITLE_PHONETIC:
-                                    area->area_track_text[i].track_type_title_phonetic = charset_convert(track_ptr, strlen(track_ptr), current_charset, "UTF-8");
-                                    break;
-                                case TRACK_TYPE_PERFORMER_PHONETIC:
-                                    area->area_track_text[i].track_type_performer_phonetic = charset_convert(track_ptr, strlen(track_ptr), current_charset, "UTF-8");
-                                    break;
-                                case TRACK_TYPE_SONGWRITER_PHONETIC:
-                                    area->area_track_text[i].track_type_songwriter_phonetic = charset_convert(track_ptr, strlen(track_ptr), current_charset, "UTF-8");
-                                    break;
-                                case TRACK_TYPE_COMPOSER_PHONETIC:
-                                    area->area_track_text[i].track_type_composer_phonetic = charset_convert(track_ptr, strlen(track_ptr), current_charset, "UTF-8");
-                                    break;
-                                case TRACK_TYPE_ARRANGER_PHONETIC:
-                                    area->area_track_text[i].track_type_arranger_phonetic = charset_convert(track_ptr, strlen(track_ptr), current_charset, "UTF-8");
-                                    break;
-                                case TRACK_TYPE_MESSAGE_PHONETIC:
-                                    area->area_track_text[i].track_type_message_phonetic = charset_convert(track_ptr, strlen(track_ptr), current_charset, "UTF-8");
-                                    break;
-                                case TRACK_TYPE_EXTRA_MESSAGE_PHONETIC:
-                                    area->area_track_text[i].track_type_extra_message_phonetic = charset_convert(track_ptr, strlen(track_ptr), current_charset, "UTF-8");
-                                    break;
-                                }
+                                area->area_track_text[i].offset[index] = (uint32_t) ((uint8_t *) track_ptr - area_data);
                             }
                             if (j < track_amount - 1)
                             {
@@ -519,7 +510,12 @@ static int scarletbook_read_area_toc(scarletbook_handle_t *handle, int area_idx)
         }
         else if (strncmp((char *) p, "SACD_ACC", 8) == 0)
         {
-            // skip
+            area->area_access_list = (area_access_list_t *) p;
+            SWAP16(area->area_access_list->entry_count);
+            if (!access_list_usable(area))
+            {
+                area->area_access_list = 0;
+            }
             p += SACD_LSN_SIZE * 32;
         }
         else if (strncmp((char *) p, "SACDTRL1", 8) == 0)
@@ -550,7 +546,6 @@ static int scarletbook_read_area_toc(scarletbook_handle_t *handle, int area_idx)
 
 void scarletbook_frame_init(scarletbook_handle_t *handle)
 {
-    handle->packet_info_idx = 0;
     handle->frame.size = 0;
     handle->frame.started = 0;
     memset(&handle->audio_sector, 0, sizeof(audio_sector_t));
@@ -572,99 +567,197 @@ static inline int get_channel_count(audio_frame_info_t *frame_info)
     }
 }
 
-static inline void exec_read_callback(scarletbook_handle_t *handle, frame_read_callback_t frame_read_callback, void *userdata)
+// returns 0 and fails the batch when the segments can't grow
+static scarletbook_frame_segment_t *add_frame_segment(scarletbook_frame_batch_t *batch)
 {
-    if (handle->frame.started && handle->frame.size > 0 && 
-        ((handle->frame.dst_encoded && handle->frame.sector_count == 0) ||
-        (!handle->frame.dst_encoded && handle->frame.size % FRAME_SIZE_64 == 0))
+    if (batch->segment_count == batch->segments_allocated)
+    {
+        scarletbook_frame_segment_t *segments;
+
+        segments = (scarletbook_frame_segment_t *) realloc(batch->segments, (batch->segments_allocated + 256) * sizeof(scarletbook_frame_segment_t));
+        if (!segments)
+        {
+            batch->failed = 1;
+            return 0;
+        }
+        batch->segments = segments;
+        batch->segments_allocated += 256;
+    }
+    return &batch->segments[batch->segment_count++];
+}
+
+// returns 0 and fails the batch when the frames can't grow
+static scarletbook_frame_desc_t *add_frame_desc(scarletbook_frame_batch_t *batch)
+{
+    if (batch->frame_count == batch->frames_allocated)
+    {
+        scarletbook_frame_desc_t *frames;
+
+        frames = (scarletbook_frame_desc_t *) realloc(batch->frames, (batch->frames_allocated + 64) * sizeof(scarletbook_frame_desc_t));
+        if (!frames)
+        {
+            batch->failed = 1;
+            return 0;
+        }
+        batch->frames = frames;
+        batch->frames_allocated += 64;
+    }
+    return &batch->frames[batch->frame_count++];
+}
+
+static inline void end_frame(scarletbook_audio_frame_t *frame, scarletbook_frame_batch_t *batch)
+{
+    if (frame->started && frame->size > 0 && 
+        ((frame->dst_encoded && frame->sector_count == 0) ||
+        (!frame->dst_encoded && frame->size % FRAME_SIZE_64 == 0))
         )
     {
-        handle->frame.started = 0;
-        frame_read_callback(handle, handle->frame.data, handle->frame.size, userdata);
+        scarletbook_frame_desc_t *desc;
+
+        frame->started = 0;
+
+        desc = add_frame_desc(batch);
+        if (!desc)
+            return;
+        desc->first_segment = frame->first_segment;
+        desc->segment_count = batch->segment_count - frame->first_segment;
+        desc->size = frame->size;
+        desc->data = desc->segment_count == 1 ? batch->segments[frame->first_segment].data : 0;
+        desc->channel_count = frame->channel_count;
+        desc->dst_encoded = frame->dst_encoded;
     }
 }
 
-void scarletbook_process_frames(scarletbook_handle_t *handle, uint8_t *read_buffer, int blocks_read, int last_block, frame_read_callback_t frame_read_callback, void *userdata)
+static inline void start_frame(scarletbook_audio_frame_t *frame, scarletbook_frame_batch_t *batch, audio_sector_t *audio_sector, audio_frame_info_t *frame_info)
 {
-    int i, frame_info_counter;
+    end_frame(frame, batch);
+
+    frame->size = 0;
+    frame->first_segment = batch->segment_count;
+    frame->dst_encoded = audio_sector->header.dst_encoded;
+    frame->sector_count = frame_info->sector_count;
+    frame->channel_count = get_channel_count(frame_info);
+    frame->started = 1;
+}
 
-    while(blocks_read--)
+static inline void add_frame_packet(scarletbook_audio_frame_t *frame, scarletbook_frame_batch_t *batch, uint8_t *data, size_t len)
+{
+    scarletbook_frame_segment_t *segment = 0;
+
+    if (!frame->started)
+        return;
+
+    if (frame->size + len >= MAX_DST_SIZE)
     {
-        uint8_t *read_buffer_ptr = read_buffer;
+        // buffer overflow error, try next frame..
+        frame->started = 0;
+        return;
+    }
 
-        if (handle->packet_info_idx == handle->audio_sector.header.packet_info_count) 
+    // packets that follow each other in a sector extend the same segment
+    if (batch->segment_count > frame->first_segment)
+        segment = &batch->segments[batch->segment_count - 1];
+    if (segment && segment->data + segment->size == data)
+    {
+        segment->size += len;
+    }
+    else if (len > 0)
+    {
+        segment = add_frame_segment(batch);
+        if (!segment)
         {
-            handle->packet_info_idx = 0;
+            frame->started = 0;
+            return;
+        }
+        segment->data = data;
+        segment->size = len;
+    }
+    frame->size += (int) len;
+    if (frame->dst_encoded)
+    {
+        frame->sector_count--;
+    }
+}
+
+// reads the header, packet and frame info of an audio sector, returns where its packets start
+static uint8_t *read_audio_sector_header(audio_sector_t *audio_sector, uint8_t *read_buffer_ptr)
+{
+    int i;
 
-            memcpy(&handle->audio_sector.header, read_buffer_ptr, AUDIO_SECTOR_HEADER_SIZE);
-            read_buffer_ptr += AUDIO_SECTOR_HEADER_SIZE;
+    memcpy(&audio_sector->header, read_buffer_ptr, AUDIO_SECTOR_HEADER_SIZE);
+    read_buffer_ptr += AUDIO_SECTOR_HEADER_SIZE;
 #if defined(__BIG_ENDIAN__)
-            memcpy(&handle->audio_sector.packet, read_buffer_ptr, AUDIO_PACKET_INFO_SIZE * handle->audio_sector.header.packet_info_count);
-            read_buffer_ptr += AUDIO_PACKET_INFO_SIZE * handle->audio_sector.header.packet_info_count;
+    memcpy(&audio_sector->packet, read_buffer_ptr, AUDIO_PACKET_INFO_SIZE * audio_sector->header.packet_info_count);
+    read_buffer_ptr += AUDIO_PACKET_INFO_SIZE * audio_sector->header.packet_info_count;
 #else
-            // Little Endian systems cannot properly deal with audio_packet_info_t
-            {
-                for (i = 0; i < handle->audio_sector.header.packet_info_count; i++)
-                {
-                    handle->audio_sector.packet[i].frame_start = (read_buffer_ptr[0] >> 7) & 1;
-                    handle->audio_sector.packet[i].data_type = (read_buffer_ptr[0] >> 3) & 7;
-                    handle->audio_sector.packet[i].packet_length = (read_buffer_ptr[0] & 7) << 8 | read_buffer_ptr[1];
-                    read_buffer_ptr += AUDIO_PACKET_INFO_SIZE;
-                }
-            }
+    // Little Endian systems cannot properly deal with audio_packet_info_t
+    {
+        for (i = 0; i < audio_sector->header.packet_info_count; i++)
+        {
+            audio_sector->packet[i].frame_start = (read_buffer_ptr[0] >> 7) & 1;
+            audio_sector->packet[i].data_type = (read_buffer_ptr[0] >> 3) & 7;
+            audio_sector->packet[i].packet_length = (read_buffer_ptr[0] & 7) << 8 | read_buffer_ptr[1];
+            read_buffer_ptr += AUDIO_PACKET_INFO_SIZE;
+        }
+    }
 #endif
-            if (handle->audio_sector.header.dst_encoded)
-            {
-                memcpy(&handle->audio_sector.frame, read_buffer_ptr, AUDIO_FRAME_INFO_SIZE * handle->audio_sector.header.frame_info_count);
-                read_buffer_ptr += AUDIO_FRAME_INFO_SIZE * handle->audio_sector.header.frame_info_count;
-            }
-            else
-            {
-                for (i = 0; i < handle->audio_sector.header.frame_info_count; i++)
-                {
-                    memcpy(&handle->audio_sector.frame[i], read_buffer_ptr, AUDIO_FRAME_INFO_SIZE - 1);
-                    read_buffer_ptr += AUDIO_FRAME_INFO_SIZE - 1;
-                }
-            }
+    if (audio_sector->header.dst_encoded)
+    {
+        memcpy(&audio_sector->frame, read_buffer_ptr, AUDIO_FRAME_INFO_SIZE * audio_sector->header.frame_info_count);
+        read_buffer_ptr += AUDIO_FRAME_INFO_SIZE * audio_sector->header.frame_info_count;
+    }
+    else
+    {
+        for (i = 0; i < audio_sector->header.frame_info_count; i++)
+        {
+            memcpy(&audio_sector->frame[i], read_buffer_ptr, AUDIO_FRAME_INFO_SIZE - 1);
+            read_buffer_ptr += AUDIO_FRAME_INFO_SIZE - 1;
         }
+    }
+    return read_buffer_ptr;
+}
+
+// Walks the audio packets of a run of sectors. Every sector carries its own
+// header, so a run can be walked on its own, only the packets before its first
+// frame start belong to a frame opened earlier. Those go to lead when it is
+// given, else to the open frame. Returns whether a frame start was met.
+static int scan_audio_sectors(audio_sector_t *audio_sector, scarletbook_audio_frame_t *frame, scarletbook_frame_batch_t *batch, 
+                              scarletbook_frame_batch_t *lead, uint8_t *read_buffer, int blocks_read)
+{
+    int i, frame_info_counter, frame_start_seen = 0;
+
+    while(blocks_read--)
+    {
+        uint8_t *read_buffer_ptr = read_audio_sector_header(audio_sector, read_buffer);
 
         frame_info_counter = 0;
-        while (handle->packet_info_idx < handle->audio_sector.header.packet_info_count) 
+        for (i = 0; i < audio_sector->header.packet_info_count; i++)
         {
-            audio_packet_info_t* packet = &handle->audio_sector.packet[handle->packet_info_idx];
+            audio_packet_info_t* packet = &audio_sector->packet[i];
             switch (packet->data_type) 
             {
             case DATA_TYPE_AUDIO:
                 if (packet->frame_start)
                 {
-                    exec_read_callback(handle, frame_read_callback, userdata);
-
-                    handle->frame.size = 0;
-                    handle->frame.dst_encoded = handle->audio_sector.header.dst_encoded;
-                    handle->frame.sector_count = handle->audio_sector.frame[frame_info_counter].sector_count;
-                    handle->frame.channel_count = get_channel_count(&handle->audio_sector.frame[frame_info_counter]);
-                    handle->frame.started = 1;
+                    start_frame(frame, batch, audio_sector, &audio_sector->frame[frame_info_counter]);
+                    frame_start_seen = 1;
 
                     // advance frame_info_counter
                     frame_info_counter++;
                 }
-                if (handle->frame.started)
+                if (lead && !frame_start_seen)
                 {
-                    if (handle->frame.size + packet->packet_length < MAX_DST_SIZE)
+                    scarletbook_frame_segment_t *segment = add_frame_segment(lead);
+                    if (segment)
                     {
-                        memcpy(handle->frame.data + handle->frame.size, read_buffer_ptr, packet->packet_length);
-                        handle->frame.size += packet->packet_length;
-                        if (handle->frame.dst_encoded)
-                        {
-                            handle->frame.sector_count--;
-                        }
-                    }
-                    else
-                    {
-                        // buffer overflow error, try next frame..
-                        handle->frame.started = 0;
+                        segment->data = read_buffer_ptr;
+                        segment->size = packet->packet_length;
                     }
                 }
+                else
+                {
+                    add_frame_packet(frame, batch, read_buffer_ptr, packet->packet_length);
+                }
                 break;
             case DATA_TYPE_SUPPLEMENTARY:
             case DATA_TYPE_PADDING:
@@ -674,15 +767,875 @@ void scarletbook_process_frames(scarletbook_handle_t *handle, uint8_t *read_buff
             }
             // advance the source pointer
             read_buffer_ptr += packet->packet_length;
-
-            handle->packet_info_idx++;
         }
         read_buffer += SACD_LSN_SIZE;
     }
 
+    return frame_start_seen;
+}
+
+#ifndef __lv2ppu__
+static void scan_frame_chunk(scarletbook_frame_chunk_t *chunk)
+{
+    chunk->batch.frame_count = 0;
+    chunk->batch.segment_count = 0;
+    chunk->batch.failed = 0;
+    chunk->lead.segment_count = 0;
+    chunk->lead.failed = 0;
+    chunk->frame.started = 0;
+    chunk->frame.size = 0;
+    chunk->frame.first_segment = 0;
+
+    chunk->frame_start_seen = scan_audio_sectors(&chunk->audio_sector, &chunk->frame, &chunk->batch, &chunk->lead, 
+                                                 chunk->read_buffer, chunk->blocks_read);
+}
+
+// walks its run of every block handed out, until the pool is destroyed
+static void frame_pool_thread(void *arg)
+{
+    scarletbook_frame_chunk_t *chunk = (scarletbook_frame_chunk_t *) arg;
+    scarletbook_frame_pool_t *pool = chunk->pool;
+    long block = 0;
+
+    for (;;)
+    {
+        possess(pool->work);
+        wait_for(pool->work, NOT_TO_BE, block);
+        block = peek_lock(pool->work);
+        release(pool->work);
+        if (block < 0)
+            break;
+
+        // a block may have fewer runs than there are threads
+        if (chunk->blocks_read > 0)
+            scan_frame_chunk(chunk);
+
+        possess(pool->done);
+        twist(pool->done, BY, 1);
+    }
+}
+
+static scarletbook_frame_pool_t *frame_pool_create(int chunk_count)
+{
+    scarletbook_frame_pool_t *pool = (scarletbook_frame_pool_t *) calloc(1, sizeof(scarletbook_frame_pool_t));
+    int i;
+
+    if (!pool)
+        return NULL;
+
+    pool->work = new_lock(0);
+    pool->done = new_lock(0);
+    pool->chunk_count = chunk_count;
+    for (i = 0; i < chunk_count; i++)
+        pool->chunks[i].pool = pool;
+    for (i = 1; i < chunk_count; i++)
+        pool->chunks[i].thread = launch(frame_pool_thread, &pool->chunks[i]);
+
+    return pool;
+}
+
+static void frame_pool_destroy(scarletbook_frame_pool_t *pool)
+{
+    int i;
+
+    possess(pool->work);
+    twist(pool->work, TO, -1);
+    for (i = 1; i < pool->chunk_count; i++)
+        join(pool->chunks[i].thread);
+
+    for (i = 0; i < pool->chunk_count; i++)
+    {
+        free(pool->chunks[i].batch.frames);
+        free(pool->chunks[i].batch.segments);
+        free(pool->chunks[i].lead.segments);
+    }
+    free_lock(pool->done);
+    free_lock(pool->work);
+    free(pool);
+}
+
+// Appends a chunk to the batch as if its sectors had been walked serially: its
+// lead packets continue the open frame, which the chunk's first frame start ends,
+// and the frame the chunk leaves open becomes the open frame.
+static void stitch_frame_chunk(scarletbook_handle_t *handle, scarletbook_frame_chunk_t *chunk)
+{
+    scarletbook_frame_batch_t *batch = &handle->frame_batch;
+    scarletbook_frame_segment_t *segment;
+    scarletbook_frame_desc_t *desc;
+    int i, first_segment;
+
+    if (chunk->batch.failed || chunk->lead.failed)
+    {
+        batch->failed = 1;
+        return;
+    }
+
+    for (i = 0; i < chunk->lead.segment_count; i++)
+    {
+        add_frame_packet(&handle->frame, batch, chunk->lead.segments[i].data, chunk->lead.segments[i].size);
+    }
+
+    if (!chunk->frame_start_seen)
+        return;
+
+    end_frame(&handle->frame, batch);
+
+    first_segment = batch->segment_count;
+    for (i = 0; i < chunk->batch.segment_count; i++)
+    {
+        if (!(segment = add_frame_segment(batch)))
+            return;
+        *segment = chunk->batch.segments[i];
+    }
+    for (i = 0; i < chunk->batch.frame_count; i++)
+    {
+        if (!(desc = add_frame_desc(batch)))
+            return;
+        *desc = chunk->batch.frames[i];
+        desc->first_segment += first_segment;
+    }
+
+    handle->frame.started = chunk->frame.started;
+    handle->frame.size = chunk->frame.size;
+    handle->frame.sector_count = chunk->frame.sector_count;
+    handle->frame.channel_count = chunk->frame.channel_count;
+    handle->frame.dst_encoded = chunk->frame.dst_encoded;
+    handle->frame.first_segment = chunk->frame.first_segment + first_segment;
+}
+
+// splits the sectors into a run per thread of the pool, hands them out, walks
+// the first run and stitches the runs in order once all are walked
+static void scan_audio_sectors_parallel(scarletbook_handle_t *handle, uint8_t *read_buffer, int blocks_read, int chunk_count)
+{
+    scarletbook_frame_pool_t *pool = handle->frame_pool;
+    int i, blocks_per_chunk = (blocks_read + chunk_count - 1) / chunk_count;
+
+    for (i = 0; i < pool->chunk_count; i++)
+    {
+        scarletbook_frame_chunk_t *chunk = &pool->chunks[i];
+
+        chunk->read_buffer = read_buffer + (size_t) i * blocks_per_chunk * SACD_LSN_SIZE;
+        chunk->blocks_read = blocks_read - i * blocks_per_chunk;
+        if (chunk->blocks_read > blocks_per_chunk)
+            chunk->blocks_read = blocks_per_chunk;
+        if (i >= chunk_count || chunk->blocks_read < 0)
+            chunk->blocks_read = 0;
+    }
+
+    possess(pool->done);
+    twist(pool->done, TO, 0);
+    possess(pool->work);
+    twist(pool->work, BY, 1);
+
+    scan_frame_chunk(&pool->chunks[0]);
+
+    possess(pool->done);
+    wait_for(pool->done, TO_BE, pool->chunk_count - 1);
+    release(pool->done);
+
+    for (i = 0; i < chunk_count && !handle->frame_batch.failed; i++)
+    {
+        stitch_frame_chunk(handle, &pool->chunks[i]);
+    }
+    handle->audio_sector = pool->chunks[chunk_count - 1].audio_sector;
+}
+#endif
+
+void scarletbook_frame_set_threads(scarletbook_handle_t *handle, int threads)
+{
+#ifdef __lv2ppu__
+    threads = 1;
+#else
+    if (threads == 0)
+        threads = (int) processor_count();
+#endif
+    if (threads < 1)
+        threads = 1;
+    if (threads > MAX_FRAME_THREADS)
+        threads = MAX_FRAME_THREADS;
+
+#ifndef __lv2ppu__
+    // a pool of another size is launched again when needed
+    if (handle->frame_pool && handle->frame_pool->chunk_count != threads)
+    {
+        frame_pool_destroy(handle->frame_pool);
+        handle->frame_pool = 0;
+    }
+#endif
+    handle->frame_threads = threads;
+}
+
+scarletbook_handle_t *scarletbook_frame_fork(scarletbook_handle_t *handle)
+{
+    scarletbook_handle_t *fork = (scarletbook_handle_t *) malloc(sizeof(scarletbook_handle_t));
+
+    if (!fork)
+        return NULL;
+
+    *fork = *handle;
+    memset(&fork->frame, 0, sizeof(scarletbook_audio_frame_t));
+    memset(&fork->frame_batch, 0, sizeof(scarletbook_frame_batch_t));
+    fork->frame_threads = 1;
+    fork->frame_pool = 0;
+
+    fork->frame.buffer = (uint8_t *) malloc(3 * MAX_DST_SIZE);
+    if (!fork->frame.buffer)
+    {
+        free(fork);
+        return NULL;
+    }
+    fork->frame.data = fork->frame.buffer;
+    fork->frame.spare = fork->frame.buffer + MAX_DST_SIZE;
+    fork->frame.gather = fork->frame.buffer + 2 * MAX_DST_SIZE;
+
+    scarletbook_frame_init(fork);
+
+    return fork;
+}
+
+void scarletbook_frame_fork_close(scarletbook_handle_t *fork)
+{
+    if (!fork)
+        return;
+
+    free(fork->frame_batch.frames);
+    free(fork->frame_batch.segments);
+    free(fork->frame.buffer);
+    free(fork);
+}
+
+// a frame still open at the end of a block is copied out of the read buffer,
+// into the spare buffer as the batch may still point at the current carry
+static void carry_frame(scarletbook_handle_t *handle)
+{
+    scarletbook_audio_frame_t *frame = &handle->frame;
+    scarletbook_frame_batch_t *batch = &handle->frame_batch;
+    uint8_t *carry = frame->spare;
+    uint8_t *ptr = carry;
+    int i;
+
+    for (i = frame->first_segment; i < batch->segment_count; i++)
+    {
+        memcpy(ptr, batch->segments[i].data, batch->segments[i].size);
+        ptr += batch->segments[i].size;
+    }
+    frame->spare = frame->data;
+    frame->data = carry;
+}
+
+uint8_t *scarletbook_frame_data(scarletbook_handle_t *handle, const scarletbook_frame_desc_t *desc)
+{
+    uint8_t *ptr = handle->frame.gather;
+    int i;
+
+    if (desc->data)
+        return desc->data;
+
+    for (i = 0; i < desc->segment_count; i++)
+    {
+        memcpy(ptr, desc->segments[i].data, desc->segments[i].size);
+        ptr += desc->segments[i].size;
+    }
+    return handle->frame.gather;
+}
+
+void scarletbook_process_frames(scarletbook_handle_t *handle, uint8_t *read_buffer, int blocks_read, int last_block, frame_read_callback_t frame_read_callback, void *userdata)
+{
+    scarletbook_frame_batch_t *batch = scarletbook_process_frame_batch(handle, read_buffer, blocks_read, last_block);
+    int i;
+
+    for (i = 0; i < batch->frame_count; i++)
+    {
+        frame_read_callback(handle, scarletbook_frame_data(handle, &batch->frames[i]), batch->frames[i].size, userdata);
+    }
+}
+
+scarletbook_frame_batch_t *scarletbook_process_frame_batch(scarletbook_handle_t *handle, uint8_t *read_buffer, int blocks_read, int last_block)
+{
+    scarletbook_frame_batch_t *batch = &handle->frame_batch;
+    int i, chunk_count;
+
+    batch->frame_count = 0;
+    batch->segment_count = 0;
+    batch->failed = 0;
+
+    // the head of a frame begun in the previous block
+    handle->frame.first_segment = 0;
+    if (handle->frame.started && handle->frame.size > 0)
+    {
+        scarletbook_frame_segment_t *segment = add_frame_segment(batch);
+        if (segment)
+        {
+            segment->data = handle->frame.data;
+            segment->size = handle->frame.size;
+        }
+    }
+
+    chunk_count = blocks_read / MIN_FRAME_CHUNK_SIZE;
+    if (chunk_count > handle->frame_threads)
+        chunk_count = handle->frame_threads;
+
+#ifndef __lv2ppu__
+    if (chunk_count > 1 && !handle->frame_pool)
+        handle->frame_pool = frame_pool_create(handle->frame_threads);
+
+    if (chunk_count > 1 && handle->frame_pool && !batch->failed)
+        scan_audio_sectors_parallel(handle, read_buffer, blocks_read, chunk_count);
+    else
+#endif
+    if (!batch->failed)
+        scan_audio_sectors(&handle->audio_sector, &handle->frame, batch, 0, read_buffer, blocks_read);
+
     if (last_block) 
     {
-        exec_read_callback(handle, frame_read_callback, userdata);
+        end_frame(&handle->frame, batch);
+    }
+
+    // out of memory the frames of the block are dropped, the next frame start picks up again
+    if (batch->failed)
+    {
+        batch->frame_count = 0;
+        handle->frame.started = 0;
+    }
+
+    if (handle->frame.started)
+    {
+        carry_frame(handle);
+    }
+
+    for (i = 0; i < batch->frame_count; i++)
+    {
+        batch->frames[i].segments = batch->segments + batch->frames[i].first_segment;
+    }
+
+    return batch;
+}
+
+// reads and decrypts a block of audio sectors of an area, non_encrypted_disc
+// starts out at -1 and is settled by the first block read
+static uint32_t read_audio_block(scarletbook_handle_t *handle, int area, uint32_t lsn, uint32_t block_size, uint8_t *read_buffer, int *non_encrypted_disc)
+{
+    block_size = (uint32_t) sacd_read_block_raw((sacd_reader_t *) handle->sacd, lsn, block_size, read_buffer);
+    if (block_size == 0)
+        return 0;
+
+    // the same check for non-encrypted DSD 3 in 14/16 discs as when ripping
+    if (*non_encrypted_disc < 0)
+    {
+        *non_encrypted_disc = 0;
+        switch (handle->area[area].area_toc->frame_format)
+        {
+        case FRAME_FORMAT_DSD_3_IN_14:
+        case FRAME_FORMAT_DSD_3_IN_16:
+            *non_encrypted_disc = *(uint64_t *)(read_buffer + 16) == 0;
+            break;
+        }
     }
+    if (!*non_encrypted_disc)
+        sacd_decrypt((sacd_reader_t *) handle->sacd, read_buffer, block_size);
+
+    return block_size;
+}
+
+#define FRAME_INDEX_MAGIC      MAKE_MARKER('S', 'B', 'F', 'I')
+#define FRAME_INDEX_VERSION    1
+#define FRAME_INDEX_MAX_STARTS 7                // frames starting in a sector, frame_info_count has 3 bits
+
+static scarletbook_frame_index_t *frame_index_alloc(int area, uint32_t start_lsn, uint32_t end_lsn, uint32_t frames_allocated)
+{
+    scarletbook_frame_index_t *index = (scarletbook_frame_index_t *) calloc(1, sizeof(scarletbook_frame_index_t));
+    if (!index)
+        return NULL;
+
+    index->area = area;
+    index->start_lsn = start_lsn;
+    index->end_lsn = end_lsn;
+    index->entries = (scarletbook_frame_index_entry_t *) malloc(frames_allocated * sizeof(scarletbook_frame_index_entry_t));
+    index->bases = (scarletbook_frame_index_base_t *) malloc((frames_allocated / FRAME_INDEX_INTERVAL + 1) * sizeof(scarletbook_frame_index_base_t));
+    if (!index->entries || !index->bases)
+    {
+        scarletbook_frame_index_destroy(index);
+        return NULL;
+    }
+    return index;
+}
+
+// doubles the entries (and bases) an index can take
+static int frame_index_grow(scarletbook_frame_index_t *index, uint32_t *frames_allocated)
+{
+    scarletbook_frame_index_entry_t *entries;
+    scarletbook_frame_index_base_t *bases;
+    uint32_t count = *frames_allocated * 2;
+
+    entries = (scarletbook_frame_index_entry_t *) realloc(index->entries, count * sizeof(scarletbook_frame_index_entry_t));
+    if (!entries)
+        return 0;
+    index->entries = entries;
+
+    bases = (scarletbook_frame_index_base_t *) realloc(index->bases, (count / FRAME_INDEX_INTERVAL + 1) * sizeof(scarletbook_frame_index_base_t));
+    if (!bases)
+        return 0;
+    index->bases = bases;
+
+    *frames_allocated = count;
+    return 1;
+}
+
+scarletbook_frame_index_t *scarletbook_frame_index_create(scarletbook_handle_t *handle, int area)
+{
+    scarletbook_frame_index_t *index;
+    scarletbook_frame_index_entry_t *entry = 0;
+    audio_sector_t audio_sector;
+    uint8_t *read_buffer;
+    uint32_t lsn, prev_lsn = 0, frames_allocated, block_size;
+    uint32_t start_lsn = handle->area[area].area_toc->track_start;
+    uint32_t end_lsn = handle->area[area].area_toc->track_end + 1;
+    int non_encrypted_disc = -1;
+    uint32_t i;
+    int j;
+
+    // a frame takes about a sector, short DST frames (e.g. of silence) share one
+    frames_allocated = end_lsn - start_lsn;
+    index = frame_index_alloc(area, start_lsn, end_lsn, frames_allocated);
+    read_buffer = (uint8_t *) malloc(MAX_PROCESSING_BLOCK_SIZE * SACD_LSN_SIZE);
+    if (!index || !read_buffer)
+    {
+        free(read_buffer);
+        scarletbook_frame_index_destroy(index);
+        return NULL;
+    }
+
+    for (lsn = start_lsn; lsn < end_lsn; lsn += block_size)
+    {
+        block_size = end_lsn - lsn < MAX_PROCESSING_BLOCK_SIZE ? end_lsn - lsn : MAX_PROCESSING_BLOCK_SIZE;
+        block_size = read_audio_block(handle, area, lsn, block_size, read_buffer, &non_encrypted_disc);
+        if (block_size == 0)
+        {
+            free(read_buffer);
+            scarletbook_frame_index_destroy(index);
+            return NULL;
+        }
+
+        // only the headers are looked at, the packets are skipped
+        for (i = 0; i < block_size; i++)
+        {
+            uint8_t *sector = read_buffer + i * SACD_LSN_SIZE;
+            uint8_t *ptr = read_audio_sector_header(&audio_sector, sector);
+
+            for (j = 0; j < audio_sector.header.packet_info_count; j++)
+            {
+                audio_packet_info_t *packet = &audio_sector.packet[j];
+
+                if (packet->data_type == DATA_TYPE_AUDIO)
+                {
+                    if (packet->frame_start)
+                    {
+                        if (entry)
+                            index->total_size += entry->size;
+
+                        if (index->frame_count == frames_allocated && !frame_index_grow(index, &frames_allocated))
+                        {
+                            free(read_buffer);
+                            scarletbook_frame_index_destroy(index);
+                            return NULL;
+                        }
+
+                        if (index->frame_count % FRAME_INDEX_INTERVAL == 0)
+                        {
+                            index->bases[index->frame_count / FRAME_INDEX_INTERVAL].lsn = lsn + i;
+                            index->bases[index->frame_count / FRAME_INDEX_INTERVAL].position = index->total_size;
+                            prev_lsn = lsn + i;
+                        }
+
+                        entry = &index->entries[index->frame_count++];
+                        entry->lsn_delta = (uint16_t) (lsn + i - prev_lsn);
+                        entry->offset = (uint16_t) (ptr - sector);
+                        entry->size = 0;
+                        prev_lsn = lsn + i;
+                    }
+                    if (entry)
+                        entry->size = entry->size + packet->packet_length > 0xffff ? 0xffff : entry->size + packet->packet_length;
+                }
+                ptr += packet->packet_length;
+            }
+        }
+    }
+    if (entry)
+        index->total_size += entry->size;
+
+    free(read_buffer);
+
+    // give back what the frames didn't take
+    if (index->frame_count > 0)
+    {
+        scarletbook_frame_index_entry_t *entries;
+
+        // when that fails the entries as grown still hold every frame
+        entries = (scarletbook_frame_index_entry_t *) realloc(index->entries, index->frame_count * sizeof(scarletbook_frame_index_entry_t));
+        if (entries)
+            index->entries = entries;
+    }
+
+    return index;
+}
+
+void scarletbook_frame_index_destroy(scarletbook_frame_index_t *index)
+{
+    if (!index)
+        return;
+    free(index->entries);
+    free(index->bases);
+    free(index);
+}
+
+int scarletbook_frame_index_lookup(const scarletbook_frame_index_t *index, uint32_t frame, uint32_t *lsn, uint16_t *offset, uint16_t *size, uint64_t *position)
+{
+    const scarletbook_frame_index_base_t *base;
+    uint32_t i, first;
+    uint32_t frame_lsn;
+    uint64_t frame_position;
 
+    if (frame >= index->frame_count)
+        return 0;
+
+    // walk the deltas from the last absolute entry
+    first = frame - frame % FRAME_INDEX_INTERVAL;
+    base = &index->bases[frame / FRAME_INDEX_INTERVAL];
+    frame_lsn = base->lsn;
+    frame_position = base->position;
+    for (i = first + 1; i <= frame; i++)
+    {
+        frame_lsn += index->entries[i].lsn_delta;
+        frame_position += index->entries[i - 1].size;
+    }
+
+    if (lsn)
+        *lsn = frame_lsn;
+    if (offset)
+        *offset = index->entries[frame].offset;
+    if (size)
+        *size = index->entries[frame].size;
+    if (position)
+        *position = frame_position;
+    return 1;
+}
+
+int scarletbook_frame_index_save(const scarletbook_frame_index_t *index, FILE *fd)
+{
+    uint32_t header[6];
+    size_t base_count = (index->frame_count + FRAME_INDEX_INTERVAL - 1) / FRAME_INDEX_INTERVAL;
+
+    header[0] = FRAME_INDEX_MAGIC;
+    header[1] = FRAME_INDEX_VERSION;
+    header[2] = (uint32_t) index->area;
+    header[3] = index->start_lsn;
+    header[4] = index->end_lsn;
+    header[5] = index->frame_count;
+
+    if (fwrite(header, sizeof(header), 1, fd) != 1 ||
+        fwrite(&index->total_size, sizeof(index->total_size), 1, fd) != 1 ||
+        fwrite(index->entries, sizeof(scarletbook_frame_index_entry_t), index->frame_count, fd) != index->frame_count ||
+        fwrite(index->bases, sizeof(scarletbook_frame_index_base_t), base_count, fd) != base_count)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+scarletbook_frame_index_t *scarletbook_frame_index_load(scarletbook_handle_t *handle, int area, FILE *fd)
+{
+    scarletbook_frame_index_t *index;
+    uint32_t header[6];
+    size_t base_count;
+
+    if (fread(header, sizeof(header), 1, fd) != 1)
+        return NULL;
+
+    // a stale cache, or one of another disc or area, is not used
+    if (header[0] != FRAME_INDEX_MAGIC || header[1] != FRAME_INDEX_VERSION || header[2] != (uint32_t) area ||
+        header[3] != handle->area[area].area_toc->track_start || header[4] != handle->area[area].area_toc->track_end + 1 ||
+        (uint64_t) header[5] > (uint64_t) (header[4] - header[3]) * FRAME_INDEX_MAX_STARTS)
+    {
+        return NULL;
+    }
+
+    index = frame_index_alloc(area, header[3], header[4], header[5] > 0 ? header[5] : 1);
+    if (!index)
+        return NULL;
+
+    index->frame_count = header[5];
+    base_count = (index->frame_count + FRAME_INDEX_INTERVAL - 1) / FRAME_INDEX_INTERVAL;
+    if (fread(&index->total_size, sizeof(index->total_size), 1, fd) != 1 ||
+        fread(index->entries, sizeof(scarletbook_frame_index_entry_t), index->frame_count, fd) != index->frame_count ||
+        fread(index->bases, sizeof(scarletbook_frame_index_base_t), base_count, fd) != base_count)
+    {
+        scarletbook_frame_index_destroy(index);
+        return NULL;
+    }
+    return index;
+}
+
+uint32_t scarletbook_time_to_lsn(scarletbook_handle_t *handle, int area, uint32_t frame)
+{
+    area_toc_t *area_toc = handle->area[area].area_toc;
+    area_access_list_t *access_list = handle->area[area].area_access_list;
+    uint32_t lower_lsn = area_toc->track_start, upper_lsn = area_toc->track_end + 1;
+    uint32_t lower_frame = 0, upper_frame = TIME_FRAMECOUNT(&area_toc->total_playtime);
+    uint32_t lsn;
+
+    // narrow down to the steps of the access list around the frame
+    if (access_list)
+    {
+        uint32_t i = frame / access_list->main_step_size;
+
+        if (i >= access_list->entry_count)
+            i = access_list->entry_count - 1;
+
+        lower_lsn = access_list_lsn(access_list, i);
+        lower_frame = i * access_list->main_step_size;
+        if (i + 1 < access_list->entry_count)
+        {
+            upper_lsn = access_list_lsn(access_list, i + 1);
+            upper_frame = (i + 1) * access_list->main_step_size;
+        }
+    }
+
+    // and interpolate in between
+    if (frame <= lower_frame || upper_frame <= lower_frame)
+        lsn = lower_lsn;
+    else if (frame >= upper_frame)
+        lsn = upper_lsn;
+    else
+        lsn = lower_lsn + (uint32_t) ((uint64_t) (upper_lsn - lower_lsn) * (frame - lower_frame) / (upper_frame - lower_frame));
+
+    if (lsn > area_toc->track_end)
+        lsn = area_toc->track_end;
+
+    return lsn;
+}
+
+#define SEEK_WINDOW_SIZE       32
+#define SEEK_BACK_OFF          8
+#define SEEK_MAX_WINDOWS       16
+
+int scarletbook_seek_frame(scarletbook_handle_t *handle, int area, uint32_t frame, uint32_t *lsn)
+{
+    audio_sector_t audio_sector;
+    uint8_t *read_buffer;
+    uint32_t start_lsn = handle->area[area].area_toc->track_start;
+    uint32_t end_lsn = handle->area[area].area_toc->track_end + 1;
+    uint32_t window_lsn, block_size, timecode;
+    int non_encrypted_disc = -1, direction = 0, found_before, found_after;
+    int tries, i, j, found = 0;
+
+    *lsn = scarletbook_time_to_lsn(handle, area, frame);
+
+    read_buffer = (uint8_t *) malloc(SEEK_WINDOW_SIZE * SACD_LSN_SIZE);
+    if (!read_buffer)
+        return 0;
+
+    window_lsn = *lsn - start_lsn > SEEK_BACK_OFF ? *lsn - SEEK_BACK_OFF : start_lsn;
+    for (tries = 0; tries < SEEK_MAX_WINDOWS && window_lsn < end_lsn; tries++)
+    {
+        block_size = end_lsn - window_lsn < SEEK_WINDOW_SIZE ? end_lsn - window_lsn : SEEK_WINDOW_SIZE;
+        block_size = read_audio_block(handle, area, window_lsn, block_size, read_buffer, &non_encrypted_disc);
+        if (block_size == 0)
+            break;
+
+        // every frame that starts in a sector has its timecode in the sector header
+        found_before = found_after = 0;
+        for (i = 0; i < (int) block_size; i++)
+        {
+            read_audio_sector_header(&audio_sector, read_buffer + i * SACD_LSN_SIZE);
+            for (j = 0; j < audio_sector.header.frame_info_count; j++)
+            {
+                timecode = TIME_FRAMECOUNT(&audio_sector.frame[j].timecode);
+                if (timecode == frame)
+                {
+                    *lsn = window_lsn + i;
+                    found = 1;
+                }
+                if (timecode < frame)
+                    found_before = 1;
+                else
+                    found_after = 1;
+            }
+        }
+
+        // a frame missing between two neighbours won't turn up elsewhere
+        if (found || (found_before && found_after))
+            break;
+
+        if (found_after)
+        {
+            if (direction > 0 || window_lsn == start_lsn)
+                break;
+            direction = -1;
+            window_lsn = window_lsn - start_lsn > SEEK_WINDOW_SIZE ? window_lsn - SEEK_WINDOW_SIZE : start_lsn;
+        }
+        else
+        {
+            if (direction < 0)
+                break;
+            direction = 1;
+            window_lsn += block_size;
+        }
+    }
+    free(read_buffer);
+    return found;
+}
+
+// the text of a track of one type in a SACDTTxt block of size bytes, which ends in a 0
+static const char *probe_track_text(uint8_t *text_block, size_t size, int track, uint8_t track_type)
+{
+    char *track_ptr, *end = (char *) text_block + size;
+    uint16_t position;
+    int j, track_amount;
+
+    if (offsetof(area_text_t, track_text_position) + (track + 1) * sizeof(uint16_t) > size)
+        return 0;
+
+    position = ((area_text_t *) text_block)->track_text_position[track];
+    SWAP16(position);
+    if (position == 0 || (size_t) position + 4 >= size)
+        return 0;
+
+    track_ptr = (char *) text_block + position;
+    track_amount = *track_ptr;
+    track_ptr += 4;
+    for (j = 0; j < track_amount && track_ptr + 2 < end; j++)
+    {
+        if ((uint8_t) *track_ptr == track_type)
+            return track_ptr[2] != 0 ? track_ptr + 2 : 0;
+
+        track_ptr += 2;                             // type and the unknown 0x20
+        while (track_ptr < end && *track_ptr != 0)
+            track_ptr++;
+        while (track_ptr < end && *track_ptr == 0)
+            track_ptr++;
+    }
+    return 0;
+}
+
+int scarletbook_probe(sacd_reader_t *sacd, scarletbook_probe_t *probe, uint8_t *buffer, size_t buffer_size)
+{
+    master_toc_t *master_toc;
+    master_sacd_text_t *master_text;
+    area_toc_t *area_toc;
+    scarletbook_probe_area_t *probe_area;
+    uint8_t *p, *end = buffer + buffer_size / SACD_LSN_SIZE * SACD_LSN_SIZE;
+    uint32_t area_start, text_end, text_size;
+    uint16_t area_size;
+    int i, track;
+
+    memset(probe, 0, sizeof(scarletbook_probe_t));
+    probe->twoch_area_idx = -1;
+    probe->mulch_area_idx = -1;
+
+    // the master TOC and the first master text
+    if (end - buffer < 2 * SACD_LSN_SIZE || sacd_read_block_raw(sacd, START_OF_MASTER_TOC, 2, buffer) != 2)
+        return 0;
+
+    master_toc = (master_toc_t *) buffer;
+    if (strncmp("SACDMTOC", master_toc->id, 8) != 0 ||
+        master_toc->version.major > SUPPORTED_VERSION_MAJOR || master_toc->version.minor > SUPPORTED_VERSION_MINOR)
+        return 0;
+
+    SWAP32(master_toc->area_1_toc_1_start);
+    SWAP16(master_toc->area_1_toc_size);
+    SWAP32(master_toc->area_2_toc_1_start);
+    SWAP16(master_toc->area_2_toc_size);
+
+    probe->charset = character_set[master_toc->locales[0].character_set & 0x07];
+    master_text = (master_sacd_text_t *) (buffer + SACD_LSN_SIZE);
+    if (strncmp("SACDText", master_text->id, 8) == 0)
+    {
+        buffer[2 * SACD_LSN_SIZE - 1] = 0;
+        SWAP16(master_text->album_title_position);
+        SWAP16(master_text->album_artist_position);
+        if (master_text->album_title_position && master_text->album_title_position < SACD_LSN_SIZE)
+            probe->album_title = (char *) master_text + master_text->album_title_position;
+        if (master_text->album_artist_position && master_text->album_artist_position < SACD_LSN_SIZE)
+            probe->album_artist = (char *) master_text + master_text->album_artist_position;
+    }
+    p = buffer + 2 * SACD_LSN_SIZE;
+
+    for (i = 0; i < 2; i++)
+    {
+        area_start = i == 0 ? master_toc->area_1_toc_1_start : master_toc->area_2_toc_1_start;
+        area_size = i == 0 ? master_toc->area_1_toc_size : master_toc->area_2_toc_size;
+        if (!area_start || end - p < SACD_LSN_SIZE || sacd_read_block_raw(sacd, area_start, 1, p) != 1)
+            continue;
+
+        area_toc = (area_toc_t *) p;
+        if ((strncmp("TWOCHTOC", area_toc->id, 8) != 0 && strncmp("MULCHTOC", area_toc->id, 8) != 0) ||
+            area_toc->version.major > SUPPORTED_VERSION_MAJOR || area_toc->version.minor > SUPPORTED_VERSION_MINOR)
+            continue;
+
+        SWAP16(area_toc->track_text_offset);
+        SWAP16(area_toc->index_list_offset);
+        SWAP16(area_toc->access_list_offset);
+        p += SACD_LSN_SIZE;
+
+        probe_area = &probe->area[probe->area_count];
+        probe_area->channel_count = area_toc->channel_count;
+        probe_area->track_count = area_toc->track_count;
+        probe_area->frame_format = area_toc->frame_format;
+        probe_area->total_frames = TIME_FRAMECOUNT(&area_toc->total_playtime);
+        probe_area->charset = character_set[area_toc->languages[0].character_set & 0x07];
+
+        if (area_toc->channel_count == 2 && area_toc->loudspeaker_config == 0)
+            probe->twoch_area_idx = probe->area_count;
+        else
+            probe->mulch_area_idx = probe->area_count;
+        probe->area_count++;
+
+        // the track text runs up to the next list of the area TOC
+        if (area_toc->track_text_offset == 0 || area_toc->track_text_offset >= area_size)
+            continue;
+
+        text_end = area_size;
+        if (area_toc->index_list_offset > area_toc->track_text_offset && area_toc->index_list_offset < text_end)
+            text_end = area_toc->index_list_offset;
+        if (area_toc->access_list_offset > area_toc->track_text_offset && area_toc->access_list_offset < text_end)
+            text_end = area_toc->access_list_offset;
+
+        text_size = text_end - area_toc->track_text_offset;
+        if (text_size > (uint32_t) ((end - p) / SACD_LSN_SIZE))
+            text_size = (uint32_t) ((end - p) / SACD_LSN_SIZE);
+
+        if (text_size == 0 || sacd_read_block_raw(sacd, area_start + area_toc->track_text_offset, text_size, p) != text_size ||
+            strncmp("SACDTTxt", (char *) p, 8) != 0)
+            continue;
+
+        text_size *= SACD_LSN_SIZE;
+        p[text_size - 1] = 0;
+        for (track = 0; track < probe_area->track_count; track++)
+        {
+            probe_area->track_title[track] = probe_track_text(p, text_size, track, TRACK_TYPE_TITLE);
+        }
+        p += text_size;
+    }
+
+    return probe->area_count > 0;
+}
+
+char *scarletbook_track_text(scarletbook_handle_t *handle, int area, int track, track_type_t track_type)
+{
+    scarletbook_area_t *sb_area = &handle->area[area];
+    area_track_text_t *track_text;
+    int index = track_text_index((uint8_t) track_type);
+    char *raw;
+
+    if (index < 0 || track < 0 || track >= sb_area->area_toc->track_count)
+        return 0;
+
+    track_text = &sb_area->area_track_text[track];
+    if (!track_text->text[index] && track_text->offset[index])
+    {
+        // only the first text channel is read, see scarletbook_read_area_toc
+        raw = (char *) sb_area->area_data + track_text->offset[index];
+        track_text->text[index] = scarletbook_text(handle, raw, character_set[sb_area->area_toc->languages[0].character_set & 0x07]);
+    }
+    return track_text->text[index];
 }
@@ -22,6 +22,8 @@
 #ifndef SCARLETBOOK_READ_H_INCLUDED
 #define SCARLETBOOK_READ_H_INCLUDED
 
+#include <stdio.h>
+
 #include "scarletbook.h"
 #include "sacd_reader.h"
 
@@ -37,6 +39,13 @@ extern "C" {
  */
 scarletbook_handle_t *scarletbook_open(sacd_reader_t *, int);
 
+/**
+ * reads only the master TOC and the first sector and track text of each area into
+ * buffer, of at least SCARLETBOOK_PROBE_BUFFER_SIZE bytes, and fills in probe. Its
+ * text points into buffer, as on disc. Returns 0 when it is no ScarletBook disc.
+ */
+int scarletbook_probe(sacd_reader_t *, scarletbook_probe_t *, uint8_t *buffer, size_t buffer_size);
+
 /**
  * initialize scarletbook audio frames structs
  */
@@ -52,6 +61,72 @@ typedef void (*frame_read_callback_t)(scarletbook_handle_t *handle, uint8_t* fra
  */
 void scarletbook_process_frames(scarletbook_handle_t *, uint8_t *, int, int, frame_read_callback_t, void *);
 
+/**
+ * processes scarletbook audio frames and returns the frames completed in this block,
+ * the batch stays valid until the next call or until the read buffer is reused
+ */
+scarletbook_frame_batch_t *scarletbook_process_frame_batch(scarletbook_handle_t *, uint8_t *, int, int);
+
+/**
+ * walks the sectors of a block in runs on up to threads threads, 0 takes one per
+ * processor, the frames come out as they would from a serial walk. The threads
+ * are launched with the first block large enough and kept until the handle is
+ * closed.
+ */
+void scarletbook_frame_set_threads(scarletbook_handle_t *, int threads);
+
+/**
+ * returns a handle sharing the disc and its TOCs with the given one but with a
+ * frame state of its own, so that another thread can walk the frames of another
+ * track, close it with scarletbook_frame_fork_close()
+ */
+scarletbook_handle_t *scarletbook_frame_fork(scarletbook_handle_t *);
+void scarletbook_frame_fork_close(scarletbook_handle_t *);
+
+/**
+ * builds the frame index of an area from the headers of its audio sectors
+ */
+scarletbook_frame_index_t *scarletbook_frame_index_create(scarletbook_handle_t *, int area);
+void scarletbook_frame_index_destroy(scarletbook_frame_index_t *);
+
+/**
+ * finds the sector, offset and size of a frame, and the sum of the sizes of the frames
+ * before it. Returns 0 when the frame is not in the index.
+ */
+int scarletbook_frame_index_lookup(const scarletbook_frame_index_t *, uint32_t frame, uint32_t *lsn, uint16_t *offset, uint16_t *size, uint64_t *position);
+
+/**
+ * caches a frame index next to the disc metadata, loading checks it belongs to the area
+ */
+int scarletbook_frame_index_save(const scarletbook_frame_index_t *, FILE *);
+scarletbook_frame_index_t *scarletbook_frame_index_load(scarletbook_handle_t *, int area, FILE *);
+
+/**
+ * returns the text of a track in UTF-8, or 0 when the disc has none of that type.
+ * It is converted on first use and belongs to the handle.
+ */
+char *scarletbook_track_text(scarletbook_handle_t *, int area, int track, track_type_t);
+
+/**
+ * returns the sector at or just before the start of a frame, counted from the start
+ * of the area, from the access list of the disc. Without one it interpolates over
+ * the area. No sectors are read.
+ */
+uint32_t scarletbook_time_to_lsn(scarletbook_handle_t *, int area, uint32_t frame);
+
+/**
+ * finds the sector a frame starts in by reading a few sectors around the one given by
+ * scarletbook_time_to_lsn. Returns 0 and leaves that estimate in lsn when the frame
+ * doesn't turn up.
+ */
+int scarletbook_seek_frame(scarletbook_handle_t *, int area, uint32_t frame, uint32_t *lsn);
+
+/**
+ * returns the bytes of a frame from a batch, flattened into a scratch buffer
+ * of the handle unless it is a single segment
+ */
+uint8_t *scarletbook_frame_data(scarletbook_handle_t *, const scarletbook_frame_desc_t *);
+
 /**
  * scarletbook_close(ifofile);
  * Cleans up the scarletbook information. This will free all data allocated for the
@@ -0,0 +1,182 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/**
+ * Round trips DSD frames through the DST encoder and the DST decoder, for
+ * 2, 5 and 6 channels at 64, 128 and 256 fs and the lowest, default and
+ * highest effort. Every run encodes tone frames and then frames of DSD
+ * silence on the encode threads, and decodes each frame as the callback
+ * gets it:
+ *
+ *   dst_roundtrip [frames of each signal, default 4]
+ *
+ * Exits with 1 when a decoded frame differs from the frame encoded.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "dst_encoder.h"
+#include "dst_init.h"
+#include "dst_fram.h"
+#include "logging.h"
+
+#ifndef M_PI
+#define M_PI    3.14159265358979323846
+#endif
+
+#define DSD_SILENCE             0x69
+
+typedef struct
+{
+    int                 channel_count;
+    int                 sample_rate;
+    size_t              frame_size;         // bytes of a DSD frame
+    int                 frame_count;
+    uint8_t            *frames;             // the DSD frames encoded
+    uint8_t            *decoded;
+    ebunch             *decoder;
+
+    int                 frames_checked;
+    int                 mismatches;
+    size_t              encoded_size;
+}
+roundtrip_t;
+
+// a sine per channel run through a second order delta-sigma modulator
+static void generate_tone(uint8_t *frame, int channel_count, size_t frame_size, int sample_rate, long *position, double *integrator)
+{
+    size_t bits = frame_size / channel_count * 8, n;
+    int c;
+
+    memset(frame, 0, frame_size);
+    for (n = 0; n < bits; n++, (*position)++)
+    {
+        for (c = 0; c < channel_count; c++)
+        {
+            double x = 0.5 * sin(2 * M_PI * (500.0 + 250.0 * c) * (double) *position / (44100.0 * sample_rate));
+            double *s = &integrator[2 * c];
+            int bit = s[1] >= 0;
+            double q = bit ? 1.0 : -1.0;
+
+            s[0] += x - q;
+            s[1] += s[0] - q;
+            frame[(n / 8) * channel_count + c] |= (uint8_t) (bit << (7 - n % 8));
+        }
+    }
+}
+
+static void frame_encoded(uint8_t *frame_data, size_t frame_size, void *userdata)
+{
+    roundtrip_t *roundtrip = (roundtrip_t *) userdata;
+    int frame_nr = roundtrip->frames_checked++;
+
+    roundtrip->encoded_size += frame_size;
+    if (frame_nr >= roundtrip->frame_count ||
+        DST_FramDSTDecode(frame_data, roundtrip->decoded, (int) frame_size, frame_nr, roundtrip->decoder) != 0 ||
+        memcmp(roundtrip->decoded, roundtrip->frames + frame_nr * roundtrip->frame_size, roundtrip->frame_size) != 0)
+    {
+        fprintf(stderr, "%d channels at %dfs: frame %d doesn't decode to the frame encoded\n",
+                roundtrip->channel_count, roundtrip->sample_rate, frame_nr);
+        roundtrip->mismatches++;
+    }
+}
+
+static int run(int channel_count, int sample_rate, int effort, int frames_per_signal)
+{
+    roundtrip_t roundtrip;
+    dst_encoder_t *encoder;
+    double integrator[2 * 6];
+    long position = 0;
+    int i, ok;
+
+    memset(&roundtrip, 0, sizeof(roundtrip_t));
+    memset(integrator, 0, sizeof(integrator));
+    roundtrip.channel_count = channel_count;
+    roundtrip.sample_rate = sample_rate;
+    roundtrip.frame_size = DST_ENCODER_MAX_FRAME_SIZE(channel_count, sample_rate) - 1;
+    roundtrip.frame_count = 2 * frames_per_signal;
+    roundtrip.frames = (uint8_t *) malloc(roundtrip.frame_count * roundtrip.frame_size);
+    roundtrip.decoded = (uint8_t *) malloc(roundtrip.frame_size);
+    roundtrip.decoder = (ebunch *) malloc(sizeof(ebunch));
+    if (!roundtrip.frames || !roundtrip.decoded || !roundtrip.decoder ||
+        DST_InitDecoder(roundtrip.decoder, channel_count, sample_rate) != 0)
+    {
+        fprintf(stderr, "dst_roundtrip: can't set up a decoder\n");
+        return 0;
+    }
+
+    // the tone, then silence
+    for (i = 0; i < frames_per_signal; i++)
+        generate_tone(roundtrip.frames + i * roundtrip.frame_size, channel_count, roundtrip.frame_size, sample_rate, &position, integrator);
+    memset(roundtrip.frames + frames_per_signal * roundtrip.frame_size, DSD_SILENCE, frames_per_signal * roundtrip.frame_size);
+
+    encoder = dst_encoder_create(channel_count, sample_rate, effort, 0, frame_encoded, &roundtrip);
+    if (!encoder)
+    {
+        fprintf(stderr, "dst_roundtrip: can't set up an encoder\n");
+        return 0;
+    }
+    for (i = 0; i < roundtrip.frame_count; i++)
+        dst_encoder_encode(encoder, roundtrip.frames + i * roundtrip.frame_size, roundtrip.frame_size);
+    dst_encoder_flush(encoder);
+    dst_encoder_destroy(encoder);
+
+    ok = roundtrip.mismatches == 0 && roundtrip.frames_checked == roundtrip.frame_count;
+    printf("%d channels at %3dfs, effort %d: %d of %d frames decoded as encoded, %.1f%% of the DSD size\n",
+           channel_count, sample_rate, effort, roundtrip.frames_checked - roundtrip.mismatches, roundtrip.frame_count,
+           100.0 * roundtrip.encoded_size / (roundtrip.frame_count * roundtrip.frame_size));
+
+    DST_CloseDecoder(roundtrip.decoder);
+    free(roundtrip.decoder);
+    free(roundtrip.decoded);
+    free(roundtrip.frames);
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    static const int channel_counts[] = { 2, 5, 6 };
+    static const int sample_rates[] = { 64, 128, 256 };
+    static const int efforts[] = { DST_ENCODER_MIN_EFFORT, DST_ENCODER_DEFAULT_EFFORT, DST_ENCODER_MAX_EFFORT };
+    int frames_per_signal = argc > 1 ? atoi(argv[1]) : 4;
+    int c, r, e, ok = 1;
+
+    if (argc > 2 || frames_per_signal < 1)
+    {
+        fprintf(stderr, "usage: dst_roundtrip [frames of each signal]\n");
+        return 1;
+    }
+
+    // the DST encoder logs through the library
+    init_logging();
+
+    for (c = 0; c < 3; c++)
+        for (r = 0; r < 3; r++)
+            for (e = 0; e < 3; e++)
+                ok &= run(channel_counts[c], sample_rates[r], efforts[e], frames_per_signal);
+
+    destroy_logging();
+
+    return ok ? 0 : 1;
+}
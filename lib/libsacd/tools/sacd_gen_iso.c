@@ -0,0 +1,855 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/**
+ * Writes a synthetic, unencrypted SACD image, laid out the way
+ * scarletbook_read.c reads a disc:
+ *
+ *   LSN 510   Master TOC, text and manufacturer sectors, copied at 520 and 530
+ *   LSN 540   per area: Area TOC-1 (TOC, SACDTRL1, SACDTRL2, SACD_IGL,
+ *             SACD_ACC, SACDTTxt), the audio sectors, Area TOC-2
+ *
+ * Every track starts on a sector of its own. Audio is a test tone per
+ * channel, or DSD silence, either as plain DSD frames or as DST frames.
+ * DST frames are stored uncoded (DSTCoded = 0), which every DST decoder
+ * takes, or coded by the DST encoder at the effort given.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "scarletbook.h"
+#include "endianess.h"
+#include "dst_encoder.h"
+#include "logging.h"
+
+#ifndef M_PI
+#define M_PI    3.14159265358979323846
+#endif
+
+#define MAX_AREA_COUNT          2
+#define AREA_TOC_LISTS_SIZE     37          // TOC, SACDTRL1, SACDTRL2, SACD_IGL (2) and SACD_ACC (32)
+#define SECTOR_WINDOW           40          // sectors held back until the sector counts of their frames are known
+#define MAX_SECTOR_COUNT        31          // of a DST frame, 5 bits in the frame info
+#define MAX_ACCESS_LIST_COUNT   6550
+#define DSD_SILENCE             0x69
+
+typedef struct
+{
+    int                 channel_count;
+    int                 dst_encoded;
+}
+area_config_t;
+
+typedef struct
+{
+    area_config_t       area[MAX_AREA_COUNT];
+    int                 area_count;
+    int                 track_count;
+    uint32_t            track_frames;
+    int                 silence;
+    int                 dst_effort;         // 0 for uncoded DST frames
+    const char         *album_title;
+    const char         *album_artist;
+}
+disc_config_t;
+
+// an audio sector being filled, its header is put together when it is written
+typedef struct
+{
+    uint8_t             packet_info[7][AUDIO_PACKET_INFO_SIZE];
+    int                 packet_count;
+    uint8_t             frame_info[7][AUDIO_FRAME_INFO_SIZE];
+    int                 frame_count;
+    uint8_t             data[SACD_LSN_SIZE];
+    int                 data_size;
+}
+audio_sector_builder_t;
+
+typedef struct
+{
+    FILE                   *fd;
+    int                     dst_encoded;
+    int                     channel_count;
+    uint32_t                lsn;                // of the first held back sector
+    audio_sector_builder_t  sectors[SECTOR_WINDOW];
+    int                     sector_count;
+}
+audio_packer_t;
+
+// frames reach the packer in order, from write_area or, when DST coded, from
+// the encoder callback
+typedef struct
+{
+    audio_packer_t     *packer;
+    uint32_t           *access_lsn;
+    int                 step;
+    uint32_t            frame;              // of the next frame packed
+    int                 error;
+}
+area_writer_t;
+
+// a sine per channel run through a second order delta-sigma modulator
+typedef struct
+{
+    uint32_t            frequency;
+    double              integrator[2];
+    double              feedback;
+}
+tone_t;
+
+static int file_seek(FILE *fd, uint64_t offset)
+{
+#ifdef _WIN32
+    return _fseeki64(fd, (__int64) offset, SEEK_SET);
+#elif defined(__ANDROID__)
+    return fseek(fd, (long) offset, SEEK_SET);
+#elif defined(__lv2ppu__) || defined(__APPLE__)
+    return fseeko(fd, (off_t) offset, SEEK_SET);
+#else
+    return fseeko64(fd, (off64_t) offset, SEEK_SET);
+#endif
+}
+
+static int write_sectors(FILE *fd, uint32_t lsn, const uint8_t *data, uint32_t count)
+{
+    if (file_seek(fd, (uint64_t) lsn * SACD_LSN_SIZE) != 0)
+        return 0;
+    return fwrite(data, SACD_LSN_SIZE, count, fd) == count;
+}
+
+static void put16(uint8_t *p, uint16_t value)
+{
+    p[0] = (uint8_t) (value >> 8);
+    p[1] = (uint8_t) value;
+}
+
+static void put32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t) (value >> 24);
+    p[1] = (uint8_t) (value >> 16);
+    p[2] = (uint8_t) (value >> 8);
+    p[3] = (uint8_t) value;
+}
+
+static void put_time(uint8_t *p, uint32_t frames)
+{
+    p[0] = (uint8_t) (frames / (60 * SACD_FRAME_RATE));
+    p[1] = (uint8_t) (frames / SACD_FRAME_RATE % 60);
+    p[2] = (uint8_t) (frames % SACD_FRAME_RATE);
+}
+
+// text goes on disc as ISO 8859-1, what doesn't fit in it becomes '?'
+static size_t put_text(uint8_t *p, const char *utf8)
+{
+    const uint8_t *s = (const uint8_t *) utf8;
+    size_t len = 0;
+    unsigned c;
+
+    while (*s)
+    {
+        c = *s++;
+        if (c >= 0x80)
+        {
+            if ((c & 0xe0) == 0xc0 && (*s & 0xc0) == 0x80)
+            {
+                c = (c & 0x1f) << 6 | (*s++ & 0x3f);
+            }
+            else
+            {
+                while ((*s & 0xc0) == 0x80)
+                    s++;
+                c = '?';
+            }
+            if (c > 0xff)
+                c = '?';
+        }
+        if (p)
+            p[len] = (uint8_t) c;
+        len++;
+    }
+    if (p)
+        p[len] = 0;
+    return len + 1;
+}
+
+static void tone_init(tone_t *tone, uint32_t frequency)
+{
+    memset(tone, 0, sizeof(tone_t));
+    tone->frequency = frequency;
+    tone->feedback = -1.0;
+}
+
+// one channel of a frame, every channel_count-th byte from out on
+static void tone_frame(tone_t *tone, uint64_t first_sample, uint8_t *out, int channel_count)
+{
+    double step = 2.0 * M_PI * tone->frequency / SACD_SAMPLING_FREQUENCY;
+    double k = 2.0 * cos(step);
+    double phase, y0, y1, y2, x;
+    int i, bit;
+    uint8_t byte;
+
+    // the recursion restarts from the exact phase every frame, so it can't drift
+    phase = 2.0 * M_PI * (double) (first_sample * tone->frequency % SACD_SAMPLING_FREQUENCY) / SACD_SAMPLING_FREQUENCY;
+    y1 = sin(phase - step);
+    y2 = sin(phase - 2.0 * step);
+
+    for (i = 0; i < FRAME_SIZE_64; i++)
+    {
+        byte = 0;
+        for (bit = 0; bit < 8; bit++)
+        {
+            y0 = k * y1 - y2;
+            y2 = y1;
+            y1 = y0;
+            x = 0.4 * y0;
+
+            tone->integrator[0] += x - tone->feedback;
+            tone->integrator[1] += tone->integrator[0] - tone->feedback;
+            tone->feedback = tone->integrator[1] >= 0.0 ? 1.0 : -1.0;
+            byte = (uint8_t) (byte << 1 | (tone->feedback > 0.0));
+        }
+        out[i * channel_count] = byte;
+    }
+}
+
+static int sector_free(const audio_sector_builder_t *sector, int frame_info_size)
+{
+    return SACD_LSN_SIZE - (int) AUDIO_SECTOR_HEADER_SIZE - sector->packet_count * (int) AUDIO_PACKET_INFO_SIZE -
+           sector->frame_count * frame_info_size - sector->data_size;
+}
+
+static void add_packet(audio_sector_builder_t *sector, int frame_start, int data_type, const uint8_t *data, int len)
+{
+    uint8_t *info = sector->packet_info[sector->packet_count++];
+
+    info[0] = (uint8_t) ((frame_start ? 0x80 : 0) | data_type << 3 | len >> 8);
+    info[1] = (uint8_t) len;
+    if (data)
+        memcpy(sector->data + sector->data_size, data, len);
+    else
+        memset(sector->data + sector->data_size, 0, len);
+    sector->data_size += len;
+}
+
+// writes the first count held back sectors
+static int packer_flush(audio_packer_t *packer, int count)
+{
+    int frame_info_size = packer->dst_encoded ? AUDIO_FRAME_INFO_SIZE : AUDIO_FRAME_INFO_SIZE - 1;
+    uint8_t buffer[SACD_LSN_SIZE], *p;
+    audio_sector_builder_t *sector;
+    int i, j;
+
+    for (i = 0; i < count; i++)
+    {
+        sector = &packer->sectors[i];
+        memset(buffer, 0, SACD_LSN_SIZE);
+
+        // spelled out like the reader does, the bit fields follow the host
+        buffer[0] = (uint8_t) (sector->packet_count << 5 | sector->frame_count << 2 | packer->dst_encoded);
+        p = buffer + AUDIO_SECTOR_HEADER_SIZE;
+        for (j = 0; j < sector->packet_count; j++, p += AUDIO_PACKET_INFO_SIZE)
+            memcpy(p, sector->packet_info[j], AUDIO_PACKET_INFO_SIZE);
+        for (j = 0; j < sector->frame_count; j++, p += frame_info_size)
+            memcpy(p, sector->frame_info[j], frame_info_size);
+        memcpy(p, sector->data, sector->data_size);
+
+        if (fwrite(buffer, SACD_LSN_SIZE, 1, packer->fd) != 1)
+            return 0;
+    }
+
+    memmove(packer->sectors, packer->sectors + count, (packer->sector_count - count) * sizeof(audio_sector_builder_t));
+    packer->sector_count -= count;
+    packer->lsn += count;
+    return 1;
+}
+
+static audio_sector_builder_t *packer_next_sector(audio_packer_t *packer)
+{
+    audio_sector_builder_t *sector;
+
+    if (packer->sector_count == SECTOR_WINDOW)
+        return NULL;
+
+    sector = &packer->sectors[packer->sector_count++];
+    memset(sector, 0, sizeof(audio_sector_builder_t));
+    return sector;
+}
+
+// Adds a frame as packets of the sectors it runs through, the frame info goes
+// to the sector it starts in. Returns the sector the frame starts in, 0 on errors.
+static uint32_t packer_add_frame(audio_packer_t *packer, const uint8_t *data, int size, uint32_t timecode)
+{
+    int frame_info_size = packer->dst_encoded ? AUDIO_FRAME_INFO_SIZE : AUDIO_FRAME_INFO_SIZE - 1;
+    audio_sector_builder_t *sector = packer->sector_count ? &packer->sectors[packer->sector_count - 1] : NULL;
+    int first = 1, packets = 0, overhead, len;
+    uint8_t *frame_info = NULL;
+    uint32_t start_lsn = 0;
+
+    if (size <= 0 || size >= MAX_DST_SIZE)
+        return 0;
+
+    while (size > 0)
+    {
+        overhead = AUDIO_PACKET_INFO_SIZE + (first ? frame_info_size : 0);
+        if (!sector || sector->packet_count == 7 || (first && sector->frame_count == 7) ||
+            sector_free(sector, frame_info_size) < overhead + 1)
+        {
+            sector = packer_next_sector(packer);
+            if (!sector)
+                return 0;
+            continue;
+        }
+
+        len = sector_free(sector, frame_info_size) - overhead;
+        if (len > size)
+            len = size;
+        if (len > 0x7ff)
+            len = 0x7ff;
+
+        if (first)
+        {
+            start_lsn = packer->lsn + packer->sector_count - 1;
+            frame_info = sector->frame_info[sector->frame_count++];
+            put_time(frame_info, timecode);
+            if (packer->dst_encoded)
+            {
+                // channel_bit_2 marks 6 channels, channel_bit_3 5 channels
+                frame_info[3] = (uint8_t) ((packer->channel_count == 6) << 1 | (packer->channel_count == 5));
+            }
+        }
+        add_packet(sector, first, DATA_TYPE_AUDIO, data, len);
+        data += len;
+        size -= len;
+        packets++;
+        first = 0;
+    }
+
+    // the reader counts a DST frame's packets down to find its end
+    if (packer->dst_encoded)
+    {
+        if (packets > MAX_SECTOR_COUNT)
+            return 0;
+        frame_info[3] |= (uint8_t) (packets << 2);
+    }
+
+    // only the last sector can take more packets
+    if (!packer_flush(packer, packer->sector_count - 1))
+        return 0;
+
+    return start_lsn;
+}
+
+// pads out the last sector and writes it
+static int packer_finish(audio_packer_t *packer)
+{
+    int frame_info_size = packer->dst_encoded ? AUDIO_FRAME_INFO_SIZE : AUDIO_FRAME_INFO_SIZE - 1;
+    audio_sector_builder_t *sector;
+    int space;
+
+    if (packer->sector_count == 0)
+        return 1;
+
+    sector = &packer->sectors[packer->sector_count - 1];
+    space = sector_free(sector, frame_info_size) - (int) AUDIO_PACKET_INFO_SIZE;
+    if (sector->packet_count < 7 && space > 0)
+        add_packet(sector, 0, DATA_TYPE_PADDING, NULL, space);
+
+    return packer_flush(packer, packer->sector_count);
+}
+
+// the title and performer of a track as a SACDTTxt entry, returns its size
+static size_t track_text(uint8_t *p, int track, const disc_config_t *config)
+{
+    char title[32];
+    size_t size = 4, len;
+
+    snprintf(title, sizeof(title), "Track %d", track + 1);
+
+    if (p)
+    {
+        memset(p, 0, 4);
+        p[0] = 2;
+    }
+
+    if (p)
+    {
+        p[size] = TRACK_TYPE_TITLE;
+        p[size + 1] = 0x20;
+    }
+    len = put_text(p ? p + size + 2 : NULL, title);
+    size = (size + 2 + len + 3) & ~3;
+
+    if (p)
+    {
+        p[size] = TRACK_TYPE_PERFORMER;
+        p[size + 1] = 0x20;
+    }
+    len = put_text(p ? p + size + 2 : NULL, config->album_artist);
+    size = (size + 2 + len + 3) & ~3;
+
+    return size;
+}
+
+static uint32_t track_text_sectors(const disc_config_t *config)
+{
+    size_t size = (offsetof(area_text_t, track_text_position) + config->track_count * sizeof(uint16_t) + 3) & ~3;
+    int track;
+
+    for (track = 0; track < config->track_count; track++)
+        size += track_text(NULL, track, config);
+
+    return (uint32_t) ((size + SACD_LSN_SIZE - 1) / SACD_LSN_SIZE);
+}
+
+static void build_area_toc(uint8_t *toc_data, uint16_t toc_size, const disc_config_t *config, const area_config_t *area,
+                           uint32_t track_start, uint32_t track_end, const uint32_t *track_lsn,
+                           const uint32_t *access_lsn, uint16_t access_count, uint8_t step)
+{
+    area_toc_t *area_toc = (area_toc_t *) toc_data;
+    uint32_t total_frames = config->track_frames * config->track_count;
+    uint8_t *tracklist_offset = toc_data + 1 * SACD_LSN_SIZE;
+    uint8_t *tracklist_time = toc_data + 2 * SACD_LSN_SIZE;
+    uint8_t *isrc_genre = toc_data + 3 * SACD_LSN_SIZE;
+    uint8_t *access_list = toc_data + 5 * SACD_LSN_SIZE;
+    uint8_t *text = toc_data + AREA_TOC_LISTS_SIZE * SACD_LSN_SIZE;
+    size_t position;
+    int i;
+
+    memcpy(area_toc->id, area->channel_count == 2 ? "TWOCHTOC" : "MULCHTOC", 8);
+    area_toc->version.major = SUPPORTED_VERSION_MAJOR;
+    area_toc->version.minor = SUPPORTED_VERSION_MINOR;
+    area_toc->size = hton16(toc_size);
+    area_toc->max_byte_rate = hton32((uint32_t) area->channel_count * SACD_SAMPLING_FREQUENCY / 8);
+    area_toc->sample_frequency = 4;
+    area_toc->frame_format = area->dst_encoded ? FRAME_FORMAT_DST : FRAME_FORMAT_DSD_3_IN_14;
+    area_toc->channel_count = (uint8_t) area->channel_count;
+    area_toc->loudspeaker_config = area->channel_count == 2 ? 0 : area->channel_count == 5 ? 3 : 4;
+    area_toc->max_available_channels = (uint8_t) area->channel_count;
+    put_time(&area_toc->total_playtime.minutes, total_frames);
+    area_toc->track_count = (uint8_t) config->track_count;
+    area_toc->track_start = hton32(track_start);
+    area_toc->track_end = hton32(track_end);
+    area_toc->text_area_count = 1;
+    memcpy(area_toc->languages[0].language_code, "en", 2);
+    area_toc->languages[0].character_set = CHAR_SET_ISO8859_1;
+    area_toc->track_text_offset = hton16(AREA_TOC_LISTS_SIZE);
+    area_toc->access_list_offset = hton16(5);
+
+    memcpy(tracklist_offset, "SACDTRL1", 8);
+    memcpy(tracklist_time, "SACDTRL2", 8);
+    for (i = 0; i < config->track_count; i++)
+    {
+        put32(tracklist_offset + 8 + i * 4, track_lsn[i]);
+        put32(tracklist_offset + 8 + 255 * 4 + i * 4, track_lsn[i + 1] - track_lsn[i]);
+        put_time(tracklist_time + 8 + i * 4, i * config->track_frames);
+        put_time(tracklist_time + 8 + 255 * 4 + i * 4, config->track_frames);
+    }
+
+    memcpy(isrc_genre, "SACD_IGL", 8);
+
+    memcpy(access_list, "SACD_ACC", 8);
+    put16(access_list + 8, access_count);
+    access_list[10] = step;
+    for (i = 0; i < access_count; i++)
+    {
+        uint8_t *entry = access_list + offsetof(area_access_list_t, main_access_list) + i * 5;
+        entry[2] = (uint8_t) (access_lsn[i] >> 16);
+        entry[3] = (uint8_t) (access_lsn[i] >> 8);
+        entry[4] = (uint8_t) access_lsn[i];
+    }
+
+    memcpy(text, "SACDTTxt", 8);
+    position = (offsetof(area_text_t, track_text_position) + config->track_count * sizeof(uint16_t) + 3) & ~3;
+    for (i = 0; i < config->track_count; i++)
+    {
+        put16(text + 8 + i * 2, (uint16_t) position);
+        position += track_text(text + position, i, config);
+    }
+}
+
+// packs a frame, entry i of the access list is where frame i * step starts
+static void area_add_frame(uint8_t *frame_data, size_t frame_size, void *userdata)
+{
+    area_writer_t *writer = (area_writer_t *) userdata;
+    uint32_t lsn;
+
+    if (writer->error)
+        return;
+
+    lsn = packer_add_frame(writer->packer, frame_data, (int) frame_size, writer->frame);
+    if (!lsn)
+    {
+        fprintf(stderr, "sacd_gen_iso: can't write frame %u\n", writer->frame);
+        writer->error = 1;
+        return;
+    }
+    if (writer->frame % writer->step == 0)
+        writer->access_lsn[writer->frame / writer->step] = lsn;
+    writer->frame++;
+}
+
+// writes an area from start_lsn on, returns the sector after it, 0 on errors
+static uint32_t write_area(FILE *fd, const disc_config_t *config, const area_config_t *area, uint32_t start_lsn, uint16_t *toc_size)
+{
+    uint32_t total_frames = config->track_frames * config->track_count;
+    uint32_t track_lsn[256], *access_lsn = NULL, frame = 0, lsn;
+    uint8_t *toc_data = NULL, *frame_data = NULL;
+    audio_packer_t *packer = NULL;
+    dst_encoder_t *encoder = NULL;
+    area_writer_t writer;
+    tone_t tones[MAX_CHANNEL_COUNT];
+    int track, ch, frame_size, access_count, step, ok = 0;
+    uint32_t i;
+
+    *toc_size = (uint16_t) (AREA_TOC_LISTS_SIZE + track_text_sectors(config));
+    if (*toc_size > MAX_AREA_TOC_SIZE_LSN)
+    {
+        fprintf(stderr, "sacd_gen_iso: track text doesn't fit the Area TOC\n");
+        return 0;
+    }
+
+    // entry i of the access list is where frame i * step starts
+    step = total_frames / MAX_ACCESS_LIST_COUNT + 1;
+    if (step > 255)
+    {
+        fprintf(stderr, "sacd_gen_iso: an area takes at most %d minutes\n", 255 * MAX_ACCESS_LIST_COUNT / (60 * SACD_FRAME_RATE));
+        return 0;
+    }
+    access_count = (total_frames + step - 1) / step;
+
+    frame_size = area->channel_count * FRAME_SIZE_64 + (area->dst_encoded ? 1 : 0);
+    toc_data = (uint8_t *) calloc(*toc_size, SACD_LSN_SIZE);
+    frame_data = (uint8_t *) malloc(frame_size);
+    access_lsn = (uint32_t *) malloc(access_count * sizeof(uint32_t));
+    packer = (audio_packer_t *) calloc(1, sizeof(audio_packer_t));
+    if (!toc_data || !frame_data || !access_lsn || !packer)
+        goto out;
+
+    if (area->dst_encoded && config->dst_effort)
+    {
+        encoder = dst_encoder_create(area->channel_count, 64, config->dst_effort, 0, area_add_frame, &writer);
+        if (!encoder)
+            goto out;
+    }
+
+    for (ch = 0; ch < area->channel_count; ch++)
+        tone_init(&tones[ch], 500 * (ch + 1));
+
+    // TOC-1 goes in once the audio is written
+    if (!write_sectors(fd, start_lsn, toc_data, *toc_size))
+    {
+        fprintf(stderr, "sacd_gen_iso: can't write the image\n");
+        goto out;
+    }
+
+    packer->fd = fd;
+    packer->dst_encoded = area->dst_encoded;
+    packer->channel_count = area->channel_count;
+    packer->lsn = start_lsn + *toc_size;
+
+    memset(&writer, 0, sizeof(area_writer_t));
+    writer.packer = packer;
+    writer.access_lsn = access_lsn;
+    writer.step = step;
+
+    for (track = 0; track < config->track_count; track++)
+    {
+        track_lsn[track] = packer->lsn;
+        for (i = 0; i < config->track_frames; i++, frame++)
+        {
+            uint8_t *dsd = frame_data + (area->dst_encoded ? 1 : 0);
+
+            // an uncoded DST frame is a 0 header byte followed by the DSD
+            if (area->dst_encoded)
+                frame_data[0] = 0;
+
+            if (config->silence)
+                memset(dsd, DSD_SILENCE, area->channel_count * FRAME_SIZE_64);
+            else
+            {
+                for (ch = 0; ch < area->channel_count; ch++)
+                    tone_frame(&tones[ch], (uint64_t) frame * SAMPLES_PER_FRAME * 64, dsd + ch, area->channel_count);
+            }
+
+            if (encoder)
+                dst_encoder_encode(encoder, dsd, area->channel_count * FRAME_SIZE_64);
+            else
+                area_add_frame(frame_data, frame_size, &writer);
+            if (writer.error)
+                goto out;
+        }
+
+        // the frames of the track have to be packed before its last sector is padded out
+        if (encoder)
+            dst_encoder_flush(encoder);
+        if (writer.error)
+            goto out;
+        if (!packer_finish(packer))
+        {
+            fprintf(stderr, "sacd_gen_iso: can't write the image\n");
+            goto out;
+        }
+    }
+    track_lsn[track] = packer->lsn;
+
+    build_area_toc(toc_data, *toc_size, config, area, track_lsn[0], packer->lsn - 1, track_lsn,
+                   access_lsn, (uint16_t) access_count, (uint8_t) step);
+
+    // TOC-2 follows the audio
+    lsn = packer->lsn;
+    if (!write_sectors(fd, lsn, toc_data, *toc_size) || !write_sectors(fd, start_lsn, toc_data, *toc_size))
+    {
+        fprintf(stderr, "sacd_gen_iso: can't write the image\n");
+        goto out;
+    }
+
+    ok = 1;
+
+out:
+    if (encoder)
+        dst_encoder_destroy(encoder);
+    free(packer);
+    free(access_lsn);
+    free(frame_data);
+    free(toc_data);
+    return ok ? lsn + *toc_size : 0;
+}
+
+static void build_master_toc(uint8_t *master_data, const disc_config_t *config, const uint32_t *area_toc_1,
+                             const uint32_t *area_toc_2, const uint16_t *area_toc_size)
+{
+    master_toc_t *master_toc = (master_toc_t *) master_data;
+    uint8_t *text;
+    size_t position;
+    int i;
+
+    memcpy(master_toc->id, "SACDMTOC", 8);
+    master_toc->version.major = SUPPORTED_VERSION_MAJOR;
+    master_toc->version.minor = SUPPORTED_VERSION_MINOR;
+    master_toc->album_set_size = hton16(1);
+    master_toc->album_sequence_number = hton16(1);
+    master_toc->area_1_toc_1_start = hton32(area_toc_1[0]);
+    master_toc->area_1_toc_2_start = hton32(area_toc_2[0]);
+    master_toc->area_1_toc_size = hton16(area_toc_size[0]);
+    if (config->area_count > 1)
+    {
+        master_toc->area_2_toc_1_start = hton32(area_toc_1[1]);
+        master_toc->area_2_toc_2_start = hton32(area_toc_2[1]);
+        master_toc->area_2_toc_size = hton16(area_toc_size[1]);
+    }
+    master_toc->text_area_count = 1;
+    memcpy(master_toc->locales[0].language_code, "en", 2);
+    master_toc->locales[0].character_set = CHAR_SET_ISO8859_1;
+
+    // the reader wants all eight text sectors, only the first one has text
+    for (i = 0; i < MAX_LANGUAGE_COUNT; i++)
+        memcpy(master_data + (i + 1) * SACD_LSN_SIZE, "SACDText", 8);
+
+    text = master_data + SACD_LSN_SIZE;
+    position = offsetof(master_sacd_text_t, data);
+    put16(text + offsetof(master_sacd_text_t, album_title_position), (uint16_t) position);
+    put16(text + offsetof(master_sacd_text_t, disc_title_position), (uint16_t) position);
+    position += (put_text(text + position, config->album_title) + 3) & ~3;
+    put16(text + offsetof(master_sacd_text_t, album_artist_position), (uint16_t) position);
+    put16(text + offsetof(master_sacd_text_t, disc_artist_position), (uint16_t) position);
+    put_text(text + position, config->album_artist);
+
+    memcpy(master_data + (MASTER_TOC_LEN - 1) * SACD_LSN_SIZE, "SACD_Man", 8);
+}
+
+static int parse_area(const char *arg, area_config_t *area)
+{
+    char *end;
+
+    area->channel_count = (int) strtol(arg, &end, 10);
+    area->dst_encoded = 0;
+    if (strcmp(end, ":dst") == 0)
+        area->dst_encoded = 1;
+    else if (*end != 0)
+        return 0;
+
+    if (area->channel_count != 2 && area->channel_count != 5 && area->channel_count != 6)
+        return 0;
+
+    // multi channel audio is always DST coded on disc
+    return area->channel_count == 2 || area->dst_encoded;
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: sacd_gen_iso [options] <image>\n"
+            "\n"
+            "  -a, --area <channels>[:dst]  adds an area of 2, 5 or 6 channels, of DST\n"
+            "                               frames with :dst (multi channel needs it),\n"
+            "                               may be given twice (default: 2)\n"
+            "  -t, --tracks <count>         tracks per area, 1 to 255 (default: 3)\n"
+            "  -l, --length <seconds>       length of a track (default: 10)\n"
+            "  -T, --title <text>           album title\n"
+            "  -A, --artist <text>          album artist, also the performer of every track\n"
+            "  -s, --silence                DSD silence instead of a tone per channel\n"
+            "  -e, --effort <level>         codes the DST frames at an effort of 1\n"
+            "                               (fastest) to 9 (smallest), 0 stores them\n"
+            "                               uncoded (default: 0)\n");
+}
+
+int main(int argc, char *argv[])
+{
+    disc_config_t config;
+    uint8_t *master_data = NULL;
+    uint32_t area_toc_1[MAX_AREA_COUNT], area_toc_2[MAX_AREA_COUNT], lsn;
+    uint16_t area_toc_size[MAX_AREA_COUNT];
+    const char *path = NULL;
+    double seconds = 10.0;
+    FILE *fd = NULL;
+    int i, ok = 0;
+
+    memset(&config, 0, sizeof(disc_config_t));
+    config.track_count = 3;
+    config.album_title = "Synthetic SACD";
+    config.album_artist = "sacd_gen_iso";
+
+    for (i = 1; i < argc; i++)
+    {
+        const char *opt = argv[i];
+        const char *arg = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (strcmp(opt, "-s") == 0 || strcmp(opt, "--silence") == 0)
+        {
+            config.silence = 1;
+            continue;
+        }
+        if (opt[0] != '-')
+        {
+            if (path)
+            {
+                usage();
+                return 1;
+            }
+            path = opt;
+            continue;
+        }
+        if (!arg)
+        {
+            usage();
+            return 1;
+        }
+        i++;
+
+        if (strcmp(opt, "-a") == 0 || strcmp(opt, "--area") == 0)
+        {
+            if (config.area_count == MAX_AREA_COUNT || !parse_area(arg, &config.area[config.area_count]))
+            {
+                usage();
+                return 1;
+            }
+            config.area_count++;
+        }
+        else if (strcmp(opt, "-t") == 0 || strcmp(opt, "--tracks") == 0)
+            config.track_count = atoi(arg);
+        else if (strcmp(opt, "-l") == 0 || strcmp(opt, "--length") == 0)
+            seconds = atof(arg);
+        else if (strcmp(opt, "-e") == 0 || strcmp(opt, "--effort") == 0)
+            config.dst_effort = atoi(arg);
+        else if (strcmp(opt, "-T") == 0 || strcmp(opt, "--title") == 0)
+            config.album_title = arg;
+        else if (strcmp(opt, "-A") == 0 || strcmp(opt, "--artist") == 0)
+            config.album_artist = arg;
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    config.track_frames = (uint32_t) (seconds * SACD_FRAME_RATE + 0.5);
+    if (!path || config.track_count < 1 || config.track_count > 255 || config.track_frames < 1 ||
+        config.dst_effort < 0 || config.dst_effort > DST_ENCODER_MAX_EFFORT)
+    {
+        usage();
+        return 1;
+    }
+    if (config.area_count == 0)
+    {
+        config.area[0].channel_count = 2;
+        config.area_count = 1;
+    }
+    if (config.area_count == 2 && (config.area[0].channel_count == 2) == (config.area[1].channel_count == 2))
+    {
+        fprintf(stderr, "sacd_gen_iso: a disc has one 2 channel and one multi channel area at most\n");
+        return 1;
+    }
+
+    // the DST encoder logs through the library
+    init_logging();
+
+    master_data = (uint8_t *) calloc(START_OF_MASTER_TOC + 3 * MASTER_TOC_LEN, SACD_LSN_SIZE);
+    fd = fopen(path, "wb");
+    if (!master_data || !fd)
+    {
+        fprintf(stderr, "sacd_gen_iso: can't create %s\n", path);
+        goto out;
+    }
+
+    // the file system area and the Master TOCs go in last
+    lsn = START_OF_MASTER_TOC + 3 * MASTER_TOC_LEN;
+    if (!write_sectors(fd, 0, master_data, lsn))
+    {
+        fprintf(stderr, "sacd_gen_iso: can't write %s\n", path);
+        goto out;
+    }
+
+    for (i = 0; i < config.area_count; i++)
+    {
+        area_toc_1[i] = lsn;
+        lsn = write_area(fd, &config, &config.area[i], lsn, &area_toc_size[i]);
+        if (!lsn)
+            goto out;
+        area_toc_2[i] = lsn - area_toc_size[i];
+
+        printf("area %d: %d channels, %s, %d tracks of %u frames, LSN %u to %u\n", i + 1,
+               config.area[i].channel_count, config.area[i].dst_encoded ? "DST" : "DSD",
+               config.track_count, config.track_frames, area_toc_1[i], lsn - 1);
+    }
+
+    memset(master_data, 0, MASTER_TOC_LEN * SACD_LSN_SIZE);
+    build_master_toc(master_data, &config, area_toc_1, area_toc_2, area_toc_size);
+    for (i = 0; i < 3; i++)
+    {
+        if (!write_sectors(fd, START_OF_MASTER_TOC + i * MASTER_TOC_LEN, master_data, MASTER_TOC_LEN))
+        {
+            fprintf(stderr, "sacd_gen_iso: can't write %s\n", path);
+            goto out;
+        }
+    }
+
+    ok = 1;
+
+out:
+    if (fd && fclose(fd) != 0)
+        ok = 0;
+    free(master_data);
+    destroy_logging();
+    return ok ? 0 : 1;
+}
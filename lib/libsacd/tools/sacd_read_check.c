@@ -0,0 +1,414 @@
+/**
+ * SACD Ripper - https://github.com/sacd-ripper/
+ *
+ * Copyright (c) 2010-2015 by respective authors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/**
+ * Checks the reader against an unencrypted image, e.g. one written by
+ * sacd_gen_iso:
+ *
+ *   sacd_gen_iso -a 2 -a 6:dst -e 5 disc.iso && sacd_read_check disc.iso
+ *
+ * The frames of every area are walked as when ripping, and the frame index
+ * of the area has to give each frame's sector, offset, size and position.
+ * The index also has to come back the same from a save and a load.
+ *
+ * Walking the sectors of each block in runs on the frame threads has to
+ * find the same frames, with the same bytes, as walking them serially.
+ *
+ * Seeking has to find the sector of every frame the index gives. The
+ * estimate from the access list has to stay within the area and be exact
+ * at the steps of the list.
+ *
+ * Exits with 1 on the first mismatch.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "scarletbook.h"
+#include "scarletbook_read.h"
+#include "sacd_reader.h"
+#include "logging.h"
+
+// the library reads through the VFS of its host, here a plain file
+struct sacd_input_s
+{
+    FILE               *fd;
+    uint32_t            total_sectors;
+};
+
+static int file_seek(FILE *fd, uint64_t offset)
+{
+#ifdef _WIN32
+    return _fseeki64(fd, (__int64) offset, SEEK_SET);
+#elif defined(__ANDROID__)
+    return fseek(fd, (long) offset, SEEK_SET);
+#elif defined(__lv2ppu__) || defined(__APPLE__)
+    return fseeko(fd, (off_t) offset, SEEK_SET);
+#else
+    return fseeko64(fd, (off64_t) offset, SEEK_SET);
+#endif
+}
+
+sacd_input_t sacd_vfs_input_open(const char *target)
+{
+    sacd_input_t dev = (sacd_input_t) calloc(1, sizeof(*dev));
+
+    if (!dev)
+        return NULL;
+
+    dev->fd = fopen(target, "rb");
+    if (!dev->fd)
+    {
+        free(dev);
+        return NULL;
+    }
+    fseek(dev->fd, 0, SEEK_END);
+    dev->total_sectors = (uint32_t) (ftell(dev->fd) / SACD_LSN_SIZE);
+
+    return dev;
+}
+
+int sacd_vfs_input_close(sacd_input_t dev)
+{
+    fclose(dev->fd);
+    free(dev);
+    return 0;
+}
+
+ssize_t sacd_vfs_input_read(sacd_input_t dev, int pos, int blocks, void *buffer)
+{
+    if (file_seek(dev->fd, (uint64_t) pos * SACD_LSN_SIZE) != 0)
+        return 0;
+    return (ssize_t) fread(buffer, SACD_LSN_SIZE, blocks, dev->fd);
+}
+
+char *sacd_vfs_input_error(sacd_input_t dev)
+{
+    (void) dev;
+    return (char *) "unknown error";
+}
+
+int sacd_vfs_input_authenticate(sacd_input_t dev)
+{
+    (void) dev;
+    return 0;
+}
+
+int sacd_vfs_input_decrypt(sacd_input_t dev, uint8_t *buffer, int blocks)
+{
+    (void) dev;
+    (void) buffer;
+    (void) blocks;
+    return 0;
+}
+
+uint32_t sacd_vfs_input_total_sectors(sacd_input_t dev)
+{
+    return dev ? dev->total_sectors : 0;
+}
+
+// the frames of an area as found when ripping it
+typedef struct
+{
+    uint32_t           *lsn;                // 0 when the frame began in an earlier block
+    uint16_t           *offset;
+    uint32_t           *size;
+    uint32_t           *hash;               // FNV-1a of the frame's bytes
+    uint32_t            frame_count;
+    uint32_t            frames_allocated;
+}
+walked_frames_t;
+
+static uint32_t hash_frame(const uint8_t *data, size_t size)
+{
+    uint32_t hash = 2166136261u;
+
+    while (size--)
+        hash = (hash ^ *data++) * 16777619u;
+    return hash;
+}
+
+static void free_walked_frames(walked_frames_t *walked)
+{
+    free(walked->lsn);
+    free(walked->offset);
+    free(walked->size);
+    free(walked->hash);
+}
+
+static int walk_frames(scarletbook_handle_t *handle, int area, walked_frames_t *walked)
+{
+    uint32_t lsn = handle->area[area].area_toc->track_start;
+    uint32_t end_lsn = handle->area[area].area_toc->track_end + 1;
+    uint8_t *read_buffer = (uint8_t *) malloc(MAX_PROCESSING_BLOCK_SIZE * SACD_LSN_SIZE);
+    int i;
+
+    if (!read_buffer)
+        return 0;
+
+    scarletbook_frame_init(handle);
+    while (lsn < end_lsn)
+    {
+        uint32_t block_size = end_lsn - lsn < MAX_PROCESSING_BLOCK_SIZE ? end_lsn - lsn : MAX_PROCESSING_BLOCK_SIZE;
+        scarletbook_frame_batch_t *batch;
+
+        if (sacd_read_block_raw((sacd_reader_t *) handle->sacd, lsn, block_size, read_buffer) != (ssize_t) block_size)
+        {
+            free(read_buffer);
+            return 0;
+        }
+        batch = scarletbook_process_frame_batch(handle, read_buffer, block_size, lsn + block_size == end_lsn);
+
+        for (i = 0; i < batch->frame_count; i++)
+        {
+            scarletbook_frame_desc_t *frame = &batch->frames[i];
+            const uint8_t *data = frame->segments[0].data;
+
+            if (walked->frame_count == walked->frames_allocated)
+            {
+                walked->frames_allocated = walked->frames_allocated ? walked->frames_allocated * 2 : 1024;
+                walked->lsn = (uint32_t *) realloc(walked->lsn, walked->frames_allocated * sizeof(uint32_t));
+                walked->offset = (uint16_t *) realloc(walked->offset, walked->frames_allocated * sizeof(uint16_t));
+                walked->size = (uint32_t *) realloc(walked->size, walked->frames_allocated * sizeof(uint32_t));
+                walked->hash = (uint32_t *) realloc(walked->hash, walked->frames_allocated * sizeof(uint32_t));
+                if (!walked->lsn || !walked->offset || !walked->size || !walked->hash)
+                {
+                    free(read_buffer);
+                    return 0;
+                }
+            }
+
+            // the head of a frame carried over from the previous block is no longer in the read buffer
+            walked->lsn[walked->frame_count] = 0;
+            walked->offset[walked->frame_count] = 0;
+            if (data >= read_buffer && data < read_buffer + block_size * SACD_LSN_SIZE)
+            {
+                walked->lsn[walked->frame_count] = lsn + (uint32_t) ((data - read_buffer) / SACD_LSN_SIZE);
+                walked->offset[walked->frame_count] = (uint16_t) ((data - read_buffer) % SACD_LSN_SIZE);
+            }
+            walked->size[walked->frame_count] = (uint32_t) frame->size;
+            walked->hash[walked->frame_count] = hash_frame(scarletbook_frame_data(handle, frame), frame->size);
+            walked->frame_count++;
+        }
+        lsn += block_size;
+    }
+
+    free(read_buffer);
+    return 1;
+}
+
+static int check_threaded_walk(scarletbook_handle_t *handle, int area, const walked_frames_t *serial)
+{
+    walked_frames_t threaded;
+    uint32_t frame;
+    int ok;
+
+    // as many runs as a block splits into
+    memset(&threaded, 0, sizeof(walked_frames_t));
+    scarletbook_frame_set_threads(handle, MAX_PROCESSING_BLOCK_SIZE / MIN_FRAME_CHUNK_SIZE);
+    ok = walk_frames(handle, area, &threaded);
+    scarletbook_frame_set_threads(handle, 1);
+    if (!ok)
+    {
+        fprintf(stderr, "area %d: can't read the audio sectors\n", area);
+        free_walked_frames(&threaded);
+        return 0;
+    }
+
+    if (threaded.frame_count != serial->frame_count)
+    {
+        fprintf(stderr, "area %d: walking in runs finds %u frames, serially %u\n", area, threaded.frame_count, serial->frame_count);
+        ok = 0;
+    }
+    for (frame = 0; frame < serial->frame_count && ok; frame++)
+    {
+        if (threaded.lsn[frame] != serial->lsn[frame] || threaded.offset[frame] != serial->offset[frame] ||
+            threaded.size[frame] != serial->size[frame] || threaded.hash[frame] != serial->hash[frame])
+        {
+            fprintf(stderr, "area %d: frame %u walked in runs is at %u+%u, %u bytes hashing to %08x, serially at %u+%u, %u bytes hashing to %08x\n",
+                    area, frame, threaded.lsn[frame], threaded.offset[frame], threaded.size[frame], threaded.hash[frame],
+                    serial->lsn[frame], serial->offset[frame], serial->size[frame], serial->hash[frame]);
+            ok = 0;
+        }
+    }
+    if (ok)
+        printf("area %d: %u frames walked in runs as serially\n", area, serial->frame_count);
+
+    free_walked_frames(&threaded);
+    return ok;
+}
+
+static int check_frame_index(scarletbook_handle_t *handle, int area, scarletbook_frame_index_t *index, const walked_frames_t *walked)
+{
+    scarletbook_frame_index_t *loaded;
+    uint64_t expected_position = 0;
+    uint32_t frame;
+    FILE *fd;
+    int ok = 1;
+
+    if (index->frame_count != walked->frame_count)
+    {
+        fprintf(stderr, "area %d: the index has %u frames, ripping finds %u\n", area, index->frame_count, walked->frame_count);
+        return 0;
+    }
+
+    for (frame = 0; frame < walked->frame_count && ok; frame++)
+    {
+        uint32_t lsn;
+        uint16_t offset, size;
+        uint64_t position;
+
+        if (!scarletbook_frame_index_lookup(index, frame, &lsn, &offset, &size, &position) ||
+            size != (walked->size[frame] > 0xffff ? 0xffff : walked->size[frame]) ||
+            position != expected_position ||
+            (walked->lsn[frame] && (lsn != walked->lsn[frame] || offset != walked->offset[frame])))
+        {
+            fprintf(stderr, "area %d: frame %u is at %u+%u, %u bytes at %llu in the index, not at %u+%u, %u bytes at %llu\n",
+                    area, frame, lsn, offset, size, (unsigned long long) position,
+                    walked->lsn[frame], walked->offset[frame], walked->size[frame], (unsigned long long) expected_position);
+            ok = 0;
+        }
+        expected_position += walked->size[frame] > 0xffff ? 0xffff : walked->size[frame];
+    }
+
+    // a saved index loads back the same
+    fd = ok ? tmpfile() : NULL;
+    if (ok)
+    {
+        loaded = NULL;
+        if (fd && scarletbook_frame_index_save(index, fd) == 0)
+        {
+            rewind(fd);
+            loaded = scarletbook_frame_index_load(handle, area, fd);
+        }
+        if (!loaded || loaded->frame_count != index->frame_count || loaded->total_size != index->total_size ||
+            memcmp(loaded->entries, index->entries, index->frame_count * sizeof(scarletbook_frame_index_entry_t)) != 0 ||
+            memcmp(loaded->bases, index->bases, ((index->frame_count + FRAME_INDEX_INTERVAL - 1) / FRAME_INDEX_INTERVAL) * sizeof(scarletbook_frame_index_base_t)) != 0)
+        {
+            fprintf(stderr, "area %d: the frame index doesn't load back as saved\n", area);
+            ok = 0;
+        }
+        scarletbook_frame_index_destroy(loaded);
+    }
+    if (fd)
+        fclose(fd);
+
+    if (ok)
+        printf("area %d: %u frames of %u sectors indexed\n", area, index->frame_count, index->end_lsn - index->start_lsn);
+
+    return ok;
+}
+
+static int check_seek(scarletbook_handle_t *handle, int area, const scarletbook_frame_index_t *index)
+{
+    area_access_list_t *access_list = handle->area[area].area_access_list;
+    uint32_t start_lsn = handle->area[area].area_toc->track_start;
+    uint32_t end_lsn = handle->area[area].area_toc->track_end + 1;
+    uint32_t frame, lsn, estimate, found_lsn;
+
+    for (frame = 0; frame < index->frame_count; frame++)
+    {
+        scarletbook_frame_index_lookup(index, frame, &lsn, 0, 0, 0);
+
+        estimate = scarletbook_time_to_lsn(handle, area, frame);
+        if (estimate < start_lsn || estimate >= end_lsn ||
+            (access_list && frame % access_list->main_step_size == 0 && estimate != lsn))
+        {
+            fprintf(stderr, "area %d: frame %u is estimated at %u, it is at %u\n", area, frame, estimate, lsn);
+            return 0;
+        }
+
+        if (!scarletbook_seek_frame(handle, area, frame, &found_lsn) || found_lsn != lsn)
+        {
+            fprintf(stderr, "area %d: seeking frame %u finds %u, it is at %u\n", area, frame, found_lsn, lsn);
+            return 0;
+        }
+    }
+
+    // past the last frame there is nothing to find
+    if (scarletbook_seek_frame(handle, area, index->frame_count, &found_lsn))
+    {
+        fprintf(stderr, "area %d: seeking past the last frame finds %u\n", area, found_lsn);
+        return 0;
+    }
+
+    printf("area %d: %u frames found by seeking, %s\n", area, index->frame_count,
+           access_list ? "from the access list" : "without an access list");
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    sacd_reader_t *sacd;
+    scarletbook_handle_t *handle;
+    int area, ok = 1;
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "usage: sacd_read_check <image>\n");
+        return 1;
+    }
+
+    init_logging();
+
+    sacd = sacd_open(argv[1]);
+    handle = sacd ? scarletbook_open(sacd, 0) : NULL;
+    if (!handle)
+    {
+        fprintf(stderr, "sacd_read_check: can't open %s\n", argv[1]);
+        if (sacd)
+            sacd_close(sacd);
+        destroy_logging();
+        return 1;
+    }
+
+    for (area = 0; area < handle->area_count && ok; area++)
+    {
+        scarletbook_frame_index_t *index = NULL;
+        walked_frames_t walked;
+
+        memset(&walked, 0, sizeof(walked_frames_t));
+        if (!walk_frames(handle, area, &walked))
+        {
+            fprintf(stderr, "area %d: can't read the audio sectors\n", area);
+            ok = 0;
+        }
+        else if (!(index = scarletbook_frame_index_create(handle, area)))
+        {
+            fprintf(stderr, "area %d: no frame index\n", area);
+            ok = 0;
+        }
+        else
+        {
+            ok = check_frame_index(handle, area, index, &walked) && check_seek(handle, area, index) &&
+                 check_threaded_walk(handle, area, &walked);
+        }
+        scarletbook_frame_index_destroy(index);
+        free_walked_frames(&walked);
+    }
+
+    scarletbook_close(handle);
+    sacd_close(sacd);
+    destroy_logging();
+
+    return ok ? 0 : 1;
+}
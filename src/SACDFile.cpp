@@ -6,8 +6,6 @@
  *  See LICENSE.md for more information.
  */
 
-#include "RingBuffer.h"
-
 #include <algorithm>
 #include <cctype>
 #include <fcntl.h>
@@ -15,20 +13,26 @@
 #include <kodi/Filesystem.h>
 #include <kodi/addon-instance/VFS.h>
 #include <map>
+#include <mutex>
 #include <sstream>
 #include <vector>
 
 extern "C"
 {
 
+#include "charset.h"
 #include "dsf.h"
 #include "logging.h"
+#include "metrics.h"
+#include "output_sink.h"
 #include "sacd_reader.h"
 #include "scarletbook.h"
 #include "scarletbook_id3.h"
 #include "scarletbook_output.h"
 #include "scarletbook_print.h"
 #include "scarletbook_read.h"
+#include "timeout.h"
+#include "trace.h"
 
   struct sacd_input_s
   {
@@ -197,31 +201,77 @@ extern "C"
     uint32_t checked_for_non_encrypted_disc = 0;
     uint32_t non_encrypted_disc = 0;
     int encrypted = 0;
-    uint8_t* frame_buffer = nullptr;
-    CRingBuffer decode_buffer;
+    std::mutex decode_buffer_lock; // guards ft->sink, the DST decoder may write from its own thread
+    dst_decoder_t* dst_decoder = nullptr;
+    bool dst_flushed = false;
+    bool finished = false;
+    bool dsdiff = false; // DST frames are passed through instead of decoded to DSF
+    int64_t audio_length = 0;
     int64_t pos = 0;
+
+    // where the time goes, dumped to the log on Close
+    metrics_t* metrics = nullptr;
+    metric_t* read_bytes = nullptr;
+    metric_t* read_time = nullptr;
+    metric_t* decrypt_time = nullptr;
+    metric_t* frames = nullptr;
+    metric_t* frame_time = nullptr;
+    metric_t* convert_time = nullptr;
+    metric_t* ring_fill = nullptr;
+    metric_t* read_wait = nullptr;
   };
 
-  static void frame_read_callback(scarletbook_handle_t* handle,
-                                  uint8_t* frame_data,
-                                  size_t frame_size,
-                                  void* userdata)
+  static void setup_metrics(SACDContext* ctx)
   {
-    SACDContext* ctx = static_cast<SACDContext*>(userdata);
+    ctx->metrics = metrics_create();
+    ctx->read_bytes = metrics_counter(ctx->metrics, "sector bytes read", "bytes");
+    ctx->read_time = metrics_histogram(ctx->metrics, "sector read", "us per block");
+    ctx->decrypt_time = metrics_histogram(ctx->metrics, "decrypt", "us per block");
+    ctx->frames = metrics_counter(ctx->metrics, "frames extracted", "frames");
+    ctx->frame_time = metrics_histogram(ctx->metrics, "frame extraction", "us per block");
+    ctx->convert_time = metrics_histogram(ctx->metrics, "conversion", "us per write");
+    ctx->ring_fill = metrics_histogram(ctx->metrics, "ring fill", "bytes at Read");
+    ctx->read_wait = metrics_histogram(ctx->metrics, "Read wait", "us per Read");
+  }
+
+  static void print_metric(const char* line, void* userdata)
+  {
+    kodiLog(ADDON_LOG_DEBUG, "%s: %s", static_cast<const char*>(userdata), line);
+  }
 
-    size_t actual = (*ctx->ft->handler.write)(ctx->ft, frame_data, frame_size);
-    ctx->decode_buffer.WriteData(reinterpret_cast<char*>(ctx->frame_buffer), actual);
-    ctx->ft->write_length += actual;
+  static void process_frame_batch(SACDContext* ctx, scarletbook_frame_batch_t* batch)
+  {
+    scarletbook_handle_t* handle = ctx->ft->sb_handle;
+
+    if (ctx->dst_decoder)
+    {
+      for (int i = 0; i < batch->frame_count; ++i)
+        dst_decoder_decode(ctx->dst_decoder, scarletbook_frame_data(handle, &batch->frames[i]),
+                           batch->frames[i].size);
+      return;
+    }
+
+    // all frames of the block go to the writer under a single lock, straight
+    // from the read buffer
+    std::unique_lock<std::mutex> lock(ctx->decode_buffer_lock);
+    TRACE_BEGIN(span);
+    double start = timeout_gettime();
+    for (int i = 0; i < batch->frame_count; ++i)
+      ctx->ft->write_length += (*ctx->ft->handler.write_segments)(
+          ctx->ft, batch->frames[i].segments, batch->frames[i].segment_count);
+    metrics_record_time(ctx->convert_time, start);
+    TRACE_END(span, "write frames", batch->frame_count);
   }
 
   static void frame_decoded_callback(uint8_t* frame_data, size_t frame_size, void* userdata)
   {
     SACDContext* ctx = static_cast<SACDContext*>(userdata);
-    dsf_handle_t* handle = static_cast<dsf_handle_t*>(ctx->ft->priv);
 
-    size_t actual = (*ctx->ft->handler.write)(ctx->ft, frame_data, frame_size);
-    ctx->decode_buffer.WriteData(reinterpret_cast<char*>(ctx->frame_buffer), actual);
-    ctx->ft->write_length += actual;
+    // the decoder emits planar frames, which the DSF writer copies as they are
+    std::unique_lock<std::mutex> lock(ctx->decode_buffer_lock);
+    double start = timeout_gettime();
+    ctx->ft->write_length += (*ctx->ft->handler.write_planar)(ctx->ft, frame_data, frame_size);
+    metrics_record_time(ctx->convert_time, start);
   }
 
   static void frame_error_callback(int frame_count,
@@ -263,9 +313,12 @@ kodi::addon::VFSFileHandle CSACDFile::Open(const kodi::addon::VFSUrl& url)
   std::string file(url.GetFilename());
   int track = strtol(file.substr(0, file.size() - 4).c_str(), 0, 10);
   SACDContext* result = new SACDContext;
+  setup_metrics(result);
+  result->dsdiff = file.size() > 4 && file.compare(file.size() - 4, 4, ".dff") == 0;
   result->reader = sacd_open(URLDecode(url.GetHostname()).c_str());
   if (!result->reader)
   {
+    metrics_destroy(result->metrics);
     delete result;
     return nullptr;
   }
@@ -273,6 +326,7 @@ kodi::addon::VFSFileHandle CSACDFile::Open(const kodi::addon::VFSUrl& url)
   if (!result->handle)
   {
     sacd_close(result->reader);
+    metrics_destroy(result->metrics);
     delete result;
     return nullptr;
   }
@@ -280,13 +334,11 @@ kodi::addon::VFSFileHandle CSACDFile::Open(const kodi::addon::VFSUrl& url)
   std::string url2 = url.GetURL();
   result->output = scarletbook_output_create(result->handle, 0, 0, 0);
   scarletbook_output_enqueue_track(result->output, result->handle->twoch_area_idx, track - 1,
-                                   const_cast<char*>(url2.c_str()), const_cast<char*>("dsf"), 0);
+                                   const_cast<char*>(url2.c_str()),
+                                   const_cast<char*>(result->dsdiff ? "dsdiff" : "dsf"), 0);
 
   scarletbook_frame_init(result->handle);
 
-  result->frame_buffer = new uint8_t[128 * 1024];
-  result->decode_buffer.Create(1024 * 1024 * 10);
-
   id3_buffer.resize(128 * 1024);
   int len = scarletbook_id3_tag_render(result->handle, id3_buffer.data(), 0, track - 1);
   id3_buffer.resize(len);
@@ -296,14 +348,51 @@ kodi::addon::VFSFileHandle CSACDFile::Open(const kodi::addon::VFSUrl& url)
   result->ft->priv = calloc(1, result->ft->handler.priv_size);
   result->ft->fd = 0;
 
+  // the writer streams the file into memory, from where Read picks it up
+  result->ft->sink = output_sink_ring_create(1024 * 1024);
+
   // what blocks do we need to process?
   result->ft->current_lsn = result->ft->start_lsn;
   result->end_lsn = result->ft->start_lsn + result->ft->length_lsn;
 
-  dsf_handle_t* handle = static_cast<dsf_handle_t*>(result->ft->priv);
-  handle->header_size = (result->end_lsn - result->ft->start_lsn) *
-                        SACD_LSN_SIZE; // store approximate length here for header injection
-  (*result->ft->handler.startwrite)(result->ft);
+  if (result->dsdiff)
+  {
+    // DSDIFF carries the DST frames as they are on disc, or plain DSD, and
+    // announces its size up front as nothing can be patched once it is read
+    result->ft->dsd_encoded_export = !result->ft->dst_encoded_import;
+    result->ft->streaming = 1;
+    (*result->ft->handler.startwrite)(result->ft);
+  }
+  else
+  {
+    // DST frames are decoded to plain DSD, whose length follows from the track duration
+    result->audio_length = (result->end_lsn - result->ft->start_lsn) * SACD_LSN_SIZE;
+    if (result->ft->dst_encoded_import)
+    {
+      scarletbook_area_t* area = &result->handle->area[result->ft->area];
+      result->audio_length =
+          static_cast<int64_t>(TIME_FRAMECOUNT(&area->area_tracklist_time->duration[track - 1])) *
+          FRAME_SIZE_64 * result->ft->channel_count;
+
+      // decode on the reading thread, unless that is too slow for real time
+      dst_decoder_limits_t limits = {};
+      limits.mode = DST_DECODER_AUTO;
+      limits.planar = 1;
+      result->dst_decoder = dst_decoder_create_limited(result->ft->channel_count, 64, &limits,
+                                                       frame_decoded_callback,
+                                                       frame_error_callback, result);
+      if (result->dst_decoder)
+        dst_decoder_set_metrics(result->dst_decoder, result->metrics);
+    }
+
+    dsf_handle_t* handle = static_cast<dsf_handle_t*>(result->ft->priv);
+    handle->header_size = result->audio_length; // store approximate length here for header injection
+    (*result->ft->handler.startwrite)(result->ft);
+  }
+
+  // with no DST decoding to take the cores, the sectors of each block are walked in runs side by side
+  if (!result->ft->dst_encoded_import)
+    scarletbook_frame_set_threads(result->handle, 0);
 
   // set the encryption range
   if (result->handle->area[0].area_toc != 0)
@@ -325,10 +414,7 @@ ssize_t CSACDFile::Read(kodi::addon::VFSFileHandle context, uint8_t* lpBuf, size
   SACDContext* ctx = static_cast<SACDContext*>(context);
 
   // prepend header
-  dsf_handle_t* handle = static_cast<dsf_handle_t*>(ctx->ft->priv);
-  handle->data = ctx->frame_buffer;
-
-  if (handle && ctx->pos < id3_buffer.size())
+  if (!ctx->dsdiff && ctx->pos < id3_buffer.size())
   {
     size_t tocopy = std::min(uiBufSize, static_cast<size_t>(id3_buffer.size() - ctx->pos));
     memcpy(lpBuf, id3_buffer.data() + ctx->pos, tocopy);
@@ -336,17 +422,15 @@ ssize_t CSACDFile::Read(kodi::addon::VFSFileHandle context, uint8_t* lpBuf, size
     return tocopy;
   }
 
-  int header_pos = ctx->pos - id3_buffer.size();
-  if (handle && header_pos < handle->header_size)
-  {
-    size_t tocopy = std::min(uiBufSize, static_cast<size_t>(handle->header_size - header_pos));
-    memcpy(lpBuf, handle->header + header_pos, tocopy);
-    ctx->pos += tocopy;
-    return tocopy;
-  }
-
-  while (ctx->decode_buffer.getMaxReadSize() < 32 * 1024)
+  // the file header went into the sink first, followed by the audio data
+  TRACE_THREAD_NAME("vfs read");
+  TRACE_BEGIN(read_span);
+  double wait_start = timeout_gettime();
+  std::unique_lock<std::mutex> lock(ctx->decode_buffer_lock);
+  metrics_record(ctx->ring_fill, static_cast<uint32_t>(output_sink_ring_available(ctx->ft->sink)));
+  while (output_sink_ring_available(ctx->ft->sink) < 32 * 1024)
   {
+    lock.unlock();
     // decode some more data
     if (ctx->ft->current_lsn < ctx->end_lsn)
     {
@@ -386,11 +470,16 @@ ssize_t CSACDFile::Read(kodi::addon::VFSFileHandle context, uint8_t* lpBuf, size
       ctx->block_size = std::min(ctx->end_lsn - ctx->ft->current_lsn, ctx->block_size);
 
       // read some blocks
+      TRACE_BEGIN(span);
+      double start = timeout_gettime();
       ctx->block_size = (uint32_t)sacd_read_block_raw(
           static_cast<sacd_reader_t*>(ctx->ft->sb_handle->sacd), ctx->ft->current_lsn,
           ctx->block_size, ctx->output->read_buffer);
       if (ctx->block_size == 0)
         return -1;
+      metrics_record_time(ctx->read_time, start);
+      TRACE_END(span, "sector read", ctx->ft->current_lsn);
+      metrics_add(ctx->read_bytes, static_cast<uint64_t>(ctx->block_size) * SACD_LSN_SIZE);
 
       ctx->ft->current_lsn += ctx->block_size;
       ctx->output->stats_total_sectors_processed += ctx->block_size;
@@ -414,25 +503,72 @@ ssize_t CSACDFile::Read(kodi::addon::VFSFileHandle context, uint8_t* lpBuf, size
 
       // encrypted blocks need to be decrypted first
       if (ctx->encrypted && ctx->non_encrypted_disc == 0)
+      {
+        TRACE_BEGIN(decrypt_span);
+        start = timeout_gettime();
         sacd_decrypt(static_cast<sacd_reader_t*>(ctx->ft->sb_handle->sacd),
                      ctx->output->read_buffer, ctx->block_size);
+        metrics_record_time(ctx->decrypt_time, start);
+        TRACE_END(decrypt_span, "decrypt", ctx->block_size);
+      }
 
-      scarletbook_process_frames(ctx->ft->sb_handle, ctx->output->read_buffer, ctx->block_size,
-                                 ctx->ft->current_lsn == ctx->end_lsn, frame_read_callback, ctx);
+      TRACE_BEGIN(frame_span);
+      start = timeout_gettime();
+      scarletbook_frame_batch_t* batch =
+          scarletbook_process_frame_batch(ctx->ft->sb_handle, ctx->output->read_buffer,
+                                          ctx->block_size, ctx->ft->current_lsn == ctx->end_lsn);
+      metrics_record_time(ctx->frame_time, start);
+      metrics_add(ctx->frames, batch->frame_count);
+      TRACE_END(frame_span, "frame extraction", batch->frame_count);
+      process_frame_batch(ctx, batch);
+    }
+    else if (ctx->dst_decoder && !ctx->dst_flushed)
+    {
+      // pass on the frames still held by the DST decoder
+      dst_decoder_flush(ctx->dst_decoder);
+      ctx->dst_flushed = true;
+    }
+    else if (ctx->ft->streaming && !ctx->finished)
+    {
+      // pad the file up to the size announced in its header
+      lock.lock();
+      (*ctx->ft->handler.stopwrite)(ctx->ft);
+      lock.unlock();
+      ctx->finished = true;
     }
     else
-      return 0;
+    {
+      lock.lock();
+      break;
+    }
+    lock.lock();
   }
 
-  size_t tocopy = std::min(uiBufSize, (size_t)ctx->decode_buffer.getMaxReadSize());
-  ctx->decode_buffer.ReadData(reinterpret_cast<char*>(lpBuf), tocopy);
+  if (ctx->ft->streaming)
+    uiBufSize = static_cast<size_t>(
+        std::min<int64_t>(uiBufSize, std::max<int64_t>(GetLength(context) - ctx->pos, 0)));
+
+  size_t tocopy = output_sink_ring_read(ctx->ft->sink, lpBuf, uiBufSize);
   ctx->pos += tocopy;
+  metrics_record_time(ctx->read_wait, wait_start);
+  TRACE_END(read_span, "Read", tocopy);
   return tocopy;
 }
 
 bool CSACDFile::Close(kodi::addon::VFSFileHandle context)
 {
   SACDContext* ctx = static_cast<SACDContext*>(context);
+  if (ctx->dst_decoder)
+    dst_decoder_destroy(ctx->dst_decoder);
+  metrics_dump(ctx->metrics, print_metric, ctx->ft->filename);
+  metrics_destroy(ctx->metrics);
+#ifdef SACD_TRACE
+  // the spans so far, overwritten by every Close
+  const char* trace_file = getenv("SACD_TRACE_FILE");
+  if (trace_file && !trace_export(trace_file))
+    kodiLog(ADDON_LOG_ERROR, "%s: could not write trace to %s", __func__, trace_file);
+#endif
+  output_sink_destroy(ctx->ft->sink);
   free(ctx->output->read_buffer);
   free(ctx->output);
   scarletbook_close(ctx->handle);
@@ -444,9 +580,11 @@ bool CSACDFile::Close(kodi::addon::VFSFileHandle context)
 int64_t CSACDFile::GetLength(kodi::addon::VFSFileHandle context)
 {
   SACDContext* ctx = static_cast<SACDContext*>(context);
+  if (ctx->ft->streaming)
+    return ctx->ft->stream_size;
+
   dsf_handle_t* handle = static_cast<dsf_handle_t*>(ctx->ft->priv);
-  return (ctx->end_lsn - ctx->ft->start_lsn) * SACD_LSN_SIZE + handle->header_size +
-         id3_buffer.size();
+  return ctx->audio_length + handle->header_size + id3_buffer.size();
 }
 
 int64_t CSACDFile::GetPosition(kodi::addon::VFSFileHandle context)
@@ -483,23 +621,48 @@ bool CSACDFile::ContainsFiles(const kodi::addon::VFSUrl& url,
   }
   if (reader)
   {
-    scarletbook_handle_t* handle = scarletbook_open(reader, 0);
-    if (handle)
+    // listing only needs the TOC, not a fully opened disc
+    std::vector<uint8_t> buffer(SCARLETBOOK_PROBE_BUFFER_SIZE);
+    scarletbook_probe_t probe;
+    int found = scarletbook_probe(reader, &probe, buffer.data(), buffer.size());
+    sacd_close(reader);
+    if (found)
     {
-      scarletbook_area_t* area = &handle->area[0];
+      scarletbook_probe_area_t* area = &probe.area[0];
+      std::vector<std::string> titles(area->track_count);
+      for (int i = 0; i < area->track_count; ++i)
+      {
+        if (area->track_title[i])
+        {
+          char* title = charset_convert(area->track_title[i], strlen(area->track_title[i]),
+                                        area->charset, "UTF-8");
+          if (title)
+            titles[i] = title;
+          free(title);
+        }
+      }
+
       kodi::vfs::CDirEntry item;
-      for (size_t i = 0; i < area->area_toc->track_count; ++i)
+      for (int i = 0; i < area->track_count; ++i)
       {
-        area_track_text_t* track_text = &area->area_track_text[i];
-        item.SetLabel(track_text->track_type_title);
-        item.SetTitle(track_text->track_type_title);
+        item.SetLabel(titles[i]);
+        item.SetTitle(titles[i]);
         std::stringstream str;
         str << "sacd://" << encoded << '/' << i + 1 << ".dsf";
         item.SetPath(str.str());
         items.push_back(item);
       }
-      scarletbook_close(handle);
-      sacd_close(reader);
+
+      // the same tracks as DSDIFF, which passes DST frames through undecoded
+      for (int i = 0; i < area->track_count; ++i)
+      {
+        item.SetLabel(titles[i] + " (DSDIFF)");
+        item.SetTitle(titles[i]);
+        std::stringstream str;
+        str << "sacd://" << encoded << '/' << i + 1 << ".dff";
+        item.SetPath(str.str());
+        items.push_back(item);
+      }
 
       std::stringstream str;
       str << "sacd://" << encoded << '/';
@@ -520,10 +683,23 @@ public:
                               KODI_ADDON_INSTANCE_HDL& hdl) override
   {
     init_logging();
+#ifdef SACD_TRACE
+    // SACD_TRACE_FILE=<file.json> records spans, which Close writes to that file
+    if (getenv("SACD_TRACE_FILE"))
+      trace_start();
+#endif
     hdl = new CSACDFile(instance);
     return ADDON_STATUS_OK;
   }
-  ~CMyAddon() override { destroy_logging(); }
+  ~CMyAddon() override
+  {
+    dst_decoder_shutdown();
+    charset_cleanup();
+#ifdef SACD_TRACE
+    trace_shutdown();
+#endif
+    destroy_logging();
+  }
 };
 
 ADDONCREATOR(CMyAddon);